@@ -10,11 +10,20 @@ LOCAL_SRC_FILES:= \
 	gnlcomposition.c	\
 	gnloperation.c		\
 	gnlsource.c		\
-	gnlfilesource.c
+	gnlfilesource.c		\
+	gnlstillsource.c	\
+	gnlmemorysource.c	\
+	gnlbuffersrc.c		\
+	gnlcache.c		\
+	gnlaudiocache.c		\
+	gnlmarshal.c
 
+# gnlmarshal.[ch] are generated from gnlmarshal.list by glib-genmarshal,
+# run 'make -C gnl gnlmarshal.c' on the host before building.
 
 LOCAL_SHARED_LIBRARIES := 	\
 	libgstreamer-0.10	\
+	libgstbase-0.10		\
 	libglib-2.0		\
 	libgthread-2.0		\
 	libgmodule-2.0		\
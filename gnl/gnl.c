@@ -35,6 +35,8 @@ static struct _elements_entry _elements[] = {
   {"gnlcomposition", gnl_composition_get_type},
   {"gnloperation", gnl_operation_get_type},
   {"gnlfilesource", gnl_filesource_get_type},
+  {"gnlstillsource", gnl_still_source_get_type},
+  {"gnlmemorysource", gnl_memory_source_get_type},
   {NULL, 0}
 };
 
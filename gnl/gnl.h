@@ -31,5 +31,10 @@
 #include "gnloperation.h"
 
 #include "gnlfilesource.h"
+#include "gnlstillsource.h"
+#include "gnlmemorysource.h"
+#include "gnlbuffersrc.h"
+#include "gnlcache.h"
+#include "gnlaudiocache.h"
 
 #endif /* __GST_H__ */
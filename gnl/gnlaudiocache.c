@@ -0,0 +1,435 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "gnl.h"
+
+/*
+ * The decoded audio cache holds the raw samples of whole audio files, each
+ * one decoded once in the background to a file of the cache directory, so
+ * that GnlFileSources can memory-map it instead of decoding the media.
+ *
+ * Cache files are named after the checksum of the media path, its
+ * modification time and size, and the caps of the samples: modified media
+ * get a new cache file. Files are written under a temporary name and only
+ * renamed once complete, so a cache file which exists is always usable.
+ *
+ * The samples are made contiguous with audiorate, so that the offset of a
+ * sample only depends on its time. Their first timestamp, which the
+ * positions in the file are relative to, is written to a ".start" file next
+ * to the cache file before it is renamed.
+ *
+ * Files are decoded by a pool of at most MAX_DECODE_THREADS threads, the
+ * other ones wait in its queue.
+ *
+ * Only local files are cached.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (gnlaudiocache);
+#define GST_CAT_DEFAULT gnlaudiocache
+
+#define MAX_DECODE_THREADS 2
+
+typedef struct _GnlAudioCacheJob GnlAudioCacheJob;
+
+struct _GnlAudioCacheJob
+{
+  gchar *source;                /* path of the media */
+  gchar *path;                  /* path of the cache file */
+  gchar *tmppath;               /* path written to while decoding */
+  GstCaps *caps;
+
+  GstElement *pipeline;
+  GstElement *convert;
+  gboolean linked;
+  /* timestamp of the first sample written, from the streaming thread */
+  GstClockTime start;
+};
+
+/* Values of the jobs table */
+#define JOB_RUNNING GINT_TO_POINTER (1)
+#define JOB_FAILED GINT_TO_POINTER (2)
+
+static GStaticMutex jobs_lock = G_STATIC_MUTEX_INIT;
+/* cache file path => JOB_RUNNING or JOB_FAILED, protected by jobs_lock */
+static GHashTable *jobs = NULL;
+/* created on the first job, protected by jobs_lock */
+static GThreadPool *decode_pool = NULL;
+
+static void
+job_free (GnlAudioCacheJob * job)
+{
+  g_free (job->source);
+  g_free (job->path);
+  g_free (job->tmppath);
+  gst_caps_unref (job->caps);
+  g_free (job);
+}
+
+/* Called from the streaming thread for each decoded stream */
+static void
+new_decoded_pad_cb (GstElement * decodebin G_GNUC_UNUSED, GstPad * pad,
+    gboolean last G_GNUC_UNUSED, GnlAudioCacheJob * job)
+{
+  GstCaps *caps = gst_pad_get_caps (pad);
+  const gchar *name = gst_structure_get_name (gst_caps_get_structure (caps,
+          0));
+  GstElement *fakesink;
+  GstPad *sinkpad;
+
+  if (!job->linked && g_str_has_prefix (name, "audio/x-raw")) {
+    sinkpad = gst_element_get_static_pad (job->convert, "sink");
+    job->linked = (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+    gst_object_unref (sinkpad);
+    if (job->linked)
+      goto beach;
+  }
+
+  /* only the first audio stream is cached, drop the others */
+  GST_DEBUG ("discarding %s stream of %s", name, job->source);
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (fakesink, "async", FALSE, NULL);
+  gst_bin_add ((GstBin *) job->pipeline, fakesink);
+  sinkpad = gst_element_get_static_pad (fakesink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (fakesink);
+
+beach:
+  gst_caps_unref (caps);
+}
+
+static void
+no_more_pads_cb (GstElement * decodebin, GnlAudioCacheJob * job)
+{
+  GError *error;
+
+  if (job->linked)
+    return;
+
+  /* the filesink would never see EOS */
+  error = g_error_new_literal (GST_STREAM_ERROR, GST_STREAM_ERROR_WRONG_TYPE,
+      "No audio stream");
+  gst_element_post_message (job->pipeline,
+      gst_message_new_error ((GstObject *) decodebin, error, job->source));
+  g_error_free (error);
+}
+
+static gboolean
+first_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GnlAudioCacheJob * job)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (job->start))
+    job->start = GST_BUFFER_TIMESTAMP (buffer);
+  return TRUE;
+}
+
+static gchar *
+get_start_path (const gchar * path)
+{
+  return g_strdup_printf ("%s.start", path);
+}
+
+static gboolean
+write_start (const gchar * path, GstClockTime start)
+{
+  gchar *startpath = get_start_path (path);
+  gchar *contents;
+  GError *error = NULL;
+  gboolean ret;
+
+  contents = g_strdup_printf ("%" G_GUINT64_FORMAT, start);
+  if (!(ret = g_file_set_contents (startpath, contents, -1, &error))) {
+    GST_WARNING ("Couldn't write %s : %s", startpath, error->message);
+    g_error_free (error);
+  }
+  g_free (contents);
+  g_free (startpath);
+
+  return ret;
+}
+
+/* Returns GST_CLOCK_TIME_NONE if the start of @path can't be read */
+static GstClockTime
+read_start (const gchar * path)
+{
+  gchar *startpath = get_start_path (path);
+  gchar *contents, *end;
+  GstClockTime ret = GST_CLOCK_TIME_NONE;
+
+  if (g_file_get_contents (startpath, &contents, NULL, NULL)) {
+    ret = g_ascii_strtoull (contents, &end, 10);
+    if ((end == contents) || *end)
+      ret = GST_CLOCK_TIME_NONE;
+    g_free (contents);
+  }
+  g_free (startpath);
+
+  return ret;
+}
+
+/*
+ * decode_job:
+ *
+ * GFunc of the decoding thread pool. Decodes the media of @job to its cache
+ * file.
+ */
+
+static void
+decode_job (GnlAudioCacheJob * job, gpointer user_data G_GNUC_UNUSED)
+{
+  GstElement *src, *decodebin, *resample, *filter, *rate, *sink;
+  GstMessage *message = NULL;
+  GstBus *bus;
+  GstPad *sinkpad;
+  gboolean ret = FALSE;
+
+  GST_DEBUG ("Decoding %s to %s", job->source, job->path);
+
+  job->pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  if (g_getenv ("USE_DECODEBIN2"))
+    decodebin = gst_element_factory_make ("decodebin2", NULL);
+  else
+    decodebin = gst_element_factory_make ("decodebin", NULL);
+  job->convert = gst_element_factory_make ("audioconvert", NULL);
+  resample = gst_element_factory_make ("audioresample", NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  rate = gst_element_factory_make ("audiorate", NULL);
+  sink = gst_element_factory_make ("filesink", NULL);
+
+  if (!src || !decodebin || !job->convert || !resample || !filter || !rate
+      || !sink) {
+    GST_WARNING ("Missing elements, can't decode %s", job->source);
+    if (src)
+      gst_object_unref (src);
+    if (decodebin)
+      gst_object_unref (decodebin);
+    if (job->convert)
+      gst_object_unref (job->convert);
+    if (resample)
+      gst_object_unref (resample);
+    if (filter)
+      gst_object_unref (filter);
+    if (rate)
+      gst_object_unref (rate);
+    if (sink)
+      gst_object_unref (sink);
+    goto beach;
+  }
+
+  g_object_set (src, "location", job->source, NULL);
+  g_object_set (filter, "caps", job->caps, NULL);
+  g_object_set (sink, "location", job->tmppath, NULL);
+
+  gst_bin_add_many ((GstBin *) job->pipeline, src, decodebin, job->convert,
+      resample, filter, rate, sink, NULL);
+  if (!gst_element_link (src, decodebin)
+      || !gst_element_link_many (job->convert, resample, filter, rate, sink,
+          NULL)) {
+    GST_WARNING ("Couldn't link the decoding pipeline");
+    goto beach;
+  }
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (first_buffer_probe), job);
+  gst_object_unref (sinkpad);
+
+  g_signal_connect (decodebin, "new-decoded-pad",
+      G_CALLBACK (new_decoded_pad_cb), job);
+  g_signal_connect (decodebin, "no-more-pads", G_CALLBACK (no_more_pads_cb),
+      job);
+
+  if (gst_element_set_state (job->pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+    goto beach;
+
+  bus = gst_element_get_bus (job->pipeline);
+  message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_object_unref (bus);
+
+  ret = (message && (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS));
+
+beach:
+  if (message)
+    gst_message_unref (message);
+  gst_element_set_state (job->pipeline, GST_STATE_NULL);
+  gst_object_unref (job->pipeline);
+
+  if (ret && !GST_CLOCK_TIME_IS_VALID (job->start)) {
+    GST_WARNING ("No samples decoded from %s", job->source);
+    ret = FALSE;
+  }
+  if (ret && !write_start (job->path, job->start))
+    ret = FALSE;
+  if (ret && g_rename (job->tmppath, job->path) < 0) {
+    GST_WARNING ("Couldn't rename %s : %s", job->tmppath, g_strerror (errno));
+    ret = FALSE;
+  }
+  if (!ret)
+    g_unlink (job->tmppath);
+
+  GST_DEBUG ("%s : %s", job->source, ret ? "done" : "failed");
+
+  /* failed media aren't tried again */
+  g_static_mutex_lock (&jobs_lock);
+  if (ret)
+    g_hash_table_remove (jobs, job->path);
+  else
+    g_hash_table_replace (jobs, g_strdup (job->path), JOB_FAILED);
+  g_static_mutex_unlock (&jobs_lock);
+
+  job_free (job);
+}
+
+/**
+ * gnl_get_local_path:
+ * @location: path or uri of a media, or NULL
+ *
+ * Returns: The path of @location if it is a local file (to free with
+ * g_free()), else NULL.
+ */
+gchar *
+gnl_get_local_path (const gchar * location)
+{
+  if (!location)
+    return NULL;
+  if (g_str_has_prefix (location, "file://"))
+    return g_filename_from_uri (location, NULL, NULL);
+  if (!strstr (location, "://"))
+    return g_strdup (location);
+  return NULL;
+}
+
+/**
+ * gnl_audio_cache_lookup:
+ * @dir: the cache directory, created if needed
+ * @location: path or uri of the media
+ * @caps: fixed raw audio caps of the cached samples
+ *
+ * @start: set to the time of the first sample if they are available
+ *
+ * Looks for the decoded samples of @location in @dir, and if they aren't
+ * there yet queues their decoding in the background, unless it is already
+ * being done or failed before.
+ *
+ * Returns: The path of the file containing the samples (to free with
+ * g_free()), or NULL if they aren't available yet.
+ */
+gchar *
+gnl_audio_cache_lookup (const gchar * dir, const gchar * location,
+    const GstCaps * caps, GstClockTime * start)
+{
+  GnlAudioCacheJob *job;
+  gchar *source, *str, *key, *checksum, *name, *path = NULL;
+  struct stat st;
+  GError *error = NULL;
+  gpointer state;
+
+  if (!gnlaudiocache)
+    GST_DEBUG_CATEGORY_INIT (gnlaudiocache, "gnlaudiocache",
+        GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin decoded audio cache");
+
+  if (!(source = gnl_get_local_path (location))) {
+    GST_DEBUG ("%s isn't a local file, not caching it", location);
+    return NULL;
+  }
+
+  if (g_stat (source, &st) < 0) {
+    GST_DEBUG ("Couldn't stat %s : %s", source, g_strerror (errno));
+    g_free (source);
+    return NULL;
+  }
+
+  str = gst_caps_to_string (caps);
+  key = g_strdup_printf ("%s|%" G_GINT64_FORMAT "|%" G_GINT64_FORMAT "|%s",
+      source, (gint64) st.st_mtime, (gint64) st.st_size, str);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  name = g_strdup_printf ("%s.pcm", checksum);
+  path = g_build_filename (dir, name, NULL);
+  g_free (name);
+  g_free (checksum);
+  g_free (key);
+  g_free (str);
+
+  if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+    if (GST_CLOCK_TIME_IS_VALID (*start = read_start (path)))
+      goto beach;
+    /* decode it again */
+    GST_WARNING ("Couldn't read the start of %s", path);
+    g_unlink (path);
+  }
+
+  g_static_mutex_lock (&jobs_lock);
+
+  if (!jobs)
+    jobs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  state = g_hash_table_lookup (jobs, path);
+  if (state) {
+    GST_LOG ("%s : %s", location, state == JOB_RUNNING ? "decoding" :
+        "failed");
+    goto unlock;
+  }
+
+  if (g_mkdir_with_parents (dir, 0755) < 0) {
+    GST_WARNING ("Couldn't create %s : %s", dir, g_strerror (errno));
+    g_hash_table_insert (jobs, g_strdup (path), JOB_FAILED);
+    goto unlock;
+  }
+
+  job = g_new0 (GnlAudioCacheJob, 1);
+  job->source = source;
+  job->path = g_strdup (path);
+  job->tmppath = g_strdup_printf ("%s.tmp", path);
+  job->caps = gst_caps_copy (caps);
+  job->start = GST_CLOCK_TIME_NONE;
+  source = NULL;
+
+  if (!decode_pool
+      && !(decode_pool = g_thread_pool_new ((GFunc) decode_job, NULL,
+              MAX_DECODE_THREADS, FALSE, &error))) {
+    GST_WARNING ("Couldn't create the decoding threads : %s", error->message);
+    g_error_free (error);
+    g_hash_table_insert (jobs, g_strdup (path), JOB_FAILED);
+    job_free (job);
+    goto unlock;
+  }
+
+  /* If no thread can be started now, the job waits for a running one */
+  g_hash_table_insert (jobs, g_strdup (path), JOB_RUNNING);
+  g_thread_pool_push (decode_pool, job, NULL);
+
+unlock:
+  g_static_mutex_unlock (&jobs_lock);
+  g_free (path);
+  path = NULL;
+
+beach:
+  g_free (source);
+  return path;
+}
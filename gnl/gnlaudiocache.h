@@ -0,0 +1,35 @@
+/* Gnonlin
+ *
+ * gnlaudiocache.h: Header for the decoded audio file cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GNL_AUDIO_CACHE_H__
+#define __GNL_AUDIO_CACHE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+gchar *gnl_get_local_path (const gchar * location);
+
+gchar *gnl_audio_cache_lookup (const gchar * dir, const gchar * location,
+    const GstCaps * caps, GstClockTime * start);
+
+G_END_DECLS
+#endif /* __GNL_AUDIO_CACHE_H__ */
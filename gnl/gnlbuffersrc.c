@@ -0,0 +1,694 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gnl.h"
+
+/*
+ * GnlBufferSrc is an internal source element which doesn't read or decode
+ * anything. It outputs copies of a template buffer (ex: a black frame or a
+ * chunk of silence), which only differ by their timestamps and share the
+ * template's data.
+ *
+ * It can also output a list of buffers as they are (ex: decoded buffers
+ * from a #GnlCache), see gnl_buffer_src_set_buffers(), the buffers
+ * returned by a function, see gnl_buffer_src_set_pull_func(), or the raw
+ * audio samples of a memory-mapped file, see gnl_buffer_src_set_raw_file().
+ *
+ * It isn't registered as an element factory, it is only used inside gnonlin.
+ */
+
+static GstStaticPadTemplate gnl_buffer_src_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GST_DEBUG_CATEGORY_STATIC (gnlbuffersrc);
+#define GST_CAT_DEFAULT gnlbuffersrc
+
+GST_BOILERPLATE (GnlBufferSrc, gnl_buffer_src, GstBaseSrc, GST_TYPE_BASE_SRC);
+
+static GstElementDetails gnl_buffer_src_details = GST_ELEMENT_DETAILS
+    ("GNonLin Buffer Source",
+    "Source",
+    "Outputs copies of a template buffer, a list of buffers, pulled buffers "
+    "or the samples of a raw audio file",
+    "Gnonlin developers <gstreamer-devel@lists.sourceforge.net>");
+
+enum
+{
+  ARG_0,
+  ARG_BUFFER,
+  ARG_GAP,
+};
+
+/* Number of samples per buffer in raw file mode */
+#define RAW_FILE_CHUNK 4096
+
+struct _GnlBufferSrcPrivate
+{
+  /* protected by the object lock */
+  GstBuffer *buffer;
+  gboolean gap;
+
+  /* GstBuffer sorted by timestamp, output instead of the template if set.
+   * Only set before going to PAUSED */
+  GPtrArray *buffers;
+
+  /* Called for the buffers to output if set, same as buffers */
+  GnlBufferSrcPullFunc func;
+  gpointer func_data;
+
+  /* Mapped raw audio file, output in slices if set, same as buffers */
+  GstBuffer *map;
+  GstCaps *rawcaps;
+  gint rate;
+  guint bpf;
+  /* time of the first sample */
+  GstClockTime rawstart;
+
+  /* streaming thread only. In reverse playback, the end of the next buffer
+   * to output */
+  GstClockTime position;
+  /* index of the next buffer to output, or -1 if none is left */
+  gint index;
+};
+
+static void gnl_buffer_src_finalize (GObject * object);
+
+static void gnl_buffer_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gnl_buffer_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GstCaps *gnl_buffer_src_get_caps (GstBaseSrc * bsrc);
+static gboolean gnl_buffer_src_is_seekable (GstBaseSrc * bsrc);
+static gboolean gnl_buffer_src_do_seek (GstBaseSrc * bsrc,
+    GstSegment * segment);
+static GstFlowReturn gnl_buffer_src_create (GstBaseSrc * bsrc, guint64 offset,
+    guint length, GstBuffer ** buf);
+
+static void
+gnl_buffer_src_base_init (gpointer g_class)
+{
+  GstElementClass *gstclass = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_set_details (gstclass, &gnl_buffer_src_details);
+  gst_element_class_add_pad_template (gstclass,
+      gst_static_pad_template_get (&gnl_buffer_src_src_template));
+}
+
+static void
+gnl_buffer_src_class_init (GnlBufferSrcClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstBaseSrcClass *gstbasesrc_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstbasesrc_class = (GstBaseSrcClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gnlbuffersrc, "gnlbuffersrc",
+      GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin Buffer Source");
+
+  gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_buffer_src_finalize);
+  gobject_class->set_property =
+      GST_DEBUG_FUNCPTR (gnl_buffer_src_set_property);
+  gobject_class->get_property =
+      GST_DEBUG_FUNCPTR (gnl_buffer_src_get_property);
+
+  g_object_class_install_property (gobject_class, ARG_BUFFER,
+      gst_param_spec_mini_object ("buffer", "Buffer",
+          "Template buffer, with caps and a valid non-zero duration",
+          GST_TYPE_BUFFER, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, ARG_GAP,
+      g_param_spec_boolean ("gap", "Gap",
+          "Mark outgoing buffers with the GAP flag", FALSE,
+          G_PARAM_READWRITE));
+
+  gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gnl_buffer_src_get_caps);
+  gstbasesrc_class->is_seekable =
+      GST_DEBUG_FUNCPTR (gnl_buffer_src_is_seekable);
+  gstbasesrc_class->do_seek = GST_DEBUG_FUNCPTR (gnl_buffer_src_do_seek);
+  gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gnl_buffer_src_create);
+}
+
+static void
+gnl_buffer_src_init (GnlBufferSrc * src,
+    GnlBufferSrcClass * klass G_GNUC_UNUSED)
+{
+  src->priv = g_new0 (GnlBufferSrcPrivate, 1);
+
+  gst_base_src_set_format (GST_BASE_SRC (src), GST_FORMAT_TIME);
+}
+
+static void
+free_buffers (GPtrArray * buffers)
+{
+  guint i;
+
+  for (i = 0; i < buffers->len; i++)
+    gst_buffer_unref (GST_BUFFER (g_ptr_array_index (buffers, i)));
+  g_ptr_array_free (buffers, TRUE);
+}
+
+static void
+gnl_buffer_src_finalize (GObject * object)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) object;
+
+  if (src->priv->buffer)
+    gst_buffer_unref (src->priv->buffer);
+  if (src->priv->buffers)
+    free_buffers (src->priv->buffers);
+  if (src->priv->map)
+    gst_buffer_unref (src->priv->map);
+  if (src->priv->rawcaps)
+    gst_caps_unref (src->priv->rawcaps);
+  g_free (src->priv);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gnl_buffer_src_set_buffer (GnlBufferSrc * src, GstBuffer * buffer)
+{
+  /* We'd never advance with a zero duration */
+  if (buffer && (!GST_BUFFER_DURATION_IS_VALID (buffer)
+          || !GST_BUFFER_DURATION (buffer))) {
+    GST_WARNING_OBJECT (src,
+        "Template buffer doesn't have a valid, non-zero, duration");
+    return;
+  }
+
+  GST_OBJECT_LOCK (src);
+  if (src->priv->buffer)
+    gst_buffer_unref (src->priv->buffer);
+  src->priv->buffer = buffer ? gst_buffer_ref (buffer) : NULL;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gnl_buffer_src_set_buffers:
+ * @src: a #GnlBufferSrc
+ * @buffers: buffers with caps and valid timestamps and durations, sorted by
+ * timestamp. Ownership is taken.
+ *
+ * Makes @src output @buffers unmodified instead of copies of its template
+ * buffer. Seeks select the buffers overlapping the requested segment.
+ *
+ * Must be called before @src goes to PAUSED.
+ */
+void
+gnl_buffer_src_set_buffers (GnlBufferSrc * src, GPtrArray * buffers)
+{
+  GST_OBJECT_LOCK (src);
+  if (src->priv->buffers)
+    free_buffers (src->priv->buffers);
+  src->priv->buffers = buffers;
+  src->priv->index = buffers && buffers->len ? 0 : -1;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gnl_buffer_src_set_pull_func:
+ * @src: a #GnlBufferSrc
+ * @func: function returning the buffer to output at a given position
+ * @user_data: data passed to @func
+ *
+ * Makes @src output the buffers returned by @func instead of copies of its
+ * template buffer. @func is called from the streaming thread with the
+ * position following the previous buffer (or the seek position), and must
+ * return a buffer with caps and a valid timestamp and duration, ending after
+ * that position, or NULL at the end of the stream.
+ *
+ * In reverse playback, @func is called with the time just before the
+ * previous buffer (or the seek stop) and must return a buffer starting at or
+ * before it.
+ *
+ * Must be called before @src goes to PAUSED.
+ */
+void
+gnl_buffer_src_set_pull_func (GnlBufferSrc * src, GnlBufferSrcPullFunc func,
+    gpointer user_data)
+{
+  GST_OBJECT_LOCK (src);
+  src->priv->func = func;
+  src->priv->func_data = user_data;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gnl_buffer_src_set_raw_file:
+ * @src: a #GnlBufferSrc
+ * @path: file containing contiguous raw interleaved audio samples
+ * @caps: fixed raw audio caps of the samples
+ * @start: time of the first sample
+ *
+ * Makes @src output the contents of @path, which is memory-mapped: the
+ * outgoing buffers point into the mapping, and seeking is only an offset
+ * computation, exact to the sample.
+ *
+ * Must be called before @src goes to PAUSED.
+ *
+ * Returns: TRUE if the file could be mapped.
+ */
+gboolean
+gnl_buffer_src_set_raw_file (GnlBufferSrc * src, const gchar * path,
+    const GstCaps * caps, GstClockTime start)
+{
+  GstStructure *structure = gst_caps_get_structure (caps, 0);
+  GMappedFile *file;
+  GstBuffer *map;
+  GError *error = NULL;
+  gint rate, channels, width;
+
+  if (!gst_structure_get_int (structure, "rate", &rate)
+      || !gst_structure_get_int (structure, "channels", &channels)
+      || !gst_structure_get_int (structure, "width", &width)
+      || (rate <= 0) || (channels <= 0) || (width < 8)) {
+    GST_WARNING_OBJECT (src, "Invalid raw audio caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  if (!(file = g_mapped_file_new (path, FALSE, &error))) {
+    GST_WARNING_OBJECT (src, "Couldn't map %s : %s", path, error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  /* The file is unmapped with the last buffer pointing to it */
+  map = gst_buffer_new ();
+  GST_BUFFER_DATA (map) = (guint8 *) g_mapped_file_get_contents (file);
+  GST_BUFFER_SIZE (map) = g_mapped_file_get_length (file);
+  GST_BUFFER_MALLOCDATA (map) = (guint8 *) file;
+  GST_BUFFER_FREE_FUNC (map) = (GFreeFunc) g_mapped_file_free;
+
+  GST_DEBUG_OBJECT (src, "mapped %u bytes of %s", GST_BUFFER_SIZE (map), path);
+
+  GST_OBJECT_LOCK (src);
+  if (src->priv->map)
+    gst_buffer_unref (src->priv->map);
+  if (src->priv->rawcaps)
+    gst_caps_unref (src->priv->rawcaps);
+  src->priv->map = map;
+  src->priv->rawcaps = gst_caps_copy (caps);
+  src->priv->rate = rate;
+  src->priv->bpf = channels * (width / 8);
+  src->priv->rawstart = start;
+  GST_OBJECT_UNLOCK (src);
+
+  return TRUE;
+}
+
+static void
+gnl_buffer_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) object;
+
+  switch (prop_id) {
+    case ARG_BUFFER:
+      gnl_buffer_src_set_buffer (src,
+          (GstBuffer *) gst_value_get_mini_object (value));
+      break;
+    case ARG_GAP:
+      GST_OBJECT_LOCK (src);
+      src->priv->gap = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gnl_buffer_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) object;
+
+  switch (prop_id) {
+    case ARG_BUFFER:
+      GST_OBJECT_LOCK (src);
+      gst_value_set_mini_object (value, (GstMiniObject *) src->priv->buffer);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case ARG_GAP:
+      GST_OBJECT_LOCK (src);
+      g_value_set_boolean (value, src->priv->gap);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstCaps *
+gnl_buffer_src_get_caps (GstBaseSrc * bsrc)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) bsrc;
+  GstCaps *caps = NULL;
+
+  GST_OBJECT_LOCK (src);
+  if (src->priv->buffers && src->priv->buffers->len) {
+    GstBuffer *first = g_ptr_array_index (src->priv->buffers, 0);
+
+    if (GST_BUFFER_CAPS (first))
+      caps = gst_caps_copy (GST_BUFFER_CAPS (first));
+  } else if (src->priv->rawcaps)
+    caps = gst_caps_copy (src->priv->rawcaps);
+  else if (src->priv->buffer && GST_BUFFER_CAPS (src->priv->buffer))
+    caps = gst_caps_copy (GST_BUFFER_CAPS (src->priv->buffer));
+  GST_OBJECT_UNLOCK (src);
+
+  if (!caps)
+    caps = gst_caps_new_any ();
+
+  return caps;
+}
+
+static gboolean
+gnl_buffer_src_is_seekable (GstBaseSrc * bsrc G_GNUC_UNUSED)
+{
+  return TRUE;
+}
+
+/*
+ * find_buffer:
+ *
+ * Returns the index of the first buffer ending after @position, or the
+ * number of buffers if there is none.
+ */
+
+static guint
+find_buffer (GPtrArray * buffers, GstClockTime position)
+{
+  guint low = 0, high = buffers->len, mid;
+  GstBuffer *buf;
+
+  while (low < high) {
+    mid = (low + high) / 2;
+    buf = GST_BUFFER (g_ptr_array_index (buffers, mid));
+
+    if (GST_BUFFER_TIMESTAMP (buf) + GST_BUFFER_DURATION (buf) > position)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  return low;
+}
+
+static gboolean
+gnl_buffer_src_do_seek (GstBaseSrc * bsrc, GstSegment * segment)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) bsrc;
+  GPtrArray *buffers = src->priv->buffers;
+  guint index;
+
+  GST_DEBUG_OBJECT (src, "seeking to %" GST_TIME_FORMAT " -- %"
+      GST_TIME_FORMAT ", rate %f", GST_TIME_ARGS (segment->start),
+      GST_TIME_ARGS (segment->stop), segment->rate);
+
+  if ((segment->rate < 0.0) && !buffers
+      && !GST_CLOCK_TIME_IS_VALID (segment->stop) && !src->priv->map) {
+    GST_WARNING_OBJECT (src, "Can't play backwards without a segment stop");
+    return FALSE;
+  }
+
+  if (buffers) {
+    if (segment->rate < 0.0) {
+      /* last buffer starting before the stop */
+      index = GST_CLOCK_TIME_IS_VALID (segment->stop) ?
+          find_buffer (buffers, segment->stop) : buffers->len;
+      if ((index < buffers->len)
+          && (GST_BUFFER_TIMESTAMP (g_ptr_array_index (buffers,
+                      index)) < segment->stop))
+        index++;
+      src->priv->index = (gint) index - 1;
+    } else {
+      index = find_buffer (buffers, segment->start);
+      src->priv->index = index < buffers->len ? (gint) index : -1;
+    }
+    GST_DEBUG_OBJECT (src, "next buffer %d", src->priv->index);
+  }
+
+  if (segment->rate < 0.0) {
+    /* buffers are output backwards from the stop, or the end of the file */
+    if (GST_CLOCK_TIME_IS_VALID (segment->stop) || !src->priv->map)
+      src->priv->position = segment->stop;
+    else
+      src->priv->position = src->priv->rawstart +
+          gst_util_uint64_scale (GST_BUFFER_SIZE (src->priv->map) /
+          src->priv->bpf, GST_SECOND, src->priv->rate);
+  } else
+    src->priv->position = segment->start;
+  segment->last_stop = GST_CLOCK_TIME_IS_VALID (src->priv->position) ?
+      src->priv->position : segment->start;
+  segment->time = segment->start;
+
+  return TRUE;
+}
+
+/* Whether the streaming thread went past the segment, in either direction */
+static inline gboolean
+reached_segment_end (GnlBufferSrc * src)
+{
+  GstSegment *segment = &((GstBaseSrc *) src)->segment;
+
+  if (segment->rate < 0.0)
+    return src->priv->position <= (GstClockTime) segment->start;
+  return GST_CLOCK_TIME_IS_VALID (segment->stop)
+      && (src->priv->position >= (GstClockTime) segment->stop);
+}
+
+static GstFlowReturn
+gnl_buffer_src_create_from_list (GnlBufferSrc * src, GstBuffer ** buf)
+{
+  GstBaseSrc *bsrc = (GstBaseSrc *) src;
+  GstBuffer *outbuf;
+
+  if (src->priv->index < 0)
+    goto done;
+
+  outbuf = GST_BUFFER (g_ptr_array_index (src->priv->buffers,
+          src->priv->index));
+
+  if (bsrc->segment.rate < 0.0) {
+    if (GST_BUFFER_TIMESTAMP (outbuf) + GST_BUFFER_DURATION (outbuf) <=
+        (GstClockTime) bsrc->segment.start)
+      goto done;
+    src->priv->index--;
+  } else {
+    if (GST_CLOCK_TIME_IS_VALID (bsrc->segment.stop)
+        && (GST_BUFFER_TIMESTAMP (outbuf) >= (GstClockTime) bsrc->segment.stop))
+      goto done;
+    src->priv->index++;
+    if ((guint) src->priv->index >= src->priv->buffers->len)
+      src->priv->index = -1;
+  }
+
+  GST_LOG_OBJECT (src, "timestamp %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)));
+
+  *buf = gst_buffer_ref (outbuf);
+  return GST_FLOW_OK;
+
+done:
+  GST_DEBUG_OBJECT (src, "reached segment boundary");
+  return GST_FLOW_UNEXPECTED;
+}
+
+static GstFlowReturn
+gnl_buffer_src_create_from_func (GnlBufferSrc * src, GstBuffer ** buf)
+{
+  GstBaseSrc *bsrc = (GstBaseSrc *) src;
+  GstBuffer *outbuf;
+  GstClockTime position;
+  gboolean reverse = bsrc->segment.rate < 0.0;
+
+  if (reached_segment_end (src))
+    goto done;
+
+  /* backwards, we want the buffer containing the time just before */
+  position = reverse ? src->priv->position - 1 : src->priv->position;
+
+  if (!(outbuf = src->priv->func (position, src->priv->func_data)))
+    goto done;
+
+  if (!GST_BUFFER_TIMESTAMP_IS_VALID (outbuf)
+      || !GST_BUFFER_DURATION_IS_VALID (outbuf)
+      || (reverse && (GST_BUFFER_TIMESTAMP (outbuf) > position))
+      || (!reverse && (GST_BUFFER_TIMESTAMP (outbuf) +
+              GST_BUFFER_DURATION (outbuf) <= position))) {
+    gst_buffer_unref (outbuf);
+    GST_ELEMENT_ERROR (src, STREAM, FAILED, (NULL),
+        ("Buffers must have a valid timestamp and duration, and end after "
+            "(start before, backwards) the requested position"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (reverse)
+    src->priv->position = GST_BUFFER_TIMESTAMP (outbuf);
+  else
+    src->priv->position =
+        GST_BUFFER_TIMESTAMP (outbuf) + GST_BUFFER_DURATION (outbuf);
+
+  GST_LOG_OBJECT (src, "timestamp %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)));
+
+  *buf = outbuf;
+  return GST_FLOW_OK;
+
+done:
+  GST_DEBUG_OBJECT (src, "reached end of stream");
+  return GST_FLOW_UNEXPECTED;
+}
+
+static GstFlowReturn
+gnl_buffer_src_create_from_raw_file (GnlBufferSrc * src, GstBuffer ** buf)
+{
+  GstBaseSrc *bsrc = (GstBaseSrc *) src;
+  GnlBufferSrcPrivate *priv = src->priv;
+  GstBuffer *outbuf;
+  guint64 sample, nsamples, offset, total;
+  GstClockTime position;
+  gboolean reverse = bsrc->segment.rate < 0.0;
+
+  if (reached_segment_end (src))
+    goto done;
+
+  /* position in the file, playback starts at the first sample */
+  position = (priv->position > priv->rawstart) ?
+      priv->position - priv->rawstart : 0;
+
+  /* sample playing at position, taking rounding errors into account */
+  sample = gst_util_uint64_scale (position, priv->rate, GST_SECOND);
+  if (gst_util_uint64_scale (sample + 1, GST_SECOND, priv->rate) <= position)
+    sample++;
+
+  total = GST_BUFFER_SIZE (priv->map) / priv->bpf;
+
+  if (reverse) {
+    /* the chunk ends with the last sample starting before position */
+    if (gst_util_uint64_scale (sample, GST_SECOND, priv->rate) < position)
+      sample++;
+    sample = MIN (sample, total);
+    nsamples = MIN (RAW_FILE_CHUNK, sample);
+    sample -= nsamples;
+  } else {
+    if (sample >= total)
+      goto done;
+    nsamples = MIN (RAW_FILE_CHUNK, total - sample);
+  }
+  if (!nsamples)
+    goto done;
+  offset = sample * priv->bpf;
+
+  outbuf = gst_buffer_create_sub (priv->map, offset, nsamples * priv->bpf);
+  gst_buffer_set_caps (outbuf, priv->rawcaps);
+  GST_BUFFER_OFFSET (outbuf) = sample;
+  GST_BUFFER_OFFSET_END (outbuf) = sample + nsamples;
+  GST_BUFFER_TIMESTAMP (outbuf) = priv->rawstart +
+      gst_util_uint64_scale (sample, GST_SECOND, priv->rate);
+  GST_BUFFER_DURATION (outbuf) =
+      gst_util_uint64_scale (sample + nsamples, GST_SECOND, priv->rate) -
+      gst_util_uint64_scale (sample, GST_SECOND, priv->rate);
+
+  if (reverse) {
+    /* each chunk is played forward, but isn't contiguous with the previous
+     * one */
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+    priv->position = GST_BUFFER_TIMESTAMP (outbuf);
+  } else
+    priv->position =
+        GST_BUFFER_TIMESTAMP (outbuf) + GST_BUFFER_DURATION (outbuf);
+
+  GST_LOG_OBJECT (src, "timestamp %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)));
+
+  *buf = outbuf;
+  return GST_FLOW_OK;
+
+done:
+  GST_DEBUG_OBJECT (src, "reached end of file");
+  return GST_FLOW_UNEXPECTED;
+}
+
+static GstFlowReturn
+gnl_buffer_src_create (GstBaseSrc * bsrc, guint64 offset G_GNUC_UNUSED,
+    guint length G_GNUC_UNUSED, GstBuffer ** buf)
+{
+  GnlBufferSrc *src = (GnlBufferSrc *) bsrc;
+  GstBuffer *outbuf;
+  GstClockTime duration;
+
+  if (src->priv->buffers)
+    return gnl_buffer_src_create_from_list (src, buf);
+  if (src->priv->map)
+    return gnl_buffer_src_create_from_raw_file (src, buf);
+  if (src->priv->func)
+    return gnl_buffer_src_create_from_func (src, buf);
+
+  if (reached_segment_end (src)) {
+    GST_DEBUG_OBJECT (src, "reached segment boundary");
+    return GST_FLOW_UNEXPECTED;
+  }
+
+  GST_OBJECT_LOCK (src);
+  if (!src->priv->buffer) {
+    GST_OBJECT_UNLOCK (src);
+    GST_ELEMENT_ERROR (src, CORE, NEGOTIATION, (NULL),
+        ("No template buffer was set"));
+    return GST_FLOW_ERROR;
+  }
+
+  /* Sub-buffers share the template's data, only the metadata differs */
+  outbuf = gst_buffer_create_sub (src->priv->buffer, 0,
+      GST_BUFFER_SIZE (src->priv->buffer));
+  gst_buffer_set_caps (outbuf, GST_BUFFER_CAPS (src->priv->buffer));
+  duration = GST_BUFFER_DURATION (src->priv->buffer);
+  if (src->priv->gap)
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_GAP);
+  GST_OBJECT_UNLOCK (src);
+
+  if (bsrc->segment.rate < 0.0) {
+    /* backwards, the buffers end where the previous one started */
+    duration = MIN (duration, src->priv->position);
+    src->priv->position -= duration;
+    GST_BUFFER_TIMESTAMP (outbuf) = src->priv->position;
+  } else {
+    GST_BUFFER_TIMESTAMP (outbuf) = src->priv->position;
+    src->priv->position += duration;
+  }
+  GST_BUFFER_DURATION (outbuf) = duration;
+
+  GST_LOG_OBJECT (src, "timestamp %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)));
+
+  *buf = outbuf;
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,71 @@
+/* Gnonlin
+ *
+ * gnlbuffersrc.h: Header for GnlBufferSrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GNL_BUFFER_SRC_H__
+#define __GNL_BUFFER_SRC_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesrc.h>
+
+#include "gnltypes.h"
+
+G_BEGIN_DECLS
+#define GNL_TYPE_BUFFER_SRC \
+  (gnl_buffer_src_get_type())
+#define GNL_BUFFER_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GNL_TYPE_BUFFER_SRC,GnlBufferSrc))
+#define GNL_BUFFER_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GNL_TYPE_BUFFER_SRC,GnlBufferSrcClass))
+#define GNL_IS_BUFFER_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GNL_TYPE_BUFFER_SRC))
+#define GNL_IS_BUFFER_SRC_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GNL_TYPE_BUFFER_SRC))
+typedef struct _GnlBufferSrcPrivate GnlBufferSrcPrivate;
+
+typedef GstBuffer *(*GnlBufferSrcPullFunc) (GstClockTime position,
+    gpointer user_data);
+
+struct _GnlBufferSrc
+{
+  GstBaseSrc parent;
+
+  /*< private >*/
+
+  GnlBufferSrcPrivate *priv;
+};
+
+struct _GnlBufferSrcClass
+{
+  GstBaseSrcClass parent_class;
+};
+
+GType gnl_buffer_src_get_type (void);
+
+void gnl_buffer_src_set_buffers (GnlBufferSrc * src, GPtrArray * buffers);
+
+void gnl_buffer_src_set_pull_func (GnlBufferSrc * src,
+    GnlBufferSrcPullFunc func, gpointer user_data);
+
+gboolean gnl_buffer_src_set_raw_file (GnlBufferSrc * src, const gchar * path,
+    const GstCaps * caps, GstClockTime start);
+
+G_END_DECLS
+#endif /* __GNL_BUFFER_SRC_H__ */
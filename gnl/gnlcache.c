@@ -0,0 +1,314 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "gnl.h"
+
+/*
+ * GnlCache holds runs of decoded buffers, recorded by GnlSources while they
+ * play, so that other sources using the same media range can output them
+ * again instead of decoding them.
+ *
+ * A run is identified by a key (the media location and the stream caps) and
+ * covers the [start, stop[ media time range without holes. Runs are kept in
+ * least recently used order and evicted when the total size of their
+ * buffers goes over the budget.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (gnlcache);
+#define GST_CAT_DEFAULT gnlcache
+
+typedef struct _GnlCacheRun GnlCacheRun;
+
+struct _GnlCacheRun
+{
+  gchar *key;
+  GstClockTime start;
+  GstClockTime stop;
+
+  /* GstBuffer, sorted by timestamp */
+  GPtrArray *buffers;
+  guint64 size;
+};
+
+struct _GnlCache
+{
+  gint refcount;
+
+  GMutex *lock;
+
+  /* GnlCacheRun, most recently used first */
+  GList *runs;
+  guint64 size;
+  guint64 budget;
+
+  guint hits;
+  guint misses;
+};
+
+static void
+free_buffers (GPtrArray * buffers)
+{
+  guint i;
+
+  for (i = 0; i < buffers->len; i++)
+    gst_buffer_unref (GST_BUFFER (g_ptr_array_index (buffers, i)));
+  g_ptr_array_free (buffers, TRUE);
+}
+
+static void
+run_free (GnlCacheRun * run)
+{
+  g_free (run->key);
+  free_buffers (run->buffers);
+  g_free (run);
+}
+
+GnlCache *
+gnl_cache_new (void)
+{
+  GnlCache *cache;
+
+  if (!gnlcache)
+    GST_DEBUG_CATEGORY_INIT (gnlcache, "gnlcache",
+        GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin decoded buffer cache");
+
+  cache = g_new0 (GnlCache, 1);
+  cache->refcount = 1;
+  cache->lock = g_mutex_new ();
+
+  return cache;
+}
+
+GnlCache *
+gnl_cache_ref (GnlCache * cache)
+{
+  g_atomic_int_inc (&cache->refcount);
+
+  return cache;
+}
+
+void
+gnl_cache_unref (GnlCache * cache)
+{
+  if (!g_atomic_int_dec_and_test (&cache->refcount))
+    return;
+
+  g_list_foreach (cache->runs, (GFunc) run_free, NULL);
+  g_list_free (cache->runs);
+  g_mutex_free (cache->lock);
+  g_free (cache);
+}
+
+/* Must be called with the cache lock */
+static void
+evict (GnlCache * cache)
+{
+  GList *last;
+  GnlCacheRun *run;
+
+  while (cache->size > cache->budget && (last = g_list_last (cache->runs))) {
+    run = (GnlCacheRun *) last->data;
+
+    GST_DEBUG ("Evicting %s [%" GST_TIME_FORMAT "--%" GST_TIME_FORMAT "[",
+        run->key, GST_TIME_ARGS (run->start), GST_TIME_ARGS (run->stop));
+
+    cache->size -= run->size;
+    cache->runs = g_list_delete_link (cache->runs, last);
+    run_free (run);
+  }
+}
+
+/**
+ * gnl_cache_set_budget:
+ * @cache: a #GnlCache
+ * @budget: maximum size of the cached buffers, in bytes
+ *
+ * Sets the budget of @cache, evicting runs if needed. A budget of 0 empties
+ * the cache and disables it.
+ */
+void
+gnl_cache_set_budget (GnlCache * cache, guint64 budget)
+{
+  g_mutex_lock (cache->lock);
+  cache->budget = budget;
+  evict (cache);
+  g_mutex_unlock (cache->lock);
+}
+
+guint64
+gnl_cache_get_budget (GnlCache * cache)
+{
+  guint64 ret;
+
+  g_mutex_lock (cache->lock);
+  ret = cache->budget;
+  g_mutex_unlock (cache->lock);
+
+  return ret;
+}
+
+void
+gnl_cache_get_stats (GnlCache * cache, guint * hits, guint * misses,
+    guint64 * size)
+{
+  g_mutex_lock (cache->lock);
+  if (hits)
+    *hits = cache->hits;
+  if (misses)
+    *misses = cache->misses;
+  if (size)
+    *size = cache->size;
+  g_mutex_unlock (cache->lock);
+}
+
+/**
+ * gnl_cache_add:
+ * @cache: a #GnlCache
+ * @key: identifies the media and stream the buffers were decoded from
+ * @start: media time from which the buffers are complete
+ * @stop: media time up to which the buffers are complete
+ * @buffers: the buffers, sorted by timestamp. Ownership is taken.
+ *
+ * Adds a run of buffers to @cache, replacing the runs of the same @key it
+ * covers entirely. The run is dropped if an existing one already covers it,
+ * or if it is bigger than the budget.
+ */
+void
+gnl_cache_add (GnlCache * cache, const gchar * key, GstClockTime start,
+    GstClockTime stop, GPtrArray * buffers)
+{
+  GnlCacheRun *run;
+  GList *tmp, *next;
+  guint64 size = 0;
+  guint i;
+
+  for (i = 0; i < buffers->len; i++)
+    size += GST_BUFFER_SIZE (g_ptr_array_index (buffers, i));
+
+  g_mutex_lock (cache->lock);
+
+  if (!buffers->len || (stop <= start) || (size > cache->budget))
+    goto drop;
+
+  for (tmp = cache->runs; tmp; tmp = next) {
+    run = (GnlCacheRun *) tmp->data;
+    next = tmp->next;
+
+    if (strcmp (run->key, key))
+      continue;
+
+    if ((run->start <= start) && (run->stop >= stop))
+      goto drop;
+
+    if ((run->start >= start) && (run->stop <= stop)) {
+      cache->size -= run->size;
+      cache->runs = g_list_delete_link (cache->runs, tmp);
+      run_free (run);
+    }
+  }
+
+  GST_DEBUG ("Adding %s [%" GST_TIME_FORMAT "--%" GST_TIME_FORMAT "[, %u "
+      "buffers, %" G_GUINT64_FORMAT " bytes", key, GST_TIME_ARGS (start),
+      GST_TIME_ARGS (stop), buffers->len, size);
+
+  run = g_new0 (GnlCacheRun, 1);
+  run->key = g_strdup (key);
+  run->start = start;
+  run->stop = stop;
+  run->buffers = buffers;
+  run->size = size;
+
+  cache->runs = g_list_prepend (cache->runs, run);
+  cache->size += size;
+  evict (cache);
+
+  g_mutex_unlock (cache->lock);
+  return;
+
+drop:
+  g_mutex_unlock (cache->lock);
+  free_buffers (buffers);
+}
+
+/**
+ * gnl_cache_lookup:
+ * @cache: a #GnlCache
+ * @key: identifies the media and stream to look for
+ * @start: start of the wanted media range
+ * @stop: stop of the wanted media range
+ *
+ * Looks for a run of @key covering [@start, @stop[, and counts a hit or a
+ * miss.
+ *
+ * Returns: A #GPtrArray with a reference on the buffers of the run
+ * overlapping [@start, @stop[, or %NULL if it isn't cached.
+ */
+GPtrArray *
+gnl_cache_lookup (GnlCache * cache, const gchar * key, GstClockTime start,
+    GstClockTime stop)
+{
+  GPtrArray *ret = NULL;
+  GnlCacheRun *run = NULL;
+  GstBuffer *buf;
+  GList *tmp;
+  guint i;
+
+  g_mutex_lock (cache->lock);
+
+  for (tmp = cache->runs; tmp; tmp = tmp->next) {
+    run = (GnlCacheRun *) tmp->data;
+
+    if ((run->start <= start) && (run->stop >= stop) && !strcmp (run->key, key))
+      break;
+  }
+
+  if (!tmp) {
+    cache->misses++;
+    goto beach;
+  }
+
+  cache->hits++;
+
+  /* most recently used */
+  cache->runs = g_list_remove_link (cache->runs, tmp);
+  cache->runs = g_list_concat (tmp, cache->runs);
+
+  ret = g_ptr_array_new ();
+  for (i = 0; i < run->buffers->len; i++) {
+    buf = GST_BUFFER (g_ptr_array_index (run->buffers, i));
+
+    if (GST_BUFFER_TIMESTAMP (buf) >= stop)
+      break;
+    if (GST_BUFFER_TIMESTAMP (buf) + GST_BUFFER_DURATION (buf) > start)
+      g_ptr_array_add (ret, gst_buffer_ref (buf));
+  }
+
+beach:
+  GST_DEBUG ("%s [%" GST_TIME_FORMAT "--%" GST_TIME_FORMAT "[ : %s", key,
+      GST_TIME_ARGS (start), GST_TIME_ARGS (stop), ret ? "hit" : "miss");
+
+  g_mutex_unlock (cache->lock);
+
+  return ret;
+}
@@ -0,0 +1,51 @@
+/* Gnonlin
+ *
+ * gnlcache.h: Header for the decoded buffer cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GNL_CACHE_H__
+#define __GNL_CACHE_H__
+
+#include <gst/gst.h>
+
+#include "gnltypes.h"
+
+G_BEGIN_DECLS
+
+GnlCache *gnl_cache_new (void);
+
+GnlCache *gnl_cache_ref (GnlCache * cache);
+
+void gnl_cache_unref (GnlCache * cache);
+
+void gnl_cache_set_budget (GnlCache * cache, guint64 budget);
+
+guint64 gnl_cache_get_budget (GnlCache * cache);
+
+void gnl_cache_get_stats (GnlCache * cache, guint * hits, guint * misses,
+    guint64 * size);
+
+void gnl_cache_add (GnlCache * cache, const gchar * key, GstClockTime start,
+    GstClockTime stop, GPtrArray * buffers);
+
+GPtrArray *gnl_cache_lookup (GnlCache * cache, const gchar * key,
+    GstClockTime start, GstClockTime stop);
+
+G_END_DECLS
+#endif /* __GNL_CACHE_H__ */
@@ -23,6 +23,7 @@
 #endif
 
 #include "gnl.h"
+#include "gnlmarshal.h"
 
 /**
  * SECTION:element-gnlcomposition
@@ -49,41 +50,127 @@ GST_STATIC_PAD_TEMPLATE ("src",
 GST_DEBUG_CATEGORY_STATIC (gnlcomposition);
 #define GST_CAT_DEFAULT gnlcomposition
 
+enum
+{
+  ARG_0,
+  ARG_SMART_RENDER,
+  ARG_RENDER_MODE,
+  ARG_LOOKAHEAD,
+  ARG_PREFETCH_HITS,
+  ARG_PREFETCH_MISSES,
+  ARG_RETENTION_WINDOW,
+  ARG_GAP_BUFFER,
+  ARG_MASTER,
+  ARG_CACHE_BUDGET,
+  ARG_CACHE_HITS,
+  ARG_CACHE_MISSES,
+  ARG_DEGRADE,
+  ARG_DEGRADED,
+  ARG_PROXY,
+};
+
+/* Number of consecutive late QoS events after which optional objects are
+ * left out, and of consecutive on-time ones after which they are used
+ * again */
+#define DEGRADE_LATE_QOS 10
+#define RESTORE_ONTIME_QOS 100
+
+/* Maximum number of threads prefetching files, shared by all compositions */
+#define MAX_PREFETCH_THREADS 2
+
+typedef enum
+{
+  PREFETCH_NONE,
+  PREFETCH_PENDING,
+  PREFETCH_DONE
+} GnlPrefetchState;
+
+typedef struct
+{
+  GnlComposition *comp;
+  GnlObject *object;
+} GnlPrefetchJob;
+
+static GStaticMutex prefetch_lock = G_STATIC_MUTEX_INIT;
+static GThreadPool *prefetch_pool = NULL;
+
+enum
+{
+  GET_PARTITIONS_SIGNAL,
+  CLONE_SIGNAL,
+  QUERY_RANGE_SIGNAL,
+  GET_SCHEDULE_SIGNAL,
+  EXTRACT_FRAMES_SIGNAL,
+  LAST_SIGNAL
+};
+
+static guint _signals[LAST_SIGNAL] = { 0 };
+
 struct _GnlCompositionPrivate
 {
   gboolean dispose_has_run;
 
   /* 
-     Sorted List of GnlObjects , ThreadSafe 
+     Sorted sequences of GnlObjects , ThreadSafe 
      objects_start : sorted by start-time then priority
      objects_stop : sorted by stop-time then priority
      objects_hash : contains signal handlers id for controlled objects
-     objects_lock : mutex to acces/modify any of those lists/hashtable
+     objects_lock : mutex to acces/modify any of those sequences/hashtable
    */
-  GList *objects_start;
-  GList *objects_stop;
+  GSequence *objects_start;
+  GSequence *objects_stop;
   GHashTable *objects_hash;
   GMutex *objects_lock;
 
   /*
      thread-safe Seek handling.
-     flushing_lock : mutex to access flushing and pending_idle
+     flushing_lock : mutex to access flushing, pending_idle and pending_eos
      flushing : 
      pending_idle :
+     pending_eos : EOS to handle in eos_pool (render-mode)
+     eos_pool : worker handling the EOS in render-mode, with a single
+       thread. Created in READY->PAUSED and joined in PAUSED->READY
    */
   GMutex *flushing_lock;
   gboolean flushing;
   guint pending_idle;
+  gboolean pending_eos;
+  GThreadPool *eos_pool;
+
+  /* Held by the eos_pool worker while switching stacks, and while
+   * resetting, so they never modify the stack or the ghostpad at the same
+   * time */
+  GMutex *eos_lock;
 
   /* source top-level ghostpad */
   GstPad *ghostpad;
   guint ghosteventprobe;
 
+  /* caps of the buffers last output, and the equal caps last replaced by
+   * them. Only used from the streaming thread */
+  GstCaps *outcaps;
+  GstCaps *replacedcaps;
+
   /* current stack, list of GnlObject* */
   GNode *current;
 
   GnlObject *defaultobject;
 
+  /* Internal default object filling gaps with the gap-buffer, and the
+   * GnlBufferSrc it controls */
+  GnlObject *gapobject;
+  GstElement *gapsrc;
+
+  /* Composition whose stack boundaries we also switch stacks at */
+  GnlComposition *master;
+
+  /* Number of compositions following us, and the sorted GstClockTime stack
+   * boundaries published for them (only when followed). boundaries_lock is
+   * never held while taking another lock */
+  gint followers;
+  GMutex *boundaries_lock;
+  GArray *boundaries;
+
   /*
      current segment seek start/stop time. 
      Reconstruct pipeline ONLY if seeking outside of those values
@@ -107,9 +194,60 @@ struct _GnlCompositionPrivate
      We are called before gnl_object_sync_handler
    */
   GstPadEventFunction gnl_event_pad_func;
-
+  GstPadQueryFunction gnl_query_pad_func;
+  GstPadChainFunction gnl_chain_pad_func;
+
+  /* Highest minimum latency reported downstream, GST_CLOCK_TIME_NONE if it
+   * wasn't queried yet. Protected by the object lock */
+  GstClockTime latency;
+
+  /* Post gnl-smart-render messages on stack changes. The message of the
+   * new stack is completed and posted when its first buffer is output.
+   * Protected by the object lock */
+  gboolean smart_render;
+  GstStructure *smart_render_pending;
+
+  /* Switch stacks from the streaming thread instead of the main context */
+  gboolean render_mode;
+
+  /* Prefetch the files of the objects starting less than lookahead after
+   * the current stack */
+  GstClockTime lookahead;
+  guint prefetch_hits;
+  guint prefetch_misses;
+
+  /* Objects stopping more than retention_window before the current
+   * position are removed */
+  GstClockTime retention_window;
+  /* start of the composition when objects were first expired, it stays the
+   * start even once the first objects are removed */
+  GstClockTime expired_start;
+
+  /* Decoded buffers shared by the sources of this composition and of the
+   * compositions it contains */
+  GnlCache *cache;
+
+  /* Leave out optional objects when playback is persistently late. The
+   * counts of consecutive late and on-time QoS events, and degraded, are
+   * protected by the objects_lock */
+  gboolean degrade;
+  gboolean degraded;
+  guint late_qos;
+  guint ontime_qos;
+
+  /* File sources use their proxy media */
+  gboolean proxy;
+
+  /* List of GnlScheduleEntry sorted by start, only containing up-to-date
+   * entries, and the composition stop it was computed for.
+   * Protected by the objects_lock */
+  GList *schedule;
+  GstClockTime schedule_stop;
 };
 
+#define OBJECT_IS_USED(comp,object) \
+  ((object)->active && !((object)->optional && (comp)->private->degraded))
+
 #define OBJECT_IN_ACTIVE_SEGMENT(comp,element) \
   (((((GnlObject*)element)->start >= comp->private->segment_start) && \
     (((GnlObject*)element)->start < comp->private->segment_stop)) ||	\
@@ -120,6 +258,20 @@ static void gnl_composition_dispose (GObject * object);
 static void gnl_composition_finalize (GObject * object);
 static void gnl_composition_reset (GnlComposition * comp);
 
+static void gnl_composition_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gnl_composition_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GValueArray *gnl_composition_get_partitions (GnlComposition * comp,
+    guint n);
+static GstElement *gnl_composition_clone (GnlComposition * comp);
+static GValueArray *gnl_composition_query_range (GnlComposition * comp,
+    guint64 start, guint64 stop, guint minprio, guint maxprio);
+static GValueArray *gnl_composition_get_schedule (GnlComposition * comp);
+static GValueArray *gnl_composition_extract_frames (GnlComposition * comp,
+    GValueArray * timestamps);
+
 static gboolean gnl_composition_add_object (GstBin * bin, GstElement * element);
 
 static void gnl_composition_handle_message (GstBin * bin, GstMessage * message);
@@ -130,8 +282,25 @@ gnl_composition_remove_object (GstBin * bin, GstElement * element);
 static GstStateChangeReturn
 gnl_composition_change_state (GstElement * element, GstStateChange transition);
 
+static gboolean gnl_composition_send_event (GstElement * element,
+    GstEvent * event);
+
 static GstPad *get_src_pad (GstElement * element);
 static void pad_blocked (GstPad * pad, gboolean blocked, GnlComposition * comp);
+static void check_stack_latency (GnlComposition * comp, GstPad * pad);
+static void set_degraded (GnlComposition * comp, gboolean degraded);
+static void invalidate_schedule (GnlComposition * comp, GstClockTime start,
+    GstClockTime stop);
+static void refresh_schedule (GnlComposition * comp);
+static void publish_boundaries (GnlComposition * comp);
+static void timeline_changed (GnlComposition * comp);
+
+static gint objects_start_compare (GnlObject * a, GnlObject * b,
+    gpointer udata);
+static gint objects_start_search (GnlObject * object, GstClockTime * time,
+    gpointer udata);
+static gint objects_stop_search (GnlObject * object, GstClockTime * time,
+    gpointer udata);
 
 static gboolean
 seek_handling (GnlComposition * comp, gboolean initial, gboolean update);
@@ -193,6 +362,19 @@ struct _GnlCompositionEntry
   gulong stophandler;
   gulong priorityhandler;
   gulong activehandler;
+  gulong opaquehandler;
+  gulong optionalhandler;
+
+  /* position of the object in objects_start and objects_stop */
+  GSequenceIter *start_iter;
+  GSequenceIter *stop_iter;
+
+  /* whether the object is being, or was, prefetched since it was last used */
+  GnlPrefetchState prefetched;
+
+  /* start/stop the schedule was last invalidated for */
+  GstClockTime start;
+  GstClockTime stop;
 
   /* handler id for 'no-more-pads' signal */
   gulong nomorepadshandler;
@@ -200,6 +382,17 @@ struct _GnlCompositionEntry
   gulong padremovedhandler;
 };
 
+typedef struct _GnlScheduleEntry GnlScheduleEntry;
+
+struct _GnlScheduleEntry
+{
+  GstClockTime start;
+  GstClockTime stop;
+
+  /* stack used in [start, stop[, NULL for gaps */
+  GNode *stack;
+};
+
 static void
 gnl_composition_base_init (gpointer g_class)
 {
@@ -224,8 +417,14 @@ gnl_composition_class_init (GnlCompositionClass * klass)
 
   gobject_class->dispose = GST_DEBUG_FUNCPTR (gnl_composition_dispose);
   gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_composition_finalize);
+  gobject_class->set_property =
+      GST_DEBUG_FUNCPTR (gnl_composition_set_property);
+  gobject_class->get_property =
+      GST_DEBUG_FUNCPTR (gnl_composition_get_property);
 
   gstelement_class->change_state = gnl_composition_change_state;
+  gstelement_class->send_event =
+      GST_DEBUG_FUNCPTR (gnl_composition_send_event);
 
   gstbin_class->add_element = GST_DEBUG_FUNCPTR (gnl_composition_add_object);
   gstbin_class->remove_element =
@@ -235,6 +434,336 @@ gnl_composition_class_init (GnlCompositionClass * klass)
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gnl_composition_src_template));
+
+  /**
+   * GnlComposition:smart-render:
+   *
+   * If TRUE, an element message named "gnl-smart-render" is posted every
+   * time a new stack is configured. It contains the "start" and "stop" of
+   * the segment the stack will play, the top-level "object" of the stack,
+   * the "media-start" of that object and whether the stack can "passthrough"
+   * encoded data.
+   *
+   * A stack can be passed through if it only contains a single #GnlSource
+   * outputting encoded data, and if its inpoint is aligned on a keyframe,
+   * that is if its first buffer isn't a delta unit and starts exactly at
+   * "media-start". The message is therefore posted when the first buffer of
+   * the stack is output.
+   *
+   * Combined with the #GnlFileSource:passthrough-caps property, this allows
+   * applications to only decode and re-encode the segments containing cuts
+   * or effects.
+   */
+  g_object_class_install_property (gobject_class, ARG_SMART_RENDER,
+      g_param_spec_boolean ("smart-render", "Smart render",
+          "Post gnl-smart-render messages when the playing stack changes",
+          FALSE, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:render-mode:
+   *
+   * If TRUE, the end of a stack is handled right away by a worker thread
+   * of the composition instead of being deferred to the default
+   * #GMainContext. This allows
+   * rendering a composition in applications not running any main loop, and
+   * removes the latency between two stacks.
+   *
+   * Only use this in pipelines which aren't interactively seeked while
+   * playing, ex: when exporting a timeline as fast as possible.
+   */
+  g_object_class_install_property (gobject_class, ARG_RENDER_MODE,
+      g_param_spec_boolean ("render-mode", "Render mode",
+          "Switch stacks from the streaming thread (no main loop needed)",
+          FALSE, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:lookahead:
+   *
+   * Every time a new stack is configured, the files of the #GnlFileSource
+   * starting less than lookahead nanoseconds after the end of it are
+   * prefetched with gnl_filesource_prefetch(), to avoid stalling on I/O when
+   * they start being used. Prefetching is done by a pool of worker threads,
+   * never by the streaming thread.
+   *
+   * 0 (the default) disables prefetching.
+   */
+  g_object_class_install_property (gobject_class, ARG_LOOKAHEAD,
+      g_param_spec_uint64 ("lookahead", "Lookahead",
+          "How long in advance (in ns) to prefetch the files of upcoming "
+          "objects (0 = disabled)", 0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:prefetch-hits:
+   *
+   * Number of #GnlFileSource which were successfully prefetched before being
+   * used.
+   */
+  g_object_class_install_property (gobject_class, ARG_PREFETCH_HITS,
+      g_param_spec_uint ("prefetch-hits", "Prefetch hits",
+          "Number of file sources prefetched before being used",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  /**
+   * GnlComposition:prefetch-misses:
+   *
+   * Number of #GnlFileSource which were used without having been prefetched,
+   * because the prefetch failed or hadn't completed yet.
+   */
+  g_object_class_install_property (gobject_class, ARG_PREFETCH_MISSES,
+      g_param_spec_uint ("prefetch-misses", "Prefetch misses",
+          "Number of file sources used without having been prefetched",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  /**
+   * GnlComposition:retention-window:
+   *
+   * When set, objects whose stop is more than retention-window nanoseconds
+   * before the current position are automatically removed from the
+   * composition (and freed if nothing else holds a reference to them) every
+   * time a new stack is configured. The start of the composition isn't
+   * changed by those removals.
+   *
+   * This keeps memory usage and stack lookup costs bounded in compositions
+   * which are played continuously while new objects are appended to them.
+   *
+   * GST_CLOCK_TIME_NONE (the default) disables automatic removal.
+   */
+  g_object_class_install_property (gobject_class, ARG_RETENTION_WINDOW,
+      g_param_spec_uint64 ("retention-window", "Retention window",
+          "Remove objects stopping this long (in ns) before the current "
+          "position (GST_CLOCK_TIME_NONE = never)",
+          0, G_MAXUINT64, GST_CLOCK_TIME_NONE, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:gap-buffer:
+   *
+   * A #GstBuffer (ex: a black frame or a chunk of silence) which is output
+   * wherever no object is playing, instead of having to add a default
+   * source. The buffer must have caps and a valid, non-zero, duration.
+   *
+   * The buffers pushed in the gaps share the data of this buffer and have
+   * the GST_BUFFER_FLAG_GAP flag set. Nothing is decoded or prerolled.
+   *
+   * Can't be used if a default source (priority G_MAXUINT32) was added.
+   */
+  g_object_class_install_property (gobject_class, ARG_GAP_BUFFER,
+      gst_param_spec_mini_object ("gap-buffer", "Gap buffer",
+          "Buffer to repeat in the gaps of the composition",
+          GST_TYPE_BUFFER, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:master:
+   *
+   * Another #GnlComposition (ex: the video composition of an edit, for its
+   * audio composition) whose stack changes this composition should follow.
+   * Every stack configured by this composition stops at the next stack
+   * boundary of the master, so that both switch stacks at the same
+   * positions.
+   */
+  g_object_class_install_property (gobject_class, ARG_MASTER,
+      g_param_spec_object ("master", "Master",
+          "Composition whose stack boundaries this composition follows",
+          GNL_TYPE_COMPOSITION, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:cache-budget:
+   *
+   * Maximum size (in bytes) of the decoded buffers kept in memory for the
+   * sources of this composition having a #GnlSource:cache-key. Sources
+   * whose whole media range was already decoded by another source with the
+   * same key output the cached buffers instead of decoding them again.
+   * Least recently used ranges are dropped first.
+   *
+   * Only the budget of the outermost composition is used, nested
+   * compositions share its cache.
+   *
+   * 0 (the default) disables the cache.
+   */
+  g_object_class_install_property (gobject_class, ARG_CACHE_BUDGET,
+      g_param_spec_uint64 ("cache-budget", "Cache budget",
+          "Maximum size (in bytes) of the cached decoded buffers "
+          "(0 = disabled)", 0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:cache-hits:
+   *
+   * Number of sources which output cached buffers instead of decoding.
+   */
+  g_object_class_install_property (gobject_class, ARG_CACHE_HITS,
+      g_param_spec_uint ("cache-hits", "Cache hits",
+          "Number of sources served from the decoded buffer cache",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  /**
+   * GnlComposition:cache-misses:
+   *
+   * Number of sources with a cache key which had to decode their media.
+   */
+  g_object_class_install_property (gobject_class, ARG_CACHE_MISSES,
+      g_param_spec_uint ("cache-misses", "Cache misses",
+          "Number of sources which weren't found in the decoded buffer cache",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  /**
+   * GnlComposition:degrade:
+   *
+   * If TRUE, the composition follows the QoS events sent by downstream. When
+   * playback is persistently late, the objects with the #GnlObject:optional
+   * property set are left out of the stacks, and the #GnlFileSource use
+   * their proxy media (see #GnlComposition:proxy), until playback has caught
+   * up. The change only applies from the next stack switch, the current
+   * stack isn't rebuilt.
+   *
+   * Meant for previewing on slow machines, not for rendering.
+   */
+  g_object_class_install_property (gobject_class, ARG_DEGRADE,
+      g_param_spec_boolean ("degrade", "Degrade",
+          "Leave out optional objects when playback is late",
+          FALSE, G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition:degraded:
+   *
+   * TRUE while optional objects are being left out.
+   */
+  g_object_class_install_property (gobject_class, ARG_DEGRADED,
+      g_param_spec_boolean ("degraded", "Degraded",
+          "Whether optional objects are currently left out",
+          FALSE, G_PARAM_READABLE));
+
+  /**
+   * GnlComposition:proxy:
+   *
+   * Sets the #GnlFileSource:use-proxy property of all the #GnlFileSource of
+   * the composition (and of the compositions it contains), including the
+   * ones added later on. Previews can then decode low-resolution proxy
+   * files, and renders the original media, without rebuilding the timeline.
+   *
+   * Each source switches the next time it is activated, the current stack
+   * keeps on playing the same media.
+   */
+  g_object_class_install_property (gobject_class, ARG_PROXY,
+      g_param_spec_boolean ("proxy", "Proxy",
+          "Make the file sources use their proxy media", FALSE,
+          G_PARAM_READWRITE));
+
+  /**
+   * GnlComposition::get-partitions:
+   * @comp: a #GnlComposition
+   * @n: the maximum number of partitions
+   *
+   * Action signal splitting the timeline in at most @n consecutive ranges of
+   * similar duration. All boundaries are stack boundaries, so that each range
+   * can be rendered independently by seeking a separate copy of the
+   * composition to it, and the results concatenated in order.
+   *
+   * Returns: a #GValueArray of guint64 boundaries, the first one being the
+   * start of the timeline and the last one its stop. Free with
+   * g_value_array_free().
+   */
+  _signals[GET_PARTITIONS_SIGNAL] =
+      g_signal_new ("get-partitions", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GnlCompositionClass, get_partitions), NULL, NULL,
+      gnl_marshal_BOXED__UINT, G_TYPE_VALUE_ARRAY, 1, G_TYPE_UINT);
+
+  /**
+   * GnlComposition::clone:
+   * @comp: a #GnlComposition
+   *
+   * Action signal creating a new composition with copies of all the objects
+   * contained in @comp, ex: to render it in the background while @comp keeps
+   * being edited. Only the timeline information is copied, the elements
+   * doing the actual work are only created once the copy is used.
+   *
+   * Only the properties of the objects are copied, not the composition-level
+   * settings (ex: #GnlComposition:master), except the
+   * #GnlComposition:gap-buffer. Hand-made #GstBin controlled by sources or
+   * operations are copied with their children, links and ghost pads, but
+   * not the pads or elements they add dynamically.
+   *
+   * Returns: the new #GnlComposition, or %NULL if one of the objects could
+   * not be copied (elements which weren't created by a factory).
+   */
+  _signals[CLONE_SIGNAL] =
+      g_signal_new ("clone", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GnlCompositionClass, clone), NULL, NULL,
+      gnl_marshal_OBJECT__VOID, GST_TYPE_ELEMENT, 0);
+
+  /**
+   * GnlComposition::query-range:
+   * @comp: a #GnlComposition
+   * @start: start of the range
+   * @stop: stop of the range
+   * @minprio: lowest priority value
+   * @maxprio: highest priority value
+   *
+   * Action signal returning the objects overlapping [@start, @stop[ whose
+   * priority is between @minprio and @maxprio (included), sorted by start
+   * and priority. Inactive objects are also returned.
+   *
+   * Returns: a #GValueArray of #GnlObject. Free with g_value_array_free().
+   */
+  _signals[QUERY_RANGE_SIGNAL] =
+      g_signal_new ("query-range", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GnlCompositionClass, query_range), NULL, NULL,
+      gnl_marshal_BOXED__UINT64_UINT64_UINT_UINT, G_TYPE_VALUE_ARRAY, 4,
+      G_TYPE_UINT64, G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_UINT);
+
+  /**
+   * GnlComposition::get-schedule:
+   * @comp: a #GnlComposition
+   *
+   * Action signal returning all the [start, stop[ ranges of the timeline
+   * during which the stack of objects doesn't change, in order. The
+   * schedule is cached and only the ranges touched by edits since the
+   * previous call are computed again.
+   *
+   * Each range is a #GstStructure named "gnl-schedule-entry" with "start"
+   * and "stop" #guint64 fields and, unless nothing is to be played in that
+   * range, a "stack" #GstStructure field. Stack nodes are #GstStructure
+   * named "gnl-stack-node" with an "object" #GnlObject field and a
+   * "children" #GValueArray of stack nodes.
+   *
+   * Returns: a #GValueArray of #GstStructure. Free with g_value_array_free().
+   */
+  _signals[GET_SCHEDULE_SIGNAL] =
+      g_signal_new ("get-schedule", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GnlCompositionClass, get_schedule), NULL, NULL,
+      gnl_marshal_BOXED__VOID, G_TYPE_VALUE_ARRAY, 0);
+
+  /**
+   * GnlComposition::extract-frames:
+   * @comp: a #GnlComposition
+   * @timestamps: a #GValueArray of sorted #guint64 timeline positions
+   *
+   * Action signal returning the frame output by the composition at each of
+   * the @timestamps (ex: for thumbnail strips), without disturbing the
+   * pipeline the composition is in.
+   *
+   * A copy of the composition is played in a private pipeline. Timestamps
+   * close to each other are reached by decoding forward from the previous
+   * one instead of seeking, so that each region (and the stacks in it) is
+   * only decoded and built once.
+   *
+   * Returns: a #GValueArray with one #GstBuffer (or NULL if it couldn't be
+   * extracted) per timestamp, or NULL if @timestamps isn't sorted. Free with
+   * g_value_array_free().
+   */
+  _signals[EXTRACT_FRAMES_SIGNAL] =
+      g_signal_new ("extract-frames", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GnlCompositionClass, extract_frames), NULL, NULL,
+      gnl_marshal_BOXED__BOXED, G_TYPE_VALUE_ARRAY, 1, G_TYPE_VALUE_ARRAY);
+
+  klass->get_partitions = GST_DEBUG_FUNCPTR (gnl_composition_get_partitions);
+  klass->get_schedule = GST_DEBUG_FUNCPTR (gnl_composition_get_schedule);
+  klass->query_range = GST_DEBUG_FUNCPTR (gnl_composition_query_range);
+  klass->clone = GST_DEBUG_FUNCPTR (gnl_composition_clone);
+  klass->extract_frames = GST_DEBUG_FUNCPTR (gnl_composition_extract_frames);
 }
 
 static void
@@ -247,6 +776,8 @@ hash_value_destroy (GnlCompositionEntry * entry)
   if (entry->priorityhandler)
     g_signal_handler_disconnect (entry->object, entry->priorityhandler);
   g_signal_handler_disconnect (entry->object, entry->activehandler);
+  g_signal_handler_disconnect (entry->object, entry->opaquehandler);
+  g_signal_handler_disconnect (entry->object, entry->optionalhandler);
   g_signal_handler_disconnect (entry->object, entry->padremovedhandler);
   g_signal_handler_disconnect (entry->object, entry->padaddedhandler);
 
@@ -255,6 +786,14 @@ hash_value_destroy (GnlCompositionEntry * entry)
   g_free (entry);
 }
 
+static void
+schedule_entry_free (GnlScheduleEntry * entry)
+{
+  if (entry->stack)
+    g_node_destroy (entry->stack);
+  g_free (entry);
+}
+
 static void
 gnl_composition_init (GnlComposition * comp,
     GnlCompositionClass * klass G_GNUC_UNUSED)
@@ -263,11 +802,18 @@ gnl_composition_init (GnlComposition * comp,
 
   comp->private = g_new0 (GnlCompositionPrivate, 1);
   comp->private->objects_lock = g_mutex_new ();
-  comp->private->objects_start = NULL;
-  comp->private->objects_stop = NULL;
-
+  comp->private->objects_start = g_sequence_new (NULL);
+  comp->private->objects_stop = g_sequence_new (NULL);
+
+  comp->private->retention_window = GST_CLOCK_TIME_NONE;
+  comp->private->expired_start = GST_CLOCK_TIME_NONE;
+  comp->private->boundaries_lock = g_mutex_new ();
+  comp->private->boundaries = g_array_new (FALSE, FALSE,
+      sizeof (GstClockTime));
+  comp->private->cache = gnl_cache_new ();
   comp->private->flushing_lock = g_mutex_new ();
   comp->private->flushing = FALSE;
+  comp->private->eos_lock = g_mutex_new ();
   comp->private->pending_idle = 0;
 
   comp->private->segment = gst_segment_new ();
@@ -310,6 +856,19 @@ gnl_composition_dispose (GObject * object)
     comp->private->current = NULL;
   }
 
+  if (comp->private->master) {
+    g_atomic_int_add (&comp->private->master->private->followers, -1);
+    gst_object_unref (comp->private->master);
+    comp->private->master = NULL;
+  }
+
+  gst_caps_replace (&comp->private->outcaps, NULL);
+  gst_caps_replace (&comp->private->replacedcaps, NULL);
+  if (comp->private->smart_render_pending) {
+    gst_structure_free (comp->private->smart_render_pending);
+    comp->private->smart_render_pending = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -321,10 +880,12 @@ gnl_composition_finalize (GObject * object)
   GST_INFO ("finalize");
 
   COMP_OBJECTS_LOCK (comp);
-  g_list_free (comp->private->objects_start);
-  g_list_free (comp->private->objects_stop);
+  g_sequence_free (comp->private->objects_start);
+  g_sequence_free (comp->private->objects_stop);
   if (comp->private->current)
     g_node_destroy (comp->private->current);
+  g_list_foreach (comp->private->schedule, (GFunc) schedule_entry_free, NULL);
+  g_list_free (comp->private->schedule);
   g_hash_table_destroy (comp->private->objects_hash);
   COMP_OBJECTS_UNLOCK (comp);
 
@@ -332,13 +893,274 @@ gnl_composition_finalize (GObject * object)
   gst_segment_free (comp->private->segment);
 
   g_mutex_free (comp->private->flushing_lock);
+  g_mutex_free (comp->private->eos_lock);
+
+  g_mutex_free (comp->private->boundaries_lock);
+  g_array_free (comp->private->boundaries, TRUE);
 
+  gnl_cache_unref (comp->private->cache);
 
   g_free (comp->private);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/*
+ * gnl_composition_set_gap_buffer:
+ *
+ * Creates, updates or removes the internal gap object.
+ */
+
+static void
+gnl_composition_set_gap_buffer (GnlComposition * comp, GstBuffer * buffer)
+{
+  GstElement *gapobject;
+  GstElement *gapsrc;
+  GstPad *pad;
+
+  if (buffer && (!GST_BUFFER_DURATION_IS_VALID (buffer)
+          || !GST_BUFFER_DURATION (buffer))) {
+    GST_WARNING_OBJECT (comp, "The gap buffer must have a non-zero duration");
+    return;
+  }
+
+  if (comp->private->gapobject) {
+    if (buffer) {
+      g_object_set (comp->private->gapsrc, "buffer", buffer, NULL);
+      return;
+    }
+
+    GST_DEBUG_OBJECT (comp, "Removing gap object");
+    gapobject = gst_object_ref (comp->private->gapobject);
+    gst_bin_remove (GST_BIN (comp), gapobject);
+    gst_element_set_state (gapobject, GST_STATE_NULL);
+    gst_object_unref (gapobject);
+    return;
+  }
+
+  if (!buffer)
+    return;
+
+  if (comp->private->defaultobject) {
+    GST_WARNING_OBJECT (comp,
+        "We already have a default source, can't use a gap buffer");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (comp, "Creating gap object");
+
+  /* A plain GnlObject directly ghosting the always pad of the GnlBufferSrc:
+   * there's no pad to wait for or seek before using it, unlike with a
+   * GnlSource */
+  gapobject = (GstElement *) g_object_new (GNL_TYPE_OBJECT, NULL);
+  GST_OBJECT_FLAG_SET (gapobject, GNL_OBJECT_SOURCE);
+  g_object_set (gapobject, "priority", G_MAXUINT32,
+      "start", (guint64) 0, "media-start", (guint64) 0,
+      "duration", (gint64) GNL_OBJECT (comp)->stop,
+      "media-duration", (gint64) GNL_OBJECT (comp)->stop, NULL);
+  if (GST_BUFFER_CAPS (buffer))
+    g_object_set (gapobject, "caps", GST_BUFFER_CAPS (buffer), NULL);
+
+  gapsrc = (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  g_object_set (gapsrc, "buffer", buffer, "gap", TRUE, NULL);
+  gst_bin_add (GST_BIN (gapobject), gapsrc);
+
+  pad = gst_element_get_static_pad (gapsrc, "src");
+  gnl_object_ghost_pad ((GnlObject *) gapobject, "src", pad);
+  gst_object_unref (pad);
+
+  comp->private->gapobject = (GnlObject *) gapobject;
+  comp->private->gapsrc = gapsrc;
+
+  if (!gst_bin_add (GST_BIN (comp), gapobject)) {
+    comp->private->gapobject = NULL;
+    comp->private->gapsrc = NULL;
+  }
+}
+
+static void
+gnl_composition_set_master (GnlComposition * comp, GnlComposition * master)
+{
+  GnlComposition *tmp;
+
+  /* refuse loops, we'd deadlock taking the OBJECTS_LOCKs */
+  for (tmp = master; tmp; tmp = tmp->private->master)
+    if (tmp == comp) {
+      GST_WARNING_OBJECT (comp, "Can't follow %s, it follows us",
+          GST_OBJECT_NAME (master));
+      return;
+    }
+
+  COMP_OBJECTS_LOCK (comp);
+  if ((tmp = comp->private->master))
+    g_atomic_int_add (&tmp->private->followers, -1);
+  comp->private->master = master ? gst_object_ref (master) : NULL;
+  COMP_OBJECTS_UNLOCK (comp);
+
+  if (tmp)
+    gst_object_unref (tmp);
+
+  /* Have the master publish its boundaries, we never take its OBJECTS_LOCK
+   * while holding ours */
+  if (master) {
+    g_atomic_int_inc (&master->private->followers);
+    COMP_OBJECTS_LOCK (master);
+    publish_boundaries (master);
+    COMP_OBJECTS_UNLOCK (master);
+  }
+}
+
+/* File sources also use their proxy media in degraded mode */
+static void
+apply_proxy (GnlObject * object, GnlComposition * comp)
+{
+  gboolean proxy = comp->private->proxy || comp->private->degraded;
+
+  if (GNL_IS_FILESOURCE (object))
+    g_object_set (object, "use-proxy", proxy, NULL);
+  else if (GNL_IS_COMPOSITION (object))
+    g_object_set (object, "proxy", proxy, NULL);
+}
+
+/* Call with the objects lock taken */
+static void
+apply_proxy_all (GnlComposition * comp)
+{
+  g_sequence_foreach (comp->private->objects_start, (GFunc) apply_proxy, comp);
+  if (comp->private->defaultobject)
+    apply_proxy (comp->private->defaultobject, comp);
+}
+
+static void
+gnl_composition_set_proxy (GnlComposition * comp, gboolean proxy)
+{
+  COMP_OBJECTS_LOCK (comp);
+  comp->private->proxy = proxy;
+  apply_proxy_all (comp);
+  COMP_OBJECTS_UNLOCK (comp);
+}
+
+static void
+gnl_composition_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GnlComposition *comp = (GnlComposition *) object;
+
+  switch (prop_id) {
+    case ARG_SMART_RENDER:
+      comp->private->smart_render = g_value_get_boolean (value);
+      break;
+    case ARG_RENDER_MODE:
+      comp->private->render_mode = g_value_get_boolean (value);
+      break;
+    case ARG_LOOKAHEAD:
+      comp->private->lookahead = g_value_get_uint64 (value);
+      break;
+    case ARG_RETENTION_WINDOW:
+      comp->private->retention_window = g_value_get_uint64 (value);
+      break;
+    case ARG_GAP_BUFFER:
+      gnl_composition_set_gap_buffer (comp,
+          (GstBuffer *) gst_value_get_mini_object (value));
+      break;
+    case ARG_MASTER:
+      gnl_composition_set_master (comp, g_value_get_object (value));
+      break;
+    case ARG_CACHE_BUDGET:
+      gnl_cache_set_budget (comp->private->cache, g_value_get_uint64 (value));
+      break;
+    case ARG_DEGRADE:
+      comp->private->degrade = g_value_get_boolean (value);
+      if (!comp->private->degrade)
+        set_degraded (comp, FALSE);
+      break;
+    case ARG_PROXY:
+      gnl_composition_set_proxy (comp, g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gnl_composition_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GnlComposition *comp = (GnlComposition *) object;
+
+  switch (prop_id) {
+    case ARG_SMART_RENDER:
+      g_value_set_boolean (value, comp->private->smart_render);
+      break;
+    case ARG_RENDER_MODE:
+      g_value_set_boolean (value, comp->private->render_mode);
+      break;
+    case ARG_LOOKAHEAD:
+      g_value_set_uint64 (value, comp->private->lookahead);
+      break;
+    case ARG_PREFETCH_HITS:
+      g_value_set_uint (value, comp->private->prefetch_hits);
+      break;
+    case ARG_PREFETCH_MISSES:
+      g_value_set_uint (value, comp->private->prefetch_misses);
+      break;
+    case ARG_RETENTION_WINDOW:
+      g_value_set_uint64 (value, comp->private->retention_window);
+      break;
+    case ARG_MASTER:
+      g_value_set_object (value, comp->private->master);
+      break;
+    case ARG_GAP_BUFFER:
+      if (comp->private->gapsrc)
+        g_object_get_property ((GObject *) comp->private->gapsrc, "buffer",
+            value);
+      break;
+    case ARG_CACHE_BUDGET:
+      g_value_set_uint64 (value, gnl_cache_get_budget (comp->private->cache));
+      break;
+    case ARG_CACHE_HITS:{
+      guint hits;
+
+      gnl_cache_get_stats (comp->private->cache, &hits, NULL, NULL);
+      g_value_set_uint (value, hits);
+    }
+      break;
+    case ARG_CACHE_MISSES:{
+      guint misses;
+
+      gnl_cache_get_stats (comp->private->cache, NULL, &misses, NULL);
+      g_value_set_uint (value, misses);
+    }
+      break;
+    case ARG_DEGRADE:
+      g_value_set_boolean (value, comp->private->degrade);
+      break;
+    case ARG_DEGRADED:
+      g_value_set_boolean (value, comp->private->degraded);
+      break;
+    case ARG_PROXY:
+      g_value_set_boolean (value, comp->private->proxy);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/*
+ * gnl_composition_get_cache:
+ *
+ * Returns: A reference on the decoded buffer cache of @comp, to be used by
+ * the sources it contains.
+ */
+
+GnlCache *
+gnl_composition_get_cache (GnlComposition * comp)
+{
+  return gnl_cache_ref (comp->private->cache);
+}
+
 /* signal_duration_change
  * Creates a new GST_MESSAGE_DURATION with the currently configured
  * composition duration and sends that on the bus.
@@ -352,6 +1174,93 @@ signal_duration_change (GnlComposition * comp)
           GST_FORMAT_TIME, ((GnlObject *) comp)->duration));
 }
 
+/* prepare_smart_render_message
+ * Prepares the message telling the application which segment the new stack
+ * will play. Whether it can pass through encoded data is only known once its
+ * first buffer is output, see post_smart_render_message().
+ */
+
+static void
+prepare_smart_render_message (GnlComposition * comp, GNode * stack)
+{
+  GnlObject *object = (GnlObject *) stack->data;
+  GstStructure *structure;
+  GstClockTime mstart;
+
+  if (!gnl_object_to_media_time (object, comp->private->segment_start,
+          &mstart))
+    mstart = object->media_start;
+
+  structure = gst_structure_new ("gnl-smart-render",
+      "start", G_TYPE_UINT64, comp->private->segment_start,
+      "stop", G_TYPE_UINT64, comp->private->segment_stop,
+      "object", GNL_TYPE_OBJECT, object,
+      "media-start", G_TYPE_UINT64, mstart,
+      "passthrough", G_TYPE_BOOLEAN, G_NODE_IS_LEAF (stack)
+      && GNL_IS_SOURCE (object), NULL);
+
+  GST_OBJECT_LOCK (comp);
+  if (comp->private->smart_render_pending)
+    gst_structure_free (comp->private->smart_render_pending);
+  comp->private->smart_render_pending = structure;
+  GST_OBJECT_UNLOCK (comp);
+}
+
+/* post_smart_render_message
+ * Called from the streaming thread with the first buffer of the new stack.
+ * A lone source can only be passed through if it outputs encoded data from
+ * a keyframe located exactly at its inpoint.
+ */
+
+static void
+post_smart_render_message (GnlComposition * comp, GstBuffer * buffer)
+{
+  static GstStaticCaps raw_caps = GST_STATIC_CAPS (GNL_DEFAULT_RAW_CAPS);
+  GstStructure *structure;
+  GstCaps *caps;
+  gboolean passthrough;
+  guint64 mstart;
+
+  GST_OBJECT_LOCK (comp);
+  structure = comp->private->smart_render_pending;
+  comp->private->smart_render_pending = NULL;
+  GST_OBJECT_UNLOCK (comp);
+
+  if (!structure)
+    return;
+
+  gst_structure_get_boolean (structure, "passthrough", &passthrough);
+  gst_structure_get_uint64 (structure, "media-start", &mstart);
+
+  if (passthrough && GST_BUFFER_CAPS (buffer)) {
+    caps = gst_caps_intersect (GST_BUFFER_CAPS (buffer),
+        gst_static_caps_get (&raw_caps));
+    if (!gst_caps_is_empty (caps)) {
+      GST_DEBUG_OBJECT (comp, "decoded data, can't passthrough");
+      passthrough = FALSE;
+    }
+    gst_caps_unref (caps);
+  }
+
+  if (passthrough && (GST_BUFFER_FLAG_IS_SET (buffer,
+              GST_BUFFER_FLAG_DELTA_UNIT)
+          || (GST_BUFFER_TIMESTAMP (buffer) != mstart))) {
+    GST_DEBUG_OBJECT (comp, "inpoint %" GST_TIME_FORMAT " isn't on a "
+        "keyframe, first buffer %" GST_TIME_FORMAT " delta:%d",
+        GST_TIME_ARGS (mstart), GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)),
+        GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+    passthrough = FALSE;
+  }
+
+  gst_structure_set (structure, "passthrough", G_TYPE_BOOLEAN, passthrough,
+      NULL);
+
+  GST_DEBUG_OBJECT (comp, "%" GST_PTR_FORMAT, structure);
+
+  gst_element_post_message (GST_ELEMENT_CAST (comp),
+      gst_message_new_element (GST_OBJECT_CAST (comp), structure));
+}
+
 static gboolean
 unblock_child_pads (GstElement * child, GValue * ret G_GNUC_UNUSED,
     GnlComposition * comp)
@@ -427,6 +1336,8 @@ gnl_composition_reset (GnlComposition * comp)
 {
   GST_DEBUG_OBJECT (comp, "resetting");
 
+  g_mutex_lock (comp->private->eos_lock);
+
   comp->private->segment_start = GST_CLOCK_TIME_NONE;
   comp->private->segment_stop = GST_CLOCK_TIME_NONE;
 
@@ -449,26 +1360,50 @@ gnl_composition_reset (GnlComposition * comp)
 
   comp->private->waitingpads = 0;
 
+  GST_OBJECT_LOCK (comp);
+  comp->private->latency = GST_CLOCK_TIME_NONE;
+  if (comp->private->smart_render_pending) {
+    gst_structure_free (comp->private->smart_render_pending);
+    comp->private->smart_render_pending = NULL;
+  }
+  GST_OBJECT_UNLOCK (comp);
+
+  set_degraded (comp, FALSE);
+
+  gst_caps_replace (&comp->private->outcaps, NULL);
+  gst_caps_replace (&comp->private->replacedcaps, NULL);
+
   unlock_childs (comp);
 
   COMP_FLUSHING_LOCK (comp);
   if (comp->private->pending_idle)
     g_source_remove (comp->private->pending_idle);
   comp->private->pending_idle = 0;
+  comp->private->pending_eos = FALSE;
   comp->private->flushing = FALSE;
   COMP_FLUSHING_UNLOCK (comp);
 
+  g_mutex_unlock (comp->private->eos_lock);
+
   GST_DEBUG_OBJECT (comp, "Composition now resetted");
 }
 
 static gboolean
 eos_main_thread (GnlComposition * comp)
 {
-  /* Set up a non-initial seek on segment_stop */
-  GST_DEBUG_OBJECT (comp,
-      "Setting segment->start to segment_stop:%" GST_TIME_FORMAT,
-      GST_TIME_ARGS (comp->private->segment_stop));
-  comp->private->segment->start = comp->private->segment_stop;
+  if (comp->private->segment->rate < 0.0) {
+    /* Set up a non-initial seek ending on segment_start */
+    GST_DEBUG_OBJECT (comp,
+        "Setting segment->stop to segment_start:%" GST_TIME_FORMAT,
+        GST_TIME_ARGS (comp->private->segment_start));
+    comp->private->segment->stop = comp->private->segment_start;
+  } else {
+    /* Set up a non-initial seek on segment_stop */
+    GST_DEBUG_OBJECT (comp,
+        "Setting segment->start to segment_stop:%" GST_TIME_FORMAT,
+        GST_TIME_ARGS (comp->private->segment_stop));
+    comp->private->segment->start = comp->private->segment_stop;
+  }
 
   seek_handling (comp, TRUE, TRUE);
 
@@ -483,7 +1418,9 @@ eos_main_thread (GnlComposition * comp)
     } else if (comp->private->segment->flags & GST_SEEK_FLAG_SEGMENT) {
       gint64 epos;
 
-      if (GST_CLOCK_TIME_IS_VALID (comp->private->segment->stop))
+      if (comp->private->segment->rate < 0.0)
+        epos = comp->private->segment->start;
+      else if (GST_CLOCK_TIME_IS_VALID (comp->private->segment->stop))
         epos = (MIN (comp->private->segment->stop, ((GnlObject *) comp)->stop));
       else
         epos = (((GnlObject *) comp)->stop);
@@ -498,8 +1435,61 @@ eos_main_thread (GnlComposition * comp)
   return FALSE;
 }
 
+/* Handles the EOS in render-mode, without needing a main loop. Switching
+ * stacks unlinks and seeks the pads the EOS came from, which can't be done
+ * from the streaming thread itself */
+static void
+eos_job (GnlComposition * comp, gpointer unused G_GNUC_UNUSED)
+{
+  gboolean pending;
+
+  g_mutex_lock (comp->private->eos_lock);
+
+  COMP_FLUSHING_LOCK (comp);
+  pending = comp->private->pending_eos;
+  comp->private->pending_eos = FALSE;
+  COMP_FLUSHING_UNLOCK (comp);
+
+  if (pending)
+    eos_main_thread (comp);
+
+  g_mutex_unlock (comp->private->eos_lock);
+}
+
+static void
+start_eos_worker (GnlComposition * comp)
+{
+  COMP_FLUSHING_LOCK (comp);
+  if (!comp->private->eos_pool)
+    comp->private->eos_pool = g_thread_pool_new ((GFunc) eos_job, comp, 1,
+        FALSE, NULL);
+  COMP_FLUSHING_UNLOCK (comp);
+}
+
+/*
+ * stop_eos_worker:
+ *
+ * Drops the EOS not handled yet, and waits for the one being handled.
+ * Further EOS are dropped until start_eos_worker() is called again.
+ */
+
+static void
+stop_eos_worker (GnlComposition * comp)
+{
+  GThreadPool *pool;
+
+  COMP_FLUSHING_LOCK (comp);
+  pool = comp->private->eos_pool;
+  comp->private->eos_pool = NULL;
+  comp->private->pending_eos = FALSE;
+  COMP_FLUSHING_UNLOCK (comp);
+
+  if (pool)
+    g_thread_pool_free (pool, TRUE, TRUE);
+}
+
 static gboolean
-ghost_event_probe_handler (GstPad * ghostpad G_GNUC_UNUSED, GstEvent * event,
+ghost_event_probe_handler (GstPad * ghostpad, GstEvent * event,
     GnlComposition * comp)
 {
   gboolean keepit = TRUE;
@@ -514,8 +1504,11 @@ ghost_event_probe_handler (GstPad * ghostpad G_GNUC_UNUSED, GstEvent * event,
         g_source_remove (comp->private->pending_idle);
       }
       comp->private->pending_idle = 0;
+      comp->private->pending_eos = FALSE;
       comp->private->flushing = FALSE;
       COMP_FLUSHING_UNLOCK (comp);
+
+      check_stack_latency (comp, ghostpad);
     }
       break;
     case GST_EVENT_EOS:{
@@ -528,6 +1521,19 @@ ghost_event_probe_handler (GstPad * ghostpad G_GNUC_UNUSED, GstEvent * event,
       }
       COMP_FLUSHING_UNLOCK (comp);
 
+      if (comp->private->render_mode) {
+        COMP_FLUSHING_LOCK (comp);
+        if (comp->private->eos_pool) {
+          GST_DEBUG_OBJECT (comp, "Adding eos handling to the eos worker");
+          comp->private->pending_eos = TRUE;
+          g_thread_pool_push (comp->private->eos_pool, comp, NULL);
+        } else
+          GST_DEBUG_OBJECT (comp, "Stopping, dropping the eos");
+        COMP_FLUSHING_UNLOCK (comp);
+        keepit = FALSE;
+        break;
+      }
+
       GST_DEBUG_OBJECT (comp, "Adding eos handling to main thread");
       if (comp->private->pending_idle) {
         GST_WARNING_OBJECT (comp,
@@ -535,9 +1541,6 @@ ghost_event_probe_handler (GstPad * ghostpad G_GNUC_UNUSED, GstEvent * event,
         g_source_remove (comp->private->pending_idle);
       }
 
-      /* FIXME : This should be switched to using a g_thread_create() instead
-       * of a g_idle_add(). EXTENSIVE TESTING AND ANALYSIS REQUIRED BEFORE
-       * DOING THE SWITCH !!! */
       comp->private->pending_idle =
           g_idle_add ((GSourceFunc) eos_main_thread, (gpointer) comp);
 
@@ -553,6 +1556,50 @@ ghost_event_probe_handler (GstPad * ghostpad G_GNUC_UNUSED, GstEvent * event,
 
 
 
+/* Consecutive stacks usually output the same format, but with their own caps.
+ * Since pads only compare caps pointers, downstream would be renegotiated
+ * (and sinks would drop their buffers) at every stack switch. Buffers with
+ * caps equal to the previous ones are therefore given the previous caps.
+ *
+ * This replaces the chain function of the ghostpad's internal pad rather than
+ * using a buffer probe: buffers which aren't metadata-writable (ex: shared
+ * with the cache or a GnlMemorySource) have to be replaced by a sub-buffer
+ * to change their caps, and 0.10 buffer probes can't replace the buffer. */
+static GstFlowReturn
+ghost_chain_handler (GstPad * internal, GstBuffer * buffer)
+{
+  /* The internal pad is a child of the ghostpad */
+  GstPad *ghostpad = (GstPad *) GST_OBJECT_PARENT (internal);
+  GnlComposition *comp = (GnlComposition *) GST_OBJECT_PARENT (ghostpad);
+  GstCaps *caps = GST_BUFFER_CAPS (buffer);
+
+  if (G_UNLIKELY (comp->private->smart_render_pending))
+    post_smart_render_message (comp, buffer);
+
+  if (G_UNLIKELY (caps == NULL) || G_LIKELY (caps == comp->private->outcaps))
+    goto beach;
+
+  if ((caps != comp->private->replacedcaps)
+      && !(comp->private->outcaps
+          && gst_caps_is_equal (caps, comp->private->outcaps))) {
+    GST_DEBUG_OBJECT (comp, "new output caps %" GST_PTR_FORMAT, caps);
+    gst_caps_replace (&comp->private->outcaps, caps);
+    gst_caps_replace (&comp->private->replacedcaps, NULL);
+    goto beach;
+  }
+
+  if (caps != comp->private->replacedcaps) {
+    GST_DEBUG_OBJECT (comp, "same output caps, keeping the previous ones");
+    gst_caps_replace (&comp->private->replacedcaps, caps);
+  }
+
+  buffer = gst_buffer_make_metadata_writable (buffer);
+  gst_buffer_set_caps (buffer, comp->private->outcaps);
+
+beach:
+  return comp->private->gnl_chain_pad_func (internal, buffer);
+}
+
 /* Warning : Don't take the objects lock in this method */
 static void
 gnl_composition_handle_message (GstBin * bin, GstMessage * message)
@@ -618,6 +1665,14 @@ have_to_update_pipeline (GnlComposition * comp)
       GST_TIME_ARGS (comp->private->segment_start),
       GST_TIME_ARGS (comp->private->segment_stop));
 
+  if (comp->private->segment->rate < 0.0) {
+    if (COMP_REAL_STOP (comp) > comp->private->segment_stop)
+      return TRUE;
+    if (COMP_REAL_STOP (comp) <= comp->private->segment_start)
+      return TRUE;
+    return FALSE;
+  }
+
   if (comp->private->segment->start < comp->private->segment_start)
     return TRUE;
   if (comp->private->segment->start >= comp->private->segment_stop)
@@ -761,7 +1816,12 @@ seek_handling (GnlComposition * comp, gboolean initial, gboolean update)
   COMP_FLUSHING_UNLOCK (comp);
 
   if (update || have_to_update_pipeline (comp)) {
-    update_pipeline (comp, comp->private->segment->start, initial, TRUE, FALSE);
+    /* In reverse, we play backwards from the end of the segment */
+    if (comp->private->segment->rate < 0.0)
+      update_pipeline (comp, COMP_REAL_STOP (comp), initial, TRUE, FALSE);
+    else
+      update_pipeline (comp, comp->private->segment->start, initial, TRUE,
+          FALSE);
   }
 
   return TRUE;
@@ -801,6 +1861,188 @@ handle_seek_event (GnlComposition * comp, GstEvent * event)
   seek_handling (comp, TRUE, FALSE);
 }
 
+/* Returns the seek to use instead of the step @event if it goes past the
+ * current stack, else NULL */
+static GstEvent *
+step_to_seek_event (GnlComposition * comp, GstPad * ghostpad, GstEvent * event)
+{
+  GstSegment *segment = comp->private->segment;
+  GstFormat format;
+  guint64 amount;
+  gdouble rate;
+  gboolean flush, intermediate;
+  GstClockTime duration, position, target;
+
+  gst_event_parse_step (event, &format, &amount, &rate, &flush,
+      &intermediate);
+
+  if (format == GST_FORMAT_TIME)
+    duration = amount;
+  else if (((format != GST_FORMAT_BUFFERS) && (format != GST_FORMAT_DEFAULT))
+      || !gnl_frames_to_time (ghostpad, amount, &duration))
+    return NULL;
+
+  COMP_OBJECTS_LOCK (comp);
+  position = get_current_position (comp);
+  COMP_OBJECTS_UNLOCK (comp);
+
+  if (!GST_CLOCK_TIME_IS_VALID (position))
+    return NULL;
+
+  GST_DEBUG_OBJECT (comp, "step of %" GST_TIME_FORMAT " from %"
+      GST_TIME_FORMAT ", current stack [%" GST_TIME_FORMAT "--%"
+      GST_TIME_FORMAT "[", GST_TIME_ARGS (duration), GST_TIME_ARGS (position),
+      GST_TIME_ARGS (comp->private->segment_start),
+      GST_TIME_ARGS (comp->private->segment_stop));
+
+  if (segment->rate >= 0.0) {
+    target = position + duration;
+    /* within the stack, or past the end of the segment anyway */
+    if ((target < comp->private->segment_stop)
+        || (GST_CLOCK_TIME_IS_VALID (segment->stop)
+            && (target >= (GstClockTime) segment->stop)))
+      return NULL;
+
+    return gst_event_new_seek (segment->rate, GST_FORMAT_TIME,
+        GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+        GST_SEEK_TYPE_SET, target, GST_SEEK_TYPE_SET, segment->stop);
+  }
+
+  if (position < duration)
+    return NULL;
+  target = position - duration;
+  if ((target >= comp->private->segment_start)
+      || (target < (GstClockTime) segment->start))
+    return NULL;
+
+  return gst_event_new_seek (segment->rate, GST_FORMAT_TIME,
+      GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+      GST_SEEK_TYPE_SET, segment->start, GST_SEEK_TYPE_SET, target);
+}
+
+/*
+ * gnl_composition_send_event:
+ *
+ * STEP events sent to the pipeline are performed by the sinks, which drop
+ * the frames (decoding them, and going through every stack) until the step
+ * is done: they never reach the composition. Applications wanting steps to
+ * skip over whole stacks send them to the composition instead, with
+ * gst_element_send_event(). A step going past the current stack then
+ * becomes an accurate seek to its target, other steps are handed to the
+ * sink the composition is linked to, as if they had been sent to the
+ * pipeline.
+ */
+
+static gboolean
+gnl_composition_send_event (GstElement * element, GstEvent * event)
+{
+  GnlComposition *comp = (GnlComposition *) element;
+  GstPad *ghostpad = NULL, *peer;
+  GstElement *sink = NULL;
+  GstEvent *nevent;
+  gboolean res;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_STEP)
+    return GST_ELEMENT_CLASS (parent_class)->send_event (element, event);
+
+  COMP_OBJECTS_LOCK (comp);
+  if (comp->private->ghostpad)
+    ghostpad = gst_object_ref (comp->private->ghostpad);
+  COMP_OBJECTS_UNLOCK (comp);
+
+  if (!ghostpad) {
+    GST_DEBUG_OBJECT (comp, "Not outputting anything yet, can't step");
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  if ((nevent = step_to_seek_event (comp, ghostpad, event))) {
+    GST_DEBUG_OBJECT (comp, "step goes past the current stack, seeking");
+    gst_event_unref (event);
+    res = gst_pad_send_event (ghostpad, nevent);
+    goto beach;
+  }
+
+  if ((peer = gst_pad_get_peer (ghostpad))) {
+    sink = gst_pad_get_parent_element (peer);
+    gst_object_unref (peer);
+    if (sink && !GST_OBJECT_FLAG_IS_SET (sink, GST_ELEMENT_IS_SINK)) {
+      gst_object_unref (sink);
+      sink = NULL;
+    }
+  }
+
+  if (sink) {
+    GST_DEBUG_OBJECT (comp, "step within the current stack, handing it to %s",
+        GST_ELEMENT_NAME (sink));
+    res = gst_element_send_event (sink, event);
+    gst_object_unref (sink);
+  } else
+    res = gst_pad_send_event (ghostpad, event);
+
+beach:
+  gst_object_unref (ghostpad);
+  return res;
+}
+
+/*
+ * set_degraded:
+ *
+ * Switches degraded mode on or off. Only the stacks built from now on are
+ * affected.
+ */
+
+static void
+set_degraded (GnlComposition * comp, gboolean degraded)
+{
+  COMP_OBJECTS_LOCK (comp);
+  comp->private->late_qos = comp->private->ontime_qos = 0;
+  if (comp->private->degraded == degraded) {
+    COMP_OBJECTS_UNLOCK (comp);
+    return;
+  }
+  comp->private->degraded = degraded;
+  /* the cached stacks were computed with(out) the optional objects */
+  invalidate_schedule (comp, 0, GST_CLOCK_TIME_NONE);
+  apply_proxy_all (comp);
+  COMP_OBJECTS_UNLOCK (comp);
+
+  GST_INFO_OBJECT (comp, "%s optional objects",
+      degraded ? "Leaving out" : "Using again");
+  g_object_notify ((GObject *) comp, "degraded");
+}
+
+static void
+handle_qos_event (GnlComposition * comp, GstEvent * event)
+{
+  gdouble prop;
+  GstClockTimeDiff diff;
+  GstClockTime timestamp;
+  gboolean degrade = FALSE, restore = FALSE;
+
+  gst_event_parse_qos (event, &prop, &diff, &timestamp);
+  GST_INFO_OBJECT (comp, "timestamp:%" GST_TIME_FORMAT,
+      GST_TIME_ARGS (timestamp));
+
+  if (!comp->private->degrade)
+    return;
+
+  COMP_OBJECTS_LOCK (comp);
+  if (diff > 0) {
+    comp->private->ontime_qos = 0;
+    degrade = (++comp->private->late_qos >= DEGRADE_LATE_QOS)
+        && !comp->private->degraded;
+  } else {
+    comp->private->late_qos = 0;
+    restore = (++comp->private->ontime_qos >= RESTORE_ONTIME_QOS)
+        && comp->private->degraded;
+  }
+  COMP_OBJECTS_UNLOCK (comp);
+
+  if (degrade || restore)
+    set_degraded (comp, degrade);
+}
+
 static gboolean
 gnl_composition_event_handler (GstPad * ghostpad, GstEvent * event)
 {
@@ -809,9 +2051,24 @@ gnl_composition_event_handler (GstPad * ghostpad, GstEvent * event)
 
   GST_DEBUG_OBJECT (comp, "event type:%s", GST_EVENT_TYPE_NAME (event));
   switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_STEP:{
+      GstEvent *nevent;
+
+      /* Steps sent directly to our pad (or through
+       * gnl_composition_send_event()) going past the current stack seek to
+       * the stack they end in, others are passed on upstream. */
+      if (!(nevent = step_to_seek_event (comp, ghostpad, event)))
+        break;
+
+      GST_DEBUG_OBJECT (comp, "step goes past the current stack, seeking");
+      gst_event_unref (event);
+      event = nevent;
+    }
+      /* fall-through */
     case GST_EVENT_SEEK:{
       GstEvent *nevent;
 
+      event = gnl_frame_seek_to_time (ghostpad, event);
       handle_seek_event (comp, event);
 
       /* the incoming event might not be quite correct, we get a new proper
@@ -824,13 +2081,7 @@ gnl_composition_event_handler (GstPad * ghostpad, GstEvent * event)
       break;
     }
     case GST_EVENT_QOS:{
-      gdouble prop;
-      GstClockTimeDiff diff;
-      GstClockTime timestamp;
-
-      gst_event_parse_qos (event, &prop, &diff, &timestamp);
-      GST_INFO_OBJECT (comp, "timestamp:%" GST_TIME_FORMAT,
-          GST_TIME_ARGS (timestamp));
+      handle_qos_event (comp, event);
       /* else we let it go through (gnlobject will take care of time-shifting) */
       break;
     }
@@ -852,6 +2103,70 @@ gnl_composition_event_handler (GstPad * ghostpad, GstEvent * event)
   return res;
 }
 
+/* The latency reported downstream is the highest one of all the stacks
+ * played so far, so that it doesn't change at every stack switch */
+static gboolean
+gnl_composition_query_handler (GstPad * ghostpad, GstQuery * query)
+{
+  GnlComposition *comp = (GnlComposition *) gst_pad_get_parent (ghostpad);
+  gboolean res, live;
+  GstClockTime min, max;
+
+  res = comp->private->gnl_query_pad_func (ghostpad, query);
+
+  if (res && (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY)) {
+    gst_query_parse_latency (query, &live, &min, &max);
+
+    GST_OBJECT_LOCK (comp);
+    if (GST_CLOCK_TIME_IS_VALID (comp->private->latency)
+        && (!GST_CLOCK_TIME_IS_VALID (min) || (min < comp->private->latency)))
+      min = comp->private->latency;
+    comp->private->latency = min;
+    GST_OBJECT_UNLOCK (comp);
+
+    if (GST_CLOCK_TIME_IS_VALID (max) && (max < min))
+      max = min;
+
+    GST_DEBUG_OBJECT (comp, "live:%d, min:%" GST_TIME_FORMAT ", max:%"
+        GST_TIME_FORMAT, live, GST_TIME_ARGS (min), GST_TIME_ARGS (max));
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  gst_object_unref (comp);
+  return res;
+}
+
+/* Called when a stack starts outputting. Posts a latency message if it has
+ * more latency than what was reported downstream */
+static void
+check_stack_latency (GnlComposition * comp, GstPad * pad)
+{
+  GstQuery *query;
+  gboolean live;
+  GstClockTime min, max, latency;
+
+  GST_OBJECT_LOCK (comp);
+  latency = comp->private->latency;
+  GST_OBJECT_UNLOCK (comp);
+
+  /* Nothing was reported yet */
+  if (!GST_CLOCK_TIME_IS_VALID (latency))
+    return;
+
+  query = gst_query_new_latency ();
+  if (gst_pad_query (pad, query)) {
+    gst_query_parse_latency (query, &live, &min, &max);
+
+    if (live && GST_CLOCK_TIME_IS_VALID (min) && (min > latency)) {
+      GST_DEBUG_OBJECT (comp, "latency goes up to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (min));
+      gst_element_post_message ((GstElement *) comp,
+          gst_message_new_latency ((GstObject *) comp));
+    }
+  }
+  gst_query_unref (query);
+}
+
 static void
 pad_blocked (GstPad * pad, gboolean blocked, GnlComposition * comp)
 {
@@ -859,6 +2174,30 @@ pad_blocked (GstPad * pad, gboolean blocked, GnlComposition * comp)
       GST_DEBUG_PAD_NAME (pad), blocked);
 }
 
+/* Override the chain function of the ghostpad's internal pad, see
+ * ghost_chain_handler() */
+static void
+control_output_caps (GnlComposition * comp)
+{
+  GstIterator *it;
+  gpointer internal = NULL;
+
+  it = gst_pad_iterate_internal_links (comp->private->ghostpad);
+  if (!it || gst_iterator_next (it, &internal) != GST_ITERATOR_OK) {
+    GST_WARNING_OBJECT (comp, "Couldn't get the ghostpad's internal pad");
+    goto beach;
+  }
+
+  comp->private->gnl_chain_pad_func = GST_PAD_CHAINFUNC (internal);
+  gst_pad_set_chain_function ((GstPad *) internal,
+      GST_DEBUG_FUNCPTR (ghost_chain_handler));
+  gst_object_unref (internal);
+
+beach:
+  if (it)
+    gst_iterator_free (it);
+}
+
 /* gnl_composition_ghost_pad_set_target:
  * target: The target #GstPad. The refcount will be decremented (given to the ghostpad).
  */
@@ -884,6 +2223,11 @@ gnl_composition_ghost_pad_set_target (GnlComposition * comp, GstPad * target)
         GST_PAD_EVENTFUNC (comp->private->ghostpad);
     gst_pad_set_event_function (comp->private->ghostpad,
         GST_DEBUG_FUNCPTR (gnl_composition_event_handler));
+    comp->private->gnl_query_pad_func =
+        GST_PAD_QUERYFUNC (comp->private->ghostpad);
+    gst_pad_set_query_function (comp->private->ghostpad,
+        GST_DEBUG_FUNCPTR (gnl_composition_query_handler));
+    control_output_caps (comp);
     GST_DEBUG_OBJECT (comp->private->ghostpad, "eventfunc is now %s",
         GST_DEBUG_FUNCPTR_NAME (GST_PAD_EVENTFUNC (comp->private->ghostpad)));
   } else {
@@ -942,7 +2286,7 @@ refine_start_stop_in_region_above_priority (GnlComposition * composition,
     GstClockTime stop,
     GstClockTime * rstart, GstClockTime * rstop, guint32 priority)
 {
-  GList *tmp = composition->private->objects_start;
+  GSequenceIter *iter;
   GnlObject *object;
   GstClockTime nstart = start, nstop = stop;
 
@@ -951,13 +2295,15 @@ refine_start_stop_in_region_above_priority (GnlComposition * composition,
       GST_TIME_FORMAT " priority:%u", GST_TIME_ARGS (timestamp),
       GST_TIME_ARGS (start), GST_TIME_ARGS (stop), priority);
 
-  for (tmp = composition->private->objects_start; tmp; tmp = g_list_next (tmp)) {
-    object = (GnlObject *) tmp->data;
+  for (iter = g_sequence_get_begin_iter (composition->private->objects_start);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    object = (GnlObject *) g_sequence_get (iter);
 
     GST_LOG_OBJECT (object, "START %" GST_TIME_FORMAT "--%" GST_TIME_FORMAT,
         GST_TIME_ARGS (object->start), GST_TIME_ARGS (object->stop));
 
-    if ((object->priority >= priority) || (!object->active))
+    if ((object->priority >= priority)
+        || !OBJECT_IS_USED (composition, object))
       continue;
 
     if (object->start <= timestamp)
@@ -974,13 +2320,15 @@ refine_start_stop_in_region_above_priority (GnlComposition * composition,
     break;
   }
 
-  for (tmp = composition->private->objects_stop; tmp; tmp = g_list_next (tmp)) {
-    object = (GnlObject *) tmp->data;
+  for (iter = g_sequence_get_begin_iter (composition->private->objects_stop);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    object = (GnlObject *) g_sequence_get (iter);
 
     GST_LOG_OBJECT (object, "STOP %" GST_TIME_FORMAT "--%" GST_TIME_FORMAT,
         GST_TIME_ARGS (object->start), GST_TIME_ARGS (object->stop));
 
-    if ((object->priority >= priority) || (!object->active))
+    if ((object->priority >= priority)
+        || !OBJECT_IS_USED (composition, object))
       continue;
 
     if (object->stop >= timestamp)
@@ -1047,7 +2395,7 @@ convert_list_to_tree (GList ** stack, GstClockTime * start,
     *start = object->start;
   }
 
-  if (GNL_IS_SOURCE (object)) {
+  if (GNL_OBJECT_IS_SOURCE (object)) {
     *stack = g_list_next (*stack);
     /* update highest priority.
      * We do this here, since it's only used with sources (leafs of the tree) */
@@ -1080,6 +2428,49 @@ beach:
   return ret;
 }
 
+/*
+ * prune_occluded_objects:
+ * @comp: The #GnlComposition
+ * @stack: A #GList of #GnlObject sorted by priority
+ *
+ * Removes from @stack all the objects hidden below the first opaque
+ * #GnlSource, so that they don't get linked, prerolled or decoded.
+ *
+ * Objects are only pruned if all the operations above that source accept a
+ * variable number of inputs, else the hidden objects might be needed to
+ * feed their sinkpads.
+ *
+ * Returns: The pruned #GList.
+ */
+
+static GList *
+prune_occluded_objects (GnlComposition * comp, GList * stack)
+{
+  GList *tmp;
+
+  for (tmp = stack; tmp; tmp = g_list_next (tmp)) {
+    GnlObject *object = (GnlObject *) tmp->data;
+
+    if (GNL_IS_OPERATION (object)) {
+      if (!((GnlOperation *) object)->dynamicsinks)
+        break;
+      continue;
+    }
+
+    if (object->opaque) {
+      if (tmp->next) {
+        GST_DEBUG_OBJECT (comp, "%s is opaque, pruning %d hidden objects",
+            GST_OBJECT_NAME (object), g_list_length (tmp->next));
+        g_list_free (tmp->next);
+        tmp->next = NULL;
+      }
+      break;
+    }
+  }
+
+  return stack;
+}
+
 /*
  * get_stack_list:
  * @comp: The #GnlComposition
@@ -1100,8 +2491,8 @@ get_stack_list (GnlComposition * comp, GstClockTime timestamp,
     guint32 priority, gboolean activeonly, GstClockTime * start,
     GstClockTime * stop, guint * highprio)
 {
-  GList *tmp = comp->private->objects_start;
-  GList *stack = NULL;
+  GSequenceIter *iter;
+  GList *tmp, *stack = NULL;
   GNode *ret = NULL;
   GstClockTime nstart = GST_CLOCK_TIME_NONE;
   GstClockTime nstop = GST_CLOCK_TIME_NONE;
@@ -1113,8 +2504,9 @@ get_stack_list (GnlComposition * comp, GstClockTime timestamp,
 
   GST_LOG ("objects_start:%p", comp->private->objects_start);
 
-  for (; tmp; tmp = g_list_next (tmp)) {
-    GnlObject *object = (GnlObject *) tmp->data;
+  for (iter = g_sequence_get_begin_iter (comp->private->objects_start);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    GnlObject *object = (GnlObject *) g_sequence_get (iter);
 
     GST_LOG_OBJECT (object,
         "start: %" GST_TIME_FORMAT " , stop:%" GST_TIME_FORMAT " , duration:%"
@@ -1125,7 +2517,7 @@ get_stack_list (GnlComposition * comp, GstClockTime timestamp,
     if (object->start <= timestamp) {
       if ((object->stop > timestamp) &&
           (object->priority >= priority) &&
-          ((!activeonly) || (object->active))) {
+          ((!activeonly) || OBJECT_IS_USED (comp, object))) {
         GST_LOG_OBJECT (comp, "adding %s: sorted to the stack",
             GST_OBJECT_NAME (object));
         stack = g_list_insert_sorted (stack, object,
@@ -1141,6 +2533,9 @@ get_stack_list (GnlComposition * comp, GstClockTime timestamp,
   if ((timestamp < ((GnlObject *) comp)->stop) && comp->private->defaultobject)
     stack = g_list_append (stack, comp->private->defaultobject);
 
+  /* don't bother with objects hidden by an opaque source */
+  stack = prune_occluded_objects (comp, stack);
+
   /* convert that list to a stack */
   tmp = stack;
   ret = convert_list_to_tree (&tmp, &nstart, &nstop, &highest);
@@ -1175,7 +2570,7 @@ get_clean_toplevel_stack (GnlComposition * comp, GstClockTime * timestamp,
     GstClockTime * start_time, GstClockTime * stop_time)
 {
   GNode *stack = NULL;
-  GList *tmp;
+  GSequenceIter *iter;
   GstClockTime start = G_MAXUINT64;
   GstClockTime stop = G_MAXUINT64;
   guint highprio;
@@ -1196,14 +2591,15 @@ get_clean_toplevel_stack (GnlComposition * comp, GstClockTime * timestamp,
     GST_DEBUG_OBJECT (comp,
         "Got empty stack, checking if it really was after the last object");
     /* Find the first active object just after *timestamp */
-    for (tmp = comp->private->objects_start; tmp; tmp = g_list_next (tmp)) {
-      object = (GnlObject *) tmp->data;
+    for (iter = g_sequence_get_begin_iter (comp->private->objects_start);
+        !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+      object = (GnlObject *) g_sequence_get (iter);
 
-      if ((object->start > *timestamp) && object->active)
+      if ((object->start > *timestamp) && OBJECT_IS_USED (comp, object))
         break;
     }
 
-    if (tmp) {
+    if (!g_sequence_iter_is_end (iter)) {
       GST_DEBUG_OBJECT (comp,
           "Found a valid object after %" GST_TIME_FORMAT " : %s [%"
           GST_TIME_FORMAT "]", GST_TIME_ARGS (*timestamp),
@@ -1214,39 +2610,1011 @@ get_clean_toplevel_stack (GnlComposition * comp, GstClockTime * timestamp,
     }
   }
 
-  GST_DEBUG ("start:%" GST_TIME_FORMAT ", stop:%" GST_TIME_FORMAT,
-      GST_TIME_ARGS (start), GST_TIME_ARGS (stop));
+  GST_DEBUG ("start:%" GST_TIME_FORMAT ", stop:%" GST_TIME_FORMAT,
+      GST_TIME_ARGS (start), GST_TIME_ARGS (stop));
+
+  if (stack) {
+    guint32 top_priority;
+
+    top_priority = ((GnlObject *) stack->data)->priority;
+
+    /* Figure out if there's anything blocking us with smaller priority */
+    refine_start_stop_in_region_above_priority (comp, *timestamp, start, stop,
+        &start, &stop, (highprio == 0) ? top_priority : highprio);
+  }
+
+  if (*stop_time) {
+    if (stack)
+      *stop_time = stop;
+    else
+      *stop_time = 0;
+  }
+
+  if (*start_time) {
+    if (stack)
+      *start_time = start;
+    else
+      *start_time = 0;
+  }
+
+  GST_DEBUG_OBJECT (comp,
+      "Returning timestamp:%" GST_TIME_FORMAT " , start_time:%" GST_TIME_FORMAT
+      " , stop_time:%" GST_TIME_FORMAT, GST_TIME_ARGS (*timestamp),
+      GST_TIME_ARGS (*start_time), GST_TIME_ARGS (*stop_time));
+
+  return stack;
+}
+
+/*
+ * get_clean_toplevel_stack_reverse:
+ * @comp: The #GnlComposition
+ * @timestamp: The #GstClockTime before which to look
+ * @stop_time: Pointer to a #GstClockTime for min stop time of returned stack
+ * @start_time: Pointer to a #GstClockTime for greatest start time of returned stack
+ *
+ * Same as get_clean_toplevel_stack() for reverse playback. Looks for the
+ * stack playing just before @timestamp, jumping backwards over gaps, and
+ * sets @timestamp to the start of that stack.
+ *
+ * Returns: The new current stack for the given #GnlComposition and @timestamp.
+ */
+
+static GNode *
+get_clean_toplevel_stack_reverse (GnlComposition * comp,
+    GstClockTime * timestamp, GstClockTime * start_time,
+    GstClockTime * stop_time)
+{
+  GNode *stack = NULL;
+  GSequenceIter *iter;
+  GnlObject *object = NULL;
+  /* non-zero so get_clean_toplevel_stack fills them in */
+  GstClockTime lookup, start = GST_CLOCK_TIME_NONE, stop = GST_CLOCK_TIME_NONE;
+
+  GST_DEBUG_OBJECT (comp, "timestamp:%" GST_TIME_FORMAT,
+      GST_TIME_ARGS (*timestamp));
+
+  if ((*timestamp == 0) || (*timestamp <= comp->private->segment->start))
+    goto beach;
+
+  lookup = *timestamp - 1;
+
+  /* Case for gaps, go to the end of the last active object before lookup.
+   * objects_stop being sorted by decreasing stop, the first active object
+   * starting before lookup either covers it or is that last object. */
+  if (!comp->private->defaultobject) {
+    for (iter = g_sequence_get_begin_iter (comp->private->objects_stop);
+        !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+      object = (GnlObject *) g_sequence_get (iter);
+      if (OBJECT_IS_USED (comp, object) && (object->start <= lookup))
+        break;
+    }
+
+    if (g_sequence_iter_is_end (iter))
+      goto beach;
+
+    if (object->stop <= lookup) {
+      GST_DEBUG_OBJECT (comp, "Jumping back over gap to %s [%" GST_TIME_FORMAT
+          "]", GST_ELEMENT_NAME (object), GST_TIME_ARGS (object->stop));
+      lookup = object->stop - 1;
+    }
+  }
+
+  *timestamp = lookup + 1;
+  stack = get_clean_toplevel_stack (comp, &lookup, &start, &stop);
+
+beach:
+  if (stack) {
+    *stop_time = MIN (stop, *timestamp);
+    *timestamp = *start_time = start;
+  } else
+    *start_time = *stop_time = 0;
+
+  GST_DEBUG_OBJECT (comp,
+      "Returning timestamp:%" GST_TIME_FORMAT " , start_time:%" GST_TIME_FORMAT
+      " , stop_time:%" GST_TIME_FORMAT, GST_TIME_ARGS (*timestamp),
+      GST_TIME_ARGS (*start_time), GST_TIME_ARGS (*stop_time));
+
+  return stack;
+}
+
+/*
+ * invalidate_schedule:
+ *
+ * Drops the cached schedule entries touching [start, stop].
+ * Must be called with the OBJECTS_LOCK
+ */
+
+static void
+invalidate_schedule (GnlComposition * comp, GstClockTime start,
+    GstClockTime stop)
+{
+  GList *tmp, *next;
+  GnlScheduleEntry *entry;
+
+  for (tmp = comp->private->schedule; tmp; tmp = next) {
+    entry = (GnlScheduleEntry *) tmp->data;
+    next = tmp->next;
+
+    if (entry->start > stop)
+      break;
+    if (entry->stop < start)
+      continue;
+
+    GST_LOG_OBJECT (comp, "Dropping schedule entry [%" GST_TIME_FORMAT "--%"
+        GST_TIME_FORMAT "[", GST_TIME_ARGS (entry->start),
+        GST_TIME_ARGS (entry->stop));
+    schedule_entry_free (entry);
+    comp->private->schedule =
+        g_list_delete_link (comp->private->schedule, tmp);
+  }
+}
+
+/*
+ * schedule_object_changed:
+ *
+ * Invalidates the schedule where @object was and where it now is.
+ */
+
+static void
+schedule_object_changed (GnlComposition * comp, GnlObject * object)
+{
+  GnlCompositionEntry *entry;
+
+  COMP_OBJECTS_LOCK (comp);
+  if ((entry = COMP_ENTRY (comp, object))) {
+    invalidate_schedule (comp, entry->start, entry->stop);
+    invalidate_schedule (comp, object->start, object->stop);
+    entry->start = object->start;
+    entry->stop = object->stop;
+  }
+  COMP_OBJECTS_UNLOCK (comp);
+}
+
+/*
+ * refresh_schedule:
+ *
+ * Walks the timeline stack by stack, only computing the stacks of the ranges
+ * which aren't cached.
+ * Must be called with the OBJECTS_LOCK
+ */
+
+static void
+refresh_schedule (GnlComposition * comp)
+{
+  GnlObject *cobj = (GnlObject *) comp;
+  GList *cached, *ret = NULL;
+  GnlScheduleEntry *entry;
+  GstClockTime timestamp, next, start, stop;
+  GNode *stack;
+  guint computed = 0;
+
+  if (comp->private->schedule_stop != cobj->stop) {
+    invalidate_schedule (comp, MIN (comp->private->schedule_stop, cobj->stop),
+        GST_CLOCK_TIME_NONE);
+    comp->private->schedule_stop = cobj->stop;
+  }
+
+  cached = comp->private->schedule;
+  timestamp = cobj->start;
+
+  while (timestamp < cobj->stop) {
+    /* Entries starting before timestamp are now covered by another one */
+    while (cached && (((GnlScheduleEntry *) cached->data)->start < timestamp)) {
+      schedule_entry_free ((GnlScheduleEntry *) cached->data);
+      cached = g_list_delete_link (cached, cached);
+    }
+
+    if (cached && (((GnlScheduleEntry *) cached->data)->start == timestamp)) {
+      entry = (GnlScheduleEntry *) cached->data;
+      cached = g_list_delete_link (cached, cached);
+    } else {
+      /* non-zero so get_clean_toplevel_stack fills them in */
+      start = stop = GST_CLOCK_TIME_NONE;
+      next = timestamp;
+      stack = get_clean_toplevel_stack (comp, &next, &start, &stop);
+      computed++;
+
+      entry = g_new0 (GnlScheduleEntry, 1);
+      entry->start = timestamp;
+      if (!stack) {
+        entry->stop = cobj->stop;
+      } else if (next > timestamp) {
+        /* We jumped over a gap, the stack will be looked up again */
+        entry->stop = next;
+        g_node_destroy (stack);
+      } else {
+        entry->stop = stop;
+        entry->stack = stack;
+      }
+
+      if (entry->stop <= entry->start) {
+        schedule_entry_free (entry);
+        break;
+      }
+    }
+
+    ret = g_list_prepend (ret, entry);
+    timestamp = entry->stop;
+  }
+
+  g_list_foreach (cached, (GFunc) schedule_entry_free, NULL);
+  g_list_free (cached);
+
+  comp->private->schedule = g_list_reverse (ret);
+
+  GST_DEBUG_OBJECT (comp, "Schedule has %u entries, %u were computed",
+      g_list_length (comp->private->schedule), computed);
+}
+
+/*
+ * gnl_composition_get_partitions:
+ *
+ * Picks amongst the stack boundaries the ones closest to an even split of
+ * the timeline in @n ranges.
+ */
+
+static GValueArray *
+gnl_composition_get_partitions (GnlComposition * comp, guint n)
+{
+  GValueArray *ret;
+  GArray *boundaries;
+  GList *tmp;
+  GstClockTime stop, tlstart, tlstop, target, last;
+  GValue val = { 0, };
+  guint i, j;
+
+  ret = g_value_array_new (n + 1);
+  boundaries = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+
+  COMP_OBJECTS_LOCK (comp);
+
+  tlstart = GNL_OBJECT (comp)->start;
+  tlstop = GNL_OBJECT (comp)->stop;
+
+  refresh_schedule (comp);
+  for (tmp = comp->private->schedule; tmp; tmp = tmp->next) {
+    stop = ((GnlScheduleEntry *) tmp->data)->stop;
+    if (stop < tlstop)
+      g_array_append_val (boundaries, stop);
+  }
+
+  COMP_OBJECTS_UNLOCK (comp);
+
+  GST_DEBUG_OBJECT (comp, "%u stack boundaries in [%" GST_TIME_FORMAT "--%"
+      GST_TIME_FORMAT "]", boundaries->len, GST_TIME_ARGS (tlstart),
+      GST_TIME_ARGS (tlstop));
+
+  if (n == 0 || tlstop <= tlstart)
+    goto beach;
+
+  g_value_init (&val, G_TYPE_UINT64);
+  g_value_set_uint64 (&val, tlstart);
+  g_value_array_append (ret, &val);
+
+  /* For each ideal cut, take the nearest boundary after the previous cut */
+  last = tlstart;
+  for (i = 1, j = 0; i < n && j < boundaries->len; i++) {
+    target = tlstart + gst_util_uint64_scale_int (tlstop - tlstart, i, n);
+
+    while (j < boundaries->len && g_array_index (boundaries, GstClockTime,
+            j) <= last)
+      j++;
+    while (j + 1 < boundaries->len &&
+        g_array_index (boundaries, GstClockTime, j + 1) <= target)
+      j++;
+    if (j + 1 < boundaries->len &&
+        (g_array_index (boundaries, GstClockTime, j + 1) - target <
+            target - MIN (target, g_array_index (boundaries, GstClockTime,
+                    j))))
+      j++;
+    if (j >= boundaries->len)
+      break;
+
+    last = g_array_index (boundaries, GstClockTime, j);
+    g_value_set_uint64 (&val, last);
+    g_value_array_append (ret, &val);
+  }
+
+  g_value_set_uint64 (&val, tlstop);
+  g_value_array_append (ret, &val);
+  g_value_unset (&val);
+
+beach:
+  g_array_free (boundaries, TRUE);
+
+  return ret;
+}
+
+
+/*
+ * gnl_composition_query_range:
+ *
+ * The objects overlapping [@start, @stop[ are both the objects of
+ * objects_start starting before @stop, and the objects of objects_stop
+ * stopping after @start. Both sets are found by bisection, and the smallest
+ * one is walked, so this costs O(log n + m), m being the size of that set.
+ * Without an interval tree m is still proportional to n for ranges in the
+ * middle of long timelines.
+ */
+
+static GValueArray *
+gnl_composition_query_range (GnlComposition * comp, guint64 start,
+    guint64 stop, guint minprio, guint maxprio)
+{
+  GValueArray *ret;
+  GnlObject *object;
+  GSequenceIter *iter, *startend, *stopend;
+  GList *objects = NULL, *tmp;
+  GValue val = { 0, };
+
+  ret = g_value_array_new (0);
+  g_value_init (&val, GNL_TYPE_OBJECT);
+
+  COMP_OBJECTS_LOCK (comp);
+
+  startend = g_sequence_search (comp->private->objects_start, &stop,
+      (GCompareDataFunc) objects_start_search, NULL);
+  stopend = g_sequence_search (comp->private->objects_stop, &start,
+      (GCompareDataFunc) objects_stop_search, NULL);
+
+  if (g_sequence_iter_get_position (startend) <=
+      g_sequence_iter_get_position (stopend)) {
+    for (iter = g_sequence_get_begin_iter (comp->private->objects_start);
+        iter != startend; iter = g_sequence_iter_next (iter)) {
+      object = (GnlObject *) g_sequence_get (iter);
+      if (object->stop > start)
+        objects = g_list_prepend (objects, object);
+    }
+    objects = g_list_reverse (objects);
+  } else {
+    for (iter = g_sequence_get_begin_iter (comp->private->objects_stop);
+        iter != stopend; iter = g_sequence_iter_next (iter)) {
+      object = (GnlObject *) g_sequence_get (iter);
+      if (object->start < stop)
+        objects = g_list_prepend (objects, object);
+    }
+    objects = g_list_sort_with_data (objects,
+        (GCompareDataFunc) objects_start_compare, NULL);
+  }
+
+  for (tmp = objects; tmp; tmp = g_list_next (tmp)) {
+    object = (GnlObject *) tmp->data;
+    if ((object->priority < minprio) || (object->priority > maxprio))
+      continue;
+
+    g_value_set_object (&val, object);
+    g_value_array_append (ret, &val);
+  }
+  g_list_free (objects);
+
+  /* The default object isn't in objects_start */
+  object = comp->private->defaultobject;
+  if (object && (object->start < stop) && (object->stop > start)
+      && (object->priority >= minprio) && (object->priority <= maxprio)) {
+    g_value_set_object (&val, object);
+    g_value_array_append (ret, &val);
+  }
+
+  COMP_OBJECTS_UNLOCK (comp);
+
+  g_value_unset (&val);
+
+  GST_DEBUG_OBJECT (comp, "%u objects in [%" GST_TIME_FORMAT "--%"
+      GST_TIME_FORMAT "[, priorities %u-%u", ret->n_values,
+      GST_TIME_ARGS (start), GST_TIME_ARGS (stop), minprio, maxprio);
+
+  return ret;
+}
+
+static GstStructure *
+stack_to_structure (GNode * node)
+{
+  GstStructure *ret;
+  GValueArray *children;
+  GValue val = { 0, };
+  GNode *child;
+
+  children = g_value_array_new (g_node_n_children (node));
+  g_value_init (&val, GST_TYPE_STRUCTURE);
+  for (child = node->children; child; child = child->next) {
+    g_value_take_boxed (&val, stack_to_structure (child));
+    g_value_array_append (children, &val);
+  }
+  g_value_unset (&val);
+
+  ret = gst_structure_new ("gnl-stack-node",
+      "object", GNL_TYPE_OBJECT, node->data,
+      "children", G_TYPE_VALUE_ARRAY, children, NULL);
+  g_value_array_free (children);
+
+  return ret;
+}
+
+static GValueArray *
+gnl_composition_get_schedule (GnlComposition * comp)
+{
+  GValueArray *ret;
+  GnlScheduleEntry *entry;
+  GstStructure *structure;
+  GList *tmp;
+  GValue val = { 0, };
+
+  g_value_init (&val, GST_TYPE_STRUCTURE);
+
+  COMP_OBJECTS_LOCK (comp);
+
+  refresh_schedule (comp);
+
+  ret = g_value_array_new (g_list_length (comp->private->schedule));
+  for (tmp = comp->private->schedule; tmp; tmp = tmp->next) {
+    entry = (GnlScheduleEntry *) tmp->data;
+
+    structure = gst_structure_new ("gnl-schedule-entry",
+        "start", G_TYPE_UINT64, entry->start,
+        "stop", G_TYPE_UINT64, entry->stop, NULL);
+    if (entry->stack) {
+      GstStructure *stack = stack_to_structure (entry->stack);
+
+      gst_structure_set (structure, "stack", GST_TYPE_STRUCTURE, stack, NULL);
+      gst_structure_free (stack);
+    }
+
+    g_value_take_boxed (&val, structure);
+    g_value_array_append (ret, &val);
+  }
+
+  COMP_OBJECTS_UNLOCK (comp);
+
+  g_value_unset (&val);
+
+  return ret;
+}
+
+/*
+ * copy_properties:
+ *
+ * Copies all the read-write properties of @src to @dest, which must be of the
+ * same type. The name is only copied if @with_name is TRUE. If @object_only
+ * is TRUE, only the #GnlObject properties are copied.
+ */
+
+static void
+copy_properties (GObject * src, GObject * dest, gboolean with_name,
+    gboolean object_only)
+{
+  GParamSpec **specs;
+  GValue val = { 0, };
+  guint i, nb;
+
+  specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (src), &nb);
+
+  for (i = 0; i < nb; i++) {
+    if (((specs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE) ||
+        (specs[i]->flags & G_PARAM_CONSTRUCT_ONLY) ||
+        (!with_name && (specs[i]->owner_type == GST_TYPE_OBJECT)) ||
+        (object_only && (specs[i]->owner_type != GST_TYPE_OBJECT)
+            && (specs[i]->owner_type != GNL_TYPE_OBJECT)))
+      continue;
+
+    g_value_init (&val, specs[i]->value_type);
+    g_object_get_property (src, specs[i]->name, &val);
+    g_object_set_property (dest, specs[i]->name, &val);
+    g_value_unset (&val);
+  }
+
+  g_free (specs);
+}
+
+static GList *
+copy_children (GList * list)
+{
+  GList *ret = g_list_copy (list), *tmp;
+
+  for (tmp = ret; tmp; tmp = tmp->next)
+    gst_object_ref (tmp->data);
+
+  return ret;
+}
+
+static void
+free_children (GList * list)
+{
+  g_list_foreach (list, (GFunc) gst_object_unref, NULL);
+  g_list_free (list);
+}
+
+/*
+ * copy_element:
+ *
+ * Returns a new element created by the same factory as @element, with the
+ * same properties. Hand-made bins are copied with copies of their children,
+ * linked and ghosted the same way.
+ *
+ * Returns NULL if @element, or one of its children, wasn't created by a
+ * factory.
+ */
+
+static GstElement *
+copy_element (GstElement * element)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+  GstElement *ret, *copy, *peerparent;
+  GstPad *peer, *target, *newtarget;
+  GList *children, *pads, *tmp, *ptmp;
+  gboolean ok = TRUE;
+
+  if (factory && (G_OBJECT_TYPE (element) != GST_TYPE_BIN)) {
+    ret = gst_element_factory_create (factory, GST_ELEMENT_NAME (element));
+    copy_properties ((GObject *) element, (GObject *) ret, FALSE, FALSE);
+    return ret;
+  }
+
+  if (G_OBJECT_TYPE (element) != GST_TYPE_BIN) {
+    GST_WARNING_OBJECT (element, "Can't copy, it wasn't created by a factory");
+    return NULL;
+  }
+
+  ret = gst_bin_new (GST_ELEMENT_NAME (element));
+
+  GST_OBJECT_LOCK (element);
+  children = copy_children (GST_BIN_CHILDREN (element));
+  GST_OBJECT_UNLOCK (element);
+
+  for (tmp = children; tmp && ok; tmp = tmp->next) {
+    if ((copy = copy_element ((GstElement *) tmp->data)))
+      gst_bin_add ((GstBin *) ret, copy);
+    else
+      ok = FALSE;
+  }
+
+  /* links between the children, by pad name */
+  for (tmp = children; tmp && ok; tmp = tmp->next) {
+    GST_OBJECT_LOCK (tmp->data);
+    pads = copy_children (GST_ELEMENT_PADS (tmp->data));
+    GST_OBJECT_UNLOCK (tmp->data);
+
+    for (ptmp = pads; ptmp; ptmp = ptmp->next) {
+      if ((GST_PAD_DIRECTION (ptmp->data) != GST_PAD_SRC)
+          || !(peer = gst_pad_get_peer ((GstPad *) ptmp->data)))
+        continue;
+
+      peerparent = gst_pad_get_parent_element (peer);
+      if (peerparent
+          && (GST_OBJECT_PARENT (peerparent) == (GstObject *) element)) {
+        GstElement *src, *sink;
+
+        src = gst_bin_get_by_name ((GstBin *) ret,
+            GST_ELEMENT_NAME (tmp->data));
+        sink = gst_bin_get_by_name ((GstBin *) ret,
+            GST_ELEMENT_NAME (peerparent));
+        if (!gst_element_link_pads (src, GST_PAD_NAME (ptmp->data), sink,
+                GST_PAD_NAME (peer))) {
+          GST_WARNING_OBJECT (element, "Can't copy the link %s:%s - %s:%s",
+              GST_DEBUG_PAD_NAME (ptmp->data), GST_DEBUG_PAD_NAME (peer));
+          ok = FALSE;
+        }
+        gst_object_unref (src);
+        gst_object_unref (sink);
+      }
+      if (peerparent)
+        gst_object_unref (peerparent);
+      gst_object_unref (peer);
+    }
+    free_children (pads);
+  }
+
+  /* ghost pads */
+  if (ok) {
+    GST_OBJECT_LOCK (element);
+    pads = copy_children (GST_ELEMENT_PADS (element));
+    GST_OBJECT_UNLOCK (element);
+
+    for (ptmp = pads; ptmp && ok; ptmp = ptmp->next) {
+      if (!GST_IS_GHOST_PAD (ptmp->data)
+          || !(target = gst_ghost_pad_get_target ((GstGhostPad *) ptmp->data)))
+        continue;
+
+      copy = gst_bin_get_by_name ((GstBin *) ret,
+          GST_OBJECT_NAME (GST_OBJECT_PARENT (target)));
+      newtarget = copy ? gst_element_get_pad (copy, GST_PAD_NAME (target)) :
+          NULL;
+      if (newtarget) {
+        gst_element_add_pad (ret,
+            gst_ghost_pad_new (GST_PAD_NAME (ptmp->data), newtarget));
+        gst_object_unref (newtarget);
+      } else {
+        GST_WARNING_OBJECT (element, "Can't copy the ghost pad %s:%s",
+            GST_DEBUG_PAD_NAME (ptmp->data));
+        ok = FALSE;
+      }
+      if (copy)
+        gst_object_unref (copy);
+      gst_object_unref (target);
+    }
+    free_children (pads);
+  }
+
+  free_children (children);
+
+  if (!ok) {
+    gst_object_unref (ret);
+    return NULL;
+  }
+
+  return ret;
+}
+
+/*
+ * clone_object:
+ *
+ * Returns a copy of @object, or NULL if it can't be copied.
+ */
+
+static GstElement *
+clone_object (GnlObject * object)
+{
+  GstElement *ret = NULL;
+  GstElement *child, *newchild;
+  GstIterator *it;
+  gpointer item;
+  gboolean done = FALSE;
+
+  if (GNL_IS_COMPOSITION (object)) {
+    g_signal_emit (object, _signals[CLONE_SIGNAL], 0, &ret);
+    if (ret) {
+      gchar *name = gst_object_get_name ((GstObject *) object);
+
+      gst_object_set_name ((GstObject *) ret, name);
+      g_free (name);
+    }
+    return ret;
+  }
+
+  ret = (GstElement *) g_object_new (G_OBJECT_TYPE (object), NULL);
+  copy_properties ((GObject *) object, (GObject *) ret, TRUE, FALSE);
+
+  /* GnlFileSource creates its own elements */
+  if (GNL_IS_FILESOURCE (object))
+    return ret;
+
+  /* Copy the controlled element(s) */
+  it = gst_bin_iterate_elements ((GstBin *) object);
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:
+        child = (GstElement *) item;
+        newchild = copy_element (child);
+        gst_object_unref (child);
+        if (!newchild) {
+          GST_WARNING_OBJECT (object, "Can't copy the controlled elements");
+          goto fail;
+        }
+        gst_bin_add ((GstBin *) ret, newchild);
+        break;
+      case GST_ITERATOR_RESYNC:
+        GST_WARNING_OBJECT (object, "Children changed while copying");
+        goto fail;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+  gst_iterator_free (it);
+
+  return ret;
+
+fail:
+  gst_iterator_free (it);
+  gst_object_unref (ret);
+  return NULL;
+}
+
+static GstElement *
+gnl_composition_clone (GnlComposition * comp)
+{
+  GstElement *ret, *copy;
+  GList *objects = NULL, *tmp;
+  GSequenceIter *iter;
+
+  ret = (GstElement *) g_object_new (G_OBJECT_TYPE (comp), NULL);
+
+  /* Take a snapshot of the objects */
+  COMP_OBJECTS_LOCK (comp);
+  for (iter = g_sequence_get_begin_iter (comp->private->objects_start);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter))
+    objects = g_list_prepend (objects, g_sequence_get (iter));
+  objects = g_list_reverse (objects);
+  /* The gap object is re-created when copying the gap-buffer property */
+  if (comp->private->defaultobject
+      && (comp->private->defaultobject != comp->private->gapobject))
+    objects = g_list_prepend (objects, comp->private->defaultobject);
+  for (tmp = objects; tmp; tmp = g_list_next (tmp))
+    gst_object_ref (tmp->data);
+  COMP_OBJECTS_UNLOCK (comp);
+
+  for (tmp = objects; tmp; tmp = g_list_next (tmp)) {
+    if (!(copy = clone_object ((GnlObject *) tmp->data))) {
+      gst_object_unref (ret);
+      ret = NULL;
+      break;
+    }
+    gst_bin_add ((GstBin *) ret, copy);
+  }
+
+  /* Only the timeline is copied, not the settings of comp (master, cache,
+   * retention...) */
+  if (ret) {
+    GstMiniObject *gapbuffer;
+
+    copy_properties ((GObject *) comp, (GObject *) ret, FALSE, TRUE);
+    g_object_get (comp, "gap-buffer", &gapbuffer, NULL);
+    if (gapbuffer) {
+      g_object_set (ret, "gap-buffer", gapbuffer, NULL);
+      gst_mini_object_unref (gapbuffer);
+    }
+  }
+
+  GST_DEBUG_OBJECT (comp, "cloned %d objects into %p",
+      g_list_length (objects), ret);
+
+  for (tmp = objects; tmp; tmp = g_list_next (tmp))
+    gst_object_unref (tmp->data);
+  g_list_free (objects);
+
+  return ret;
+}
+
+/* Timestamps less than this after the previous one are reached by decoding
+ * forward, further ones by seeking (and decoding from the previous
+ * keyframe) */
+#define EXTRACT_MAX_GAP (2 * GST_SECOND)
+
+/* How long to wait for a frame before giving up on it */
+#define EXTRACT_TIMEOUT (10 * GST_SECOND)
+
+typedef struct
+{
+  GMutex *lock;
+  GCond *cond;
+
+  GstClockTime *timestamps;
+  GstBuffer **frames;
+
+  /* next timestamp to extract, and end of the current run */
+  guint index;
+  guint stop;
+
+  /* streaming thread only */
+  GstSegment segment;
+} GnlExtractData;
+
+static void
+extract_pad_added_cb (GstElement * comp G_GNUC_UNUSED, GstPad * pad,
+    GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  if (!gst_pad_is_linked (sinkpad))
+    gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static gboolean
+extract_event_probe (GstPad * pad G_GNUC_UNUSED, GstEvent * event,
+    GnlExtractData * data)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_NEWSEGMENT) {
+    gboolean update;
+    gdouble rate;
+    GstFormat format;
+    gint64 start, stop, position;
+
+    gst_event_parse_new_segment (event, &update, &rate, &format, &start,
+        &stop, &position);
+    gst_segment_set_newsegment (&data->segment, update, rate, format, start,
+        stop, position);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+extract_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GnlExtractData * data)
+{
+  GstClockTime start, stop;
+  gboolean found = FALSE;
+
+  if (!GST_BUFFER_TIMESTAMP_IS_VALID (buffer)
+      || (data->segment.format != GST_FORMAT_TIME))
+    return TRUE;
+
+  /* timeline position of the buffer */
+  start = gst_segment_to_stream_time (&data->segment, GST_FORMAT_TIME,
+      GST_BUFFER_TIMESTAMP (buffer));
+  if (!GST_CLOCK_TIME_IS_VALID (start))
+    return TRUE;
+  stop = start + (GST_BUFFER_DURATION_IS_VALID (buffer) ?
+      GST_BUFFER_DURATION (buffer) : 1);
+
+  g_mutex_lock (data->lock);
+  while ((data->index < data->stop) && (stop > data->timestamps[data->index])) {
+    GST_LOG ("frame for %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (data->timestamps[data->index]));
+    data->frames[data->index++] = gst_buffer_ref (buffer);
+    found = TRUE;
+  }
+  if (found)
+    g_cond_broadcast (data->cond);
+  g_mutex_unlock (data->lock);
+
+  return TRUE;
+}
+
+/*
+ * extract_wait:
+ *
+ * Waits for the current run to be extracted, or for the pipeline to fail.
+ * Returns FALSE if it failed.
+ */
+
+static gboolean
+extract_wait (GnlExtractData * data, GstBus * bus)
+{
+  GstMessage *message;
+  GTimeVal timeout;
+  guint index = G_MAXUINT;
+  GstClockTime waited = 0;
+  gboolean ret = TRUE;
+
+  g_mutex_lock (data->lock);
+  while (ret && data->index < data->stop) {
+    /* the timeout restarts every time a frame is extracted */
+    if (index != data->index) {
+      index = data->index;
+      waited = 0;
+    } else if (waited >= EXTRACT_TIMEOUT)
+      ret = FALSE;
+
+    g_get_current_time (&timeout);
+    g_time_val_add (&timeout, 100 * 1000);
+    g_cond_timed_wait (data->cond, data->lock, &timeout);
+    waited += 100 * GST_MSECOND;
+
+    g_mutex_unlock (data->lock);
+    while ((message = gst_bus_pop (bus))) {
+      switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ERROR:
+        case GST_MESSAGE_EOS:
+          ret = FALSE;
+          break;
+        default:
+          break;
+      }
+      gst_message_unref (message);
+    }
+    g_mutex_lock (data->lock);
+  }
+
+  /* give up on the frames of this run which weren't output */
+  data->index = data->stop;
+  g_mutex_unlock (data->lock);
+
+  return ret;
+}
+
+static GValueArray *
+gnl_composition_extract_frames (GnlComposition * comp,
+    GValueArray * timestamps)
+{
+  GnlExtractData data = { 0, };
+  GValueArray *ret;
+  GstElement *pipeline, *clone, *sink;
+  GstPad *sinkpad;
+  GstBus *bus;
+  GValue val = { 0, };
+  guint i, n = timestamps->n_values;
+
+  data.timestamps = g_new0 (GstClockTime, n);
+  data.frames = g_new0 (GstBuffer *, n);
+
+  for (i = 0; i < n; i++) {
+    data.timestamps[i] = g_value_get_uint64 (&timestamps->values[i]);
+    if (i && (data.timestamps[i] < data.timestamps[i - 1])) {
+      GST_WARNING_OBJECT (comp, "Timestamps aren't sorted");
+      g_free (data.timestamps);
+      g_free (data.frames);
+      return NULL;
+    }
+  }
+
+  if (!n || !(clone = gnl_composition_clone (comp)))
+    goto done;
 
-  if (stack) {
-    guint32 top_priority;
+  data.lock = g_mutex_new ();
+  data.cond = g_cond_new ();
+  gst_segment_init (&data.segment, GST_FORMAT_UNDEFINED);
+
+  pipeline = gst_pipeline_new (NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), clone, sink, NULL);
+  g_signal_connect (clone, "pad-added", G_CALLBACK (extract_pad_added_cb),
+      sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_event_probe (sinkpad, G_CALLBACK (extract_event_probe), &data);
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (extract_buffer_probe),
+      &data);
+  gst_object_unref (sinkpad);
+
+  bus = gst_element_get_bus (pipeline);
+
+  if ((gst_element_set_state (pipeline, GST_STATE_PAUSED) ==
+          GST_STATE_CHANGE_FAILURE)
+      || (gst_element_get_state (pipeline, NULL, NULL, EXTRACT_TIMEOUT) !=
+          GST_STATE_CHANGE_SUCCESS)) {
+    GST_WARNING_OBJECT (comp, "Couldn't preroll the copy of the composition");
+    goto stop;
+  }
 
-    top_priority = ((GnlObject *) stack->data)->priority;
+  for (i = 0; i < n; i = data.stop) {
+    guint last;
+
+    /* Timestamps reached by decoding forward from this one */
+    for (last = i + 1; (last < n)
+        && (data.timestamps[last] - data.timestamps[last - 1] <=
+            EXTRACT_MAX_GAP); last++);
+
+    GST_DEBUG_OBJECT (comp, "Extracting %u frames from %" GST_TIME_FORMAT
+        " to %" GST_TIME_FORMAT, last - i, GST_TIME_ARGS (data.timestamps[i]),
+        GST_TIME_ARGS (data.timestamps[last - 1]));
+
+    gst_element_set_state (pipeline, GST_STATE_PAUSED);
+    gst_bus_set_flushing (bus, TRUE);
+    gst_bus_set_flushing (bus, FALSE);
+
+    g_mutex_lock (data.lock);
+    data.index = i;
+    data.stop = last;
+    g_mutex_unlock (data.lock);
+
+    /* stop right after the last frame of the run */
+    if (!gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET,
+            data.timestamps[i], GST_SEEK_TYPE_SET,
+            data.timestamps[last - 1] + 1)) {
+      GST_WARNING_OBJECT (comp, "Couldn't seek to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (data.timestamps[i]));
+      continue;
+    }
 
-    /* Figure out if there's anything blocking us with smaller priority */
-    refine_start_stop_in_region_above_priority (comp, *timestamp, start, stop,
-        &start, &stop, (highprio == 0) ? top_priority : highprio);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    if (!extract_wait (&data, bus))
+      GST_WARNING_OBJECT (comp, "Stopped waiting for frames before %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (data.timestamps[last - 1]));
   }
 
-  if (*stop_time) {
-    if (stack)
-      *stop_time = stop;
-    else
-      *stop_time = 0;
-  }
+stop:
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+  g_cond_free (data.cond);
+  g_mutex_free (data.lock);
 
-  if (*start_time) {
-    if (stack)
-      *start_time = start;
-    else
-      *start_time = 0;
+done:
+  ret = g_value_array_new (n);
+  g_value_init (&val, GST_TYPE_BUFFER);
+  for (i = 0; i < n; i++) {
+    gst_value_take_mini_object (&val, (GstMiniObject *) data.frames[i]);
+    g_value_array_append (ret, &val);
   }
+  g_value_unset (&val);
 
-  GST_DEBUG_OBJECT (comp,
-      "Returning timestamp:%" GST_TIME_FORMAT " , start_time:%" GST_TIME_FORMAT
-      " , stop_time:%" GST_TIME_FORMAT, GST_TIME_ARGS (*timestamp),
-      GST_TIME_ARGS (*start_time), GST_TIME_ARGS (*stop_time));
+  g_free (data.timestamps);
+  g_free (data.frames);
 
-  return stack;
+  return ret;
 }
 
 
@@ -1311,6 +3679,8 @@ gnl_composition_change_state (GstElement * element, GstStateChange transition)
       gst_iterator_free (childs);
     }
 
+      start_eos_worker (comp);
+
       /* set ghostpad target */
       if (!(update_pipeline (comp, COMP_REAL_START (comp), TRUE, FALSE, TRUE))) {
         ret = GST_STATE_CHANGE_FAILURE;
@@ -1319,6 +3689,7 @@ gnl_composition_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     case GST_STATE_CHANGE_READY_TO_NULL:
+      stop_eos_worker (comp);
       gnl_composition_reset (comp);
       break;
     default:
@@ -1343,8 +3714,25 @@ beach:
   return ret;
 }
 
+/*
+ * objects_first:
+ *
+ * Returns: The first object of @objects, or NULL if it is empty.
+ */
+
+static GnlObject *
+objects_first (GSequence * objects)
+{
+  GSequenceIter *iter = g_sequence_get_begin_iter (objects);
+
+  if (g_sequence_iter_is_end (iter))
+    return NULL;
+  return (GnlObject *) g_sequence_get (iter);
+}
+
 static gint
-objects_start_compare (GnlObject * a, GnlObject * b)
+objects_start_compare (GnlObject * a, GnlObject * b,
+    gpointer udata G_GNUC_UNUSED)
 {
   if (a->start == b->start) {
     if (a->priority < b->priority)
@@ -1361,7 +3749,8 @@ objects_start_compare (GnlObject * a, GnlObject * b)
 }
 
 static gint
-objects_stop_compare (GnlObject * a, GnlObject * b)
+objects_stop_compare (GnlObject * a, GnlObject * b,
+    gpointer udata G_GNUC_UNUSED)
 {
   if (a->stop == b->stop) {
     if (a->priority < b->priority)
@@ -1377,48 +3766,85 @@ objects_stop_compare (GnlObject * a, GnlObject * b)
   return 0;
 }
 
+/*
+ * objects_start_search:
+ *
+ * GCompareDataFunc for g_sequence_search() on objects_start, which calls it
+ * with the objects of the sequence and @time. The returned iter points to
+ * the first object starting at or after @time.
+ */
+
+static gint
+objects_start_search (GnlObject * object, GstClockTime * time,
+    gpointer udata G_GNUC_UNUSED)
+{
+  return (object->start >= *time) ? 1 : -1;
+}
+
+/*
+ * objects_stop_search:
+ *
+ * Same for objects_stop, sorted by decreasing stop. The returned iter points
+ * to the first object stopping at or before @time.
+ */
+
+static gint
+objects_stop_search (GnlObject * object, GstClockTime * time,
+    gpointer udata G_GNUC_UNUSED)
+{
+  return (object->stop <= *time) ? 1 : -1;
+}
+
 static void
 update_start_stop_duration (GnlComposition * comp)
 {
+  GstClockTime start;
   GnlObject *obj;
   GnlObject *cobj = (GnlObject *) comp;
+  gboolean startchanged = FALSE;
+  gboolean stopchanged = FALSE;
+  gboolean durationchanged = FALSE;
 
-  if (!(comp->private->objects_start)) {
+  if (!objects_first (comp->private->objects_start)) {
     GST_LOG ("no objects, resetting everything to 0");
+    comp->private->expired_start = GST_CLOCK_TIME_NONE;
     if (cobj->start) {
       cobj->start = 0;
-      g_object_notify (G_OBJECT (cobj), "start");
+      startchanged = TRUE;
     }
     if (cobj->duration) {
       cobj->duration = 0;
-      g_object_notify (G_OBJECT (cobj), "duration");
-      signal_duration_change (comp);
+      durationchanged = TRUE;
     }
     if (cobj->stop) {
       cobj->stop = 0;
-      g_object_notify (G_OBJECT (cobj), "stop");
+      stopchanged = TRUE;
     }
-    return;
+    goto beach;
   }
 
   /* If we have a default object, the start position is 0 */
   if (comp->private->defaultobject) {
     if (cobj->start != 0) {
       cobj->start = 0;
-      g_object_notify (G_OBJECT (cobj), "start");
+      startchanged = TRUE;
     }
   } else {
-    /* Else it's the first object's start value */
-    obj = (GnlObject *) comp->private->objects_start->data;
-    if (obj->start != cobj->start) {
+    /* Else it's the first object's start value, or the start before objects
+     * expired */
+    obj = objects_first (comp->private->objects_start);
+    start = obj->start;
+    if (GST_CLOCK_TIME_IS_VALID (comp->private->expired_start))
+      start = MIN (start, comp->private->expired_start);
+    if (start != cobj->start) {
       GST_LOG_OBJECT (obj, "setting start from %s to %" GST_TIME_FORMAT,
-          GST_OBJECT_NAME (obj), GST_TIME_ARGS (obj->start));
-      cobj->start = obj->start;
-      g_object_notify (G_OBJECT (cobj), "start");
+          GST_OBJECT_NAME (obj), GST_TIME_ARGS (start));
+      cobj->start = start;
+      startchanged = TRUE;
     }
   }
 
-  obj = (GnlObject *) comp->private->objects_stop->data;
+  obj = objects_first (comp->private->objects_stop);
   if (obj->stop != cobj->stop) {
     GST_LOG_OBJECT (obj, "setting stop from %s to %" GST_TIME_FORMAT,
         GST_OBJECT_NAME (obj), GST_TIME_ARGS (obj->stop));
@@ -1429,11 +3855,25 @@ update_start_stop_duration (GnlComposition * comp)
     }
     comp->private->segment->stop = obj->stop;
     cobj->stop = obj->stop;
-    g_object_notify (G_OBJECT (cobj), "stop");
+    stopchanged = TRUE;
   }
 
   if ((cobj->stop - cobj->start) != cobj->duration) {
     cobj->duration = cobj->stop - cobj->start;
+    durationchanged = TRUE;
+  }
+
+beach:
+  /* The values are set directly, keep the transform used by
+   * translate_incoming_seek() and the nesting compositions in sync before
+   * anyone gets notified */
+  gnl_object_update_transform (cobj);
+
+  if (startchanged)
+    g_object_notify (G_OBJECT (cobj), "start");
+  if (stopchanged)
+    g_object_notify (G_OBJECT (cobj), "stop");
+  if (durationchanged) {
     g_object_notify (G_OBJECT (cobj), "duration");
     signal_duration_change (comp);
   }
@@ -1896,6 +4336,265 @@ beach:
   return res;
 }
 
+/*
+ * update_prefetch_stats:
+ *
+ * GNodeTraverseFunc counting the file sources of the new stack which
+ * weren't in the current one as hits or misses, depending on whether they
+ * were successfully prefetched.
+ * Must be called with the OBJECTS_LOCK.
+ */
+
+static gboolean
+update_prefetch_stats (GNode * node, GnlComposition * comp)
+{
+  GnlCompositionEntry *entry;
+
+  if (!GNL_IS_FILESOURCE (node->data))
+    return FALSE;
+  if (comp->private->current && g_node_find (comp->private->current,
+          G_PRE_ORDER, G_TRAVERSE_ALL, node->data))
+    return FALSE;
+
+  entry = COMP_ENTRY (comp, node->data);
+  if (entry->prefetched == PREFETCH_DONE)
+    comp->private->prefetch_hits++;
+  else
+    comp->private->prefetch_misses++;
+  entry->prefetched = PREFETCH_NONE;
+
+  return FALSE;
+}
+
+/*
+ * get_objects_to_prefetch:
+ *
+ * Returns a list of the file sources starting in the lookahead window after
+ * @stop which weren't prefetched yet, and marks them as pending. The objects
+ * are reffed.
+ * Must be called with the OBJECTS_LOCK.
+ */
+
+static GList *
+get_objects_to_prefetch (GnlComposition * comp, GstClockTime stop)
+{
+  GnlCompositionEntry *entry;
+  GnlObject *object;
+  GSequenceIter *iter;
+  GList *ret = NULL;
+
+  for (iter = g_sequence_search (comp->private->objects_start, &stop,
+          (GCompareDataFunc) objects_start_search, NULL);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    object = (GnlObject *) g_sequence_get (iter);
+
+    if (object->start - stop >= comp->private->lookahead)
+      break;
+    if (!object->active || !GNL_IS_FILESOURCE (object))
+      continue;
+
+    entry = COMP_ENTRY (comp, object);
+    if (entry->prefetched != PREFETCH_NONE)
+      continue;
+
+    entry->prefetched = PREFETCH_PENDING;
+    ret = g_list_prepend (ret, gst_object_ref (object));
+  }
+
+  return g_list_reverse (ret);
+}
+
+/*
+ * prefetch_job:
+ *
+ * GFunc of the prefetch thread pool. Prefetches the file of the job's object
+ * and, if the object is still waiting for it, marks it as prefetched only if
+ * that succeeded.
+ */
+
+static void
+prefetch_job (GnlPrefetchJob * job, gpointer user_data)
+{
+  GnlComposition *comp = job->comp;
+  GnlCompositionEntry *entry;
+  gboolean res;
+
+  res = gnl_filesource_prefetch ((GnlFileSource *) job->object);
+  if (!res)
+    GST_DEBUG_OBJECT (comp, "Couldn't prefetch %s",
+        GST_OBJECT_NAME (job->object));
+
+  COMP_OBJECTS_LOCK (comp);
+  /* the object might have been removed, or used, in the meantime */
+  entry = COMP_ENTRY (comp, job->object);
+  if (entry && (entry->prefetched == PREFETCH_PENDING))
+    entry->prefetched = res ? PREFETCH_DONE : PREFETCH_NONE;
+  COMP_OBJECTS_UNLOCK (comp);
+
+  gst_object_unref (job->object);
+  gst_object_unref (comp);
+  g_free (job);
+}
+
+/*
+ * push_prefetch_jobs:
+ *
+ * Queues the prefetching of the (reffed) objects in @prefetch, creating the
+ * shared thread pool if needed. Takes ownership of the list.
+ * Must be called without the OBJECTS_LOCK.
+ */
+
+static void
+push_prefetch_jobs (GnlComposition * comp, GList * prefetch)
+{
+  GnlPrefetchJob *job;
+  GList *tmp;
+
+  g_static_mutex_lock (&prefetch_lock);
+  if (!prefetch_pool)
+    prefetch_pool = g_thread_pool_new ((GFunc) prefetch_job, NULL,
+        MAX_PREFETCH_THREADS, FALSE, NULL);
+  g_static_mutex_unlock (&prefetch_lock);
+
+  for (tmp = prefetch; tmp; tmp = g_list_next (tmp)) {
+    job = g_new0 (GnlPrefetchJob, 1);
+    job->comp = gst_object_ref (comp);
+    job->object = (GnlObject *) tmp->data;
+
+    if (prefetch_pool) {
+      g_thread_pool_push (prefetch_pool, job, NULL);
+    } else {
+      /* Couldn't create the pool, prefetch from here */
+      prefetch_job (job, NULL);
+    }
+  }
+  g_list_free (prefetch);
+}
+
+/*
+ * publish_boundaries:
+ *
+ * Updates the list of stack boundaries read by the compositions following
+ * @comp, from its schedule. Does nothing if @comp isn't followed.
+ * Must be called with the OBJECTS_LOCK.
+ */
+
+static void
+publish_boundaries (GnlComposition * comp)
+{
+  GnlObject *cobj = (GnlObject *) comp;
+  GArray *boundaries;
+  GList *tmp;
+
+  if (!g_atomic_int_get (&comp->private->followers))
+    return;
+
+  refresh_schedule (comp);
+
+  boundaries = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  /* Objects only start after a leading gap */
+  if (cobj->start > 0)
+    g_array_append_val (boundaries, cobj->start);
+  for (tmp = comp->private->schedule; tmp; tmp = tmp->next)
+    g_array_append_val (boundaries, ((GnlScheduleEntry *) tmp->data)->stop);
+
+  g_mutex_lock (comp->private->boundaries_lock);
+  g_array_free (comp->private->boundaries, TRUE);
+  comp->private->boundaries = boundaries;
+  g_mutex_unlock (comp->private->boundaries_lock);
+
+  GST_LOG_OBJECT (comp, "Published %u stack boundaries", boundaries->len);
+}
+
+/*
+ * get_master_boundary:
+ *
+ * Returns the first stack boundary of @master after @time, or
+ * GST_CLOCK_TIME_NONE if there's none.
+ * Only reads the boundaries published by @master, without taking its
+ * OBJECTS_LOCK, so it can be called with ours.
+ */
+
+static GstClockTime
+get_master_boundary (GnlComposition * master, GstClockTime time)
+{
+  GArray *boundaries;
+  GstClockTime ret = GST_CLOCK_TIME_NONE;
+  guint low = 0, high, mid;
+
+  g_mutex_lock (master->private->boundaries_lock);
+  boundaries = master->private->boundaries;
+  high = boundaries->len;
+  while (low < high) {
+    mid = (low + high) / 2;
+    if (g_array_index (boundaries, GstClockTime, mid) > time)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  if (low < boundaries->len)
+    ret = g_array_index (boundaries, GstClockTime, low);
+  g_mutex_unlock (master->private->boundaries_lock);
+
+  return ret;
+}
+
+/*
+ * get_expired_objects:
+ *
+ * Returns a list of the objects stopping before @cutoff which aren't used in
+ * @stack. The objects are reffed.
+ * Must be called with the OBJECTS_LOCK.
+ */
+
+static GList *
+get_expired_objects (GnlComposition * comp, GNode * stack,
+    GstClockTime cutoff)
+{
+  GnlObject *object;
+  GSequenceIter *iter;
+  GList *ret = NULL;
+
+  for (iter = g_sequence_get_begin_iter (comp->private->objects_start);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    object = (GnlObject *) g_sequence_get (iter);
+
+    if (object->start >= cutoff)
+      break;
+    if (object->stop > cutoff || (stack
+            && g_node_find (stack, G_PRE_ORDER, G_TRAVERSE_ALL, object)))
+      continue;
+
+    ret = g_list_prepend (ret, gst_object_ref (object));
+  }
+
+  return ret;
+}
+
+/*
+ * remove_expired_objects:
+ *
+ * Removes the (reffed) objects of @expired, as returned by
+ * get_expired_objects(), from @comp. Takes ownership of the list.
+ * Must be called without the OBJECTS_LOCK.
+ */
+
+static void
+remove_expired_objects (GnlComposition * comp, GList * expired)
+{
+  GList *tmp;
+
+  for (tmp = expired; tmp; tmp = g_list_next (tmp)) {
+    GST_DEBUG_OBJECT (comp, "Removing expired object %s",
+        GST_OBJECT_NAME (tmp->data));
+    gst_element_set_locked_state (GST_ELEMENT (tmp->data), FALSE);
+    gst_element_set_state (GST_ELEMENT (tmp->data), GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (comp), GST_ELEMENT (tmp->data));
+    gst_object_unref (tmp->data);
+  }
+  g_list_free (expired);
+}
+
 /*
  * update_pipeline:
  * @comp: The #GnlComposition
@@ -1924,6 +4623,7 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
   COMP_OBJECTS_LOCK (comp);
 
   update_start_stop_duration (comp);
+  publish_boundaries (comp);
 
   if ((GST_CLOCK_TIME_IS_VALID (currenttime))) {
     GstState state = GST_STATE (comp);
@@ -1932,10 +4632,13 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
         GST_STATE_VOID_PENDING) ? GST_STATE (comp) : GST_STATE_NEXT (comp);
     GNode *stack = NULL;
     GList *deactivate = NULL;
+    GList *prefetch = NULL;
+    GList *expired = NULL;
     GstClockTime new_start = GST_CLOCK_TIME_NONE;
     GstClockTime new_stop = GST_CLOCK_TIME_NONE;
     gboolean samestack = FALSE;
     gboolean startchanged, stopchanged;
+    gboolean reverse = (comp->private->segment->rate < 0.0);
 
     GST_DEBUG_OBJECT (comp,
         "now really updating the pipeline, current-state:%s",
@@ -1943,13 +4646,47 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
 
 
     /* (re)build the stack and relink new elements */
-    stack =
-        get_clean_toplevel_stack (comp, &currenttime, &new_start, &new_stop);
+    if (reverse)
+      stack = get_clean_toplevel_stack_reverse (comp, &currenttime, &new_start,
+          &new_stop);
+    else
+      stack =
+          get_clean_toplevel_stack (comp, &currenttime, &new_start, &new_stop);
     samestack = are_same_stacks (comp->private->current, stack);
 
-    if (!samestack)
+    /* Also stop at the next stack change of our master */
+    if (stack && comp->private->master && !reverse) {
+      GstClockTime mstop =
+          get_master_boundary (comp->private->master, currenttime);
+
+      if (GST_CLOCK_TIME_IS_VALID (mstop) && (mstop > currenttime)
+          && (mstop < new_stop)) {
+        GST_DEBUG_OBJECT (comp, "Stopping at master boundary %"
+            GST_TIME_FORMAT, GST_TIME_ARGS (mstop));
+        new_stop = mstop;
+      }
+    }
+
+    if (!samestack) {
       deactivate = compare_relink_stack (comp, stack, modify);
 
+      /* Prefetching and expiring only make sense going forward */
+      if (comp->private->lookahead && stack && !reverse) {
+        g_node_traverse (stack, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+            (GNodeTraverseFunc) update_prefetch_stats, comp);
+        prefetch = get_objects_to_prefetch (comp, new_stop);
+      }
+
+      if (GST_CLOCK_TIME_IS_VALID (comp->private->retention_window)
+          && !reverse && currenttime > comp->private->retention_window)
+        expired = get_expired_objects (comp, stack,
+            currenttime - comp->private->retention_window);
+
+      /* Expiring objects doesn't move the start of the composition */
+      if (expired && !GST_CLOCK_TIME_IS_VALID (comp->private->expired_start))
+        comp->private->expired_start = ((GnlObject *) comp)->start;
+    }
+
     startchanged = comp->private->segment_start != currenttime;
     stopchanged = comp->private->segment_stop != new_stop;
 
@@ -1989,6 +4726,9 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
       GST_DEBUG_OBJECT (comp, "Finished de-activating objects no longer used");
     }
 
+    if (prefetch)
+      push_prefetch_jobs (comp, prefetch);
+
     comp->private->current = stack;
 
     GST_DEBUG_OBJECT (comp, "activating objects in new stack to %s",
@@ -1998,6 +4738,10 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
       unlock_activate_stack (comp, stack, change_state, nextstate);
     GST_DEBUG_OBJECT (comp, "Finished activating objects in new stack");
 
+    if (comp->private->smart_render && stack && (!samestack || startchanged
+            || stopchanged))
+      prepare_smart_render_message (comp, stack);
+
     if (comp->private->current) {
       GstEvent *event;
 
@@ -2009,7 +4753,8 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
       if (samestack && (startchanged || stopchanged))
         event =
             get_new_seek_event (comp,
-            (state == GST_STATE_PLAYING) ? FALSE : TRUE, !startchanged);
+            (state == GST_STATE_PLAYING) ? FALSE : TRUE, !startchanged
+            && !reverse);
       else
         event = get_new_seek_event (comp, initial, FALSE);
 
@@ -2058,7 +4803,8 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
       COMP_OBJECTS_UNLOCK (comp);
 
     } else {
-      if ((!comp->private->objects_start) && comp->private->ghostpad) {
+      if (!objects_first (comp->private->objects_start)
+          && comp->private->ghostpad) {
         GST_DEBUG_OBJECT (comp, "composition is now empty, removing ghostpad");
         gnl_object_remove_ghost_pad ((GnlObject *) comp,
             comp->private->ghostpad);
@@ -2068,6 +4814,11 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
         comp->private->segment_stop = GST_CLOCK_TIME_NONE;
       }
     }
+
+    /* Remove the expired objects once the new stack is in place and without
+     * the OBJECTS_LOCK, since removing takes it */
+    if (expired)
+      remove_expired_objects (comp, expired);
   } else {
     COMP_OBJECTS_UNLOCK (comp);
   }
@@ -2080,6 +4831,46 @@ update_pipeline (GnlComposition * comp, GstClockTime currenttime,
  * Child modification updates
  */
 
+/*
+ * timeline_changed:
+ *
+ * Updates the start/stop/duration of @comp, and the boundaries published to
+ * its followers, after a modification which didn't touch the current stack.
+ * Must be called without the OBJECTS_LOCK.
+ */
+
+static void
+timeline_changed (GnlComposition * comp)
+{
+  update_start_stop_duration (comp);
+
+  COMP_OBJECTS_LOCK (comp);
+  publish_boundaries (comp);
+  COMP_OBJECTS_UNLOCK (comp);
+}
+
+/*
+ * resort_object:
+ *
+ * Moves @object to its new place in objects_start and objects_stop after
+ * its start, stop or priority changed.
+ */
+
+static void
+resort_object (GnlComposition * comp, GnlObject * object)
+{
+  GnlCompositionEntry *entry;
+
+  COMP_OBJECTS_LOCK (comp);
+  if ((entry = COMP_ENTRY (comp, object)) && entry->start_iter) {
+    g_sequence_sort_changed (entry->start_iter,
+        (GCompareDataFunc) objects_start_compare, NULL);
+    g_sequence_sort_changed (entry->stop_iter,
+        (GCompareDataFunc) objects_stop_compare, NULL);
+  }
+  COMP_OBJECTS_UNLOCK (comp);
+}
+
 static void
 object_start_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
     GnlComposition * comp)
@@ -2087,11 +4878,9 @@ object_start_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
   GST_DEBUG_OBJECT (object, "start position changed (%" GST_TIME_FORMAT
       "), evaluating pipeline update", GST_TIME_ARGS (object->start));
 
-  comp->private->objects_start = g_list_sort
-      (comp->private->objects_start, (GCompareFunc) objects_start_compare);
+  schedule_object_changed (comp, object);
 
-  comp->private->objects_stop = g_list_sort
-      (comp->private->objects_stop, (GCompareFunc) objects_stop_compare);
+  resort_object (comp, object);
 
   if (comp->private->current && (OBJECT_IN_ACTIVE_SEGMENT (comp, object) ||
           g_node_find (comp->private->current,
@@ -2101,7 +4890,7 @@ object_start_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
       curpos = comp->private->segment->start = comp->private->segment_start;
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   } else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
 }
 
 static void
@@ -2111,11 +4900,9 @@ object_stop_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
   GST_DEBUG_OBJECT (object, "stop position changed (%" GST_TIME_FORMAT
       "), evaluating pipeline update", GST_TIME_ARGS (object->stop));
 
-  comp->private->objects_stop = g_list_sort
-      (comp->private->objects_stop, (GCompareFunc) objects_stop_compare);
+  schedule_object_changed (comp, object);
 
-  comp->private->objects_start = g_list_sort
-      (comp->private->objects_start, (GCompareFunc) objects_start_compare);
+  resort_object (comp, object);
 
   if (comp->private->current && (OBJECT_IN_ACTIVE_SEGMENT (comp, object) ||
           g_node_find (comp->private->current,
@@ -2125,7 +4912,7 @@ object_stop_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
       curpos = comp->private->segment->start = comp->private->segment_start;
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   } else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
 }
 
 static void
@@ -2135,11 +4922,9 @@ object_priority_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
   GST_DEBUG_OBJECT (object, "priority changed (%u), evaluating pipeline update",
       object->priority);
 
-  comp->private->objects_start = g_list_sort
-      (comp->private->objects_start, (GCompareFunc) objects_start_compare);
+  schedule_object_changed (comp, object);
 
-  comp->private->objects_stop = g_list_sort
-      (comp->private->objects_stop, (GCompareFunc) objects_stop_compare);
+  resort_object (comp, object);
 
   if (comp->private->current && OBJECT_IN_ACTIVE_SEGMENT (comp, object)) {
     GstClockTime curpos = get_current_position (comp);
@@ -2147,7 +4932,7 @@ object_priority_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
       curpos = comp->private->segment->start = comp->private->segment_start;
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   } else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
 }
 
 static void
@@ -2157,13 +4942,43 @@ object_active_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
   GST_DEBUG_OBJECT (object,
       "active flag changed (%d), evaluating pipeline update", object->active);
 
+  schedule_object_changed (comp, object);
+
+  if (comp->private->current && OBJECT_IN_ACTIVE_SEGMENT (comp, object)) {
+    GstClockTime curpos = get_current_position (comp);
+    if (curpos == GST_CLOCK_TIME_NONE)
+      curpos = comp->private->segment->start = comp->private->segment_start;
+    update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
+  } else
+    timeline_changed (comp);
+}
+
+static void
+object_opaque_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
+    GnlComposition * comp)
+{
+  GST_DEBUG_OBJECT (object,
+      "opaque flag changed (%d), evaluating pipeline update", object->opaque);
+
+  schedule_object_changed (comp, object);
+
   if (comp->private->current && OBJECT_IN_ACTIVE_SEGMENT (comp, object)) {
     GstClockTime curpos = get_current_position (comp);
     if (curpos == GST_CLOCK_TIME_NONE)
       curpos = comp->private->segment->start = comp->private->segment_start;
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   } else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
+}
+
+/* Like degraded mode being switched, only affects the next stacks */
+static void
+object_optional_changed (GnlObject * object, GParamSpec * arg G_GNUC_UNUSED,
+    GnlComposition * comp)
+{
+  GST_DEBUG_OBJECT (object, "optional flag changed (%d)", object->optional);
+
+  schedule_object_changed (comp, object);
 }
 
 static void
@@ -2238,6 +5053,9 @@ gnl_composition_add_object (GstBin * bin, GstElement * element)
   GST_LOG_OBJECT (bin, "Locking state of %s", GST_ELEMENT_NAME (element));
   gst_element_set_locked_state (element, TRUE);
 
+  if (comp->private->proxy || comp->private->degraded)
+    apply_proxy ((GnlObject *) element, comp);
+
   /* wrap new element in a GnlCompositionEntry ... */
   entry = g_new0 (GnlCompositionEntry, 1);
   entry->object = (GnlObject *) element;
@@ -2259,6 +5077,10 @@ gnl_composition_add_object (GstBin * bin, GstElement * element)
   }
   entry->activehandler = g_signal_connect (G_OBJECT (element),
       "notify::active", G_CALLBACK (object_active_changed), comp);
+  entry->opaquehandler = g_signal_connect (G_OBJECT (element),
+      "notify::opaque", G_CALLBACK (object_opaque_changed), comp);
+  entry->optionalhandler = g_signal_connect (G_OBJECT (element),
+      "notify::optional", G_CALLBACK (object_optional_changed), comp);
   entry->padremovedhandler = g_signal_connect (G_OBJECT (element),
       "pad-removed", G_CALLBACK (object_pad_removed), comp);
   entry->padaddedhandler = g_signal_connect (G_OBJECT (element),
@@ -2271,39 +5093,23 @@ gnl_composition_add_object (GstBin * bin, GstElement * element)
   if (((GnlObject *) element)->priority == G_MAXUINT32) {
     /* It doesn't get added to objects_start and objects_stop. */
     comp->private->defaultobject = ((GnlObject *) element);
+    invalidate_schedule (comp, 0, GST_CLOCK_TIME_NONE);
     goto chiringuito;
   }
 
-  /* add it sorted to the objects list */
-  comp->private->objects_start = g_list_append
-      (comp->private->objects_start, element);
-  comp->private->objects_start = g_list_sort
-      (comp->private->objects_start, (GCompareFunc) objects_start_compare);
+  entry->start = ((GnlObject *) element)->start;
+  entry->stop = ((GnlObject *) element)->stop;
+  invalidate_schedule (comp, entry->start, entry->stop);
 
-  if (comp->private->objects_start)
-    GST_LOG_OBJECT (comp,
-        "Head of objects_start is now %s [%" GST_TIME_FORMAT "--%"
-        GST_TIME_FORMAT "]",
-        GST_OBJECT_NAME (comp->private->objects_start->data),
-        GST_TIME_ARGS (((GnlObject *)
-                comp->private->objects_start->data)->start),
-        GST_TIME_ARGS (((GnlObject *)
-                comp->private->objects_start->data)->stop));
-
-  comp->private->objects_stop = g_list_append
-      (comp->private->objects_stop, element);
-  comp->private->objects_stop = g_list_sort
-      (comp->private->objects_stop, (GCompareFunc) objects_stop_compare);
-
-  if (comp->private->objects_stop)
-    GST_LOG_OBJECT (comp,
-        "Head of objects_stop is now %s [%" GST_TIME_FORMAT "--%"
-        GST_TIME_FORMAT "]",
-        GST_OBJECT_NAME (comp->private->objects_stop->data),
-        GST_TIME_ARGS (((GnlObject *)
-                comp->private->objects_stop->data)->start),
-        GST_TIME_ARGS (((GnlObject *)
-                comp->private->objects_stop->data)->stop));
+  /* add it sorted to the objects sequences, in O(log n) */
+  entry->start_iter = g_sequence_insert_sorted (comp->private->objects_start,
+      element, (GCompareDataFunc) objects_start_compare, NULL);
+  entry->stop_iter = g_sequence_insert_sorted (comp->private->objects_stop,
+      element, (GCompareDataFunc) objects_stop_compare, NULL);
+
+  GST_LOG_OBJECT (comp, "Head of objects_start is now %s, of objects_stop %s",
+      GST_OBJECT_NAME (objects_first (comp->private->objects_start)),
+      GST_OBJECT_NAME (objects_first (comp->private->objects_stop)));
 
   GST_DEBUG_OBJECT (comp,
       "segment_start:%" GST_TIME_FORMAT " segment_stop:%" GST_TIME_FORMAT,
@@ -2320,7 +5126,7 @@ gnl_composition_add_object (GstBin * bin, GstElement * element)
   if (OBJECT_IN_ACTIVE_SEGMENT (comp, element) || (!comp->private->current))
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
 
 beach:
   gst_object_unref (element);
@@ -2328,7 +5134,7 @@ beach:
 
 chiringuito:
   COMP_OBJECTS_UNLOCK (comp);
-  update_start_stop_duration (comp);
+  timeline_changed (comp);
   goto beach;
 }
 
@@ -2339,6 +5145,7 @@ gnl_composition_remove_object (GstBin * bin, GstElement * element)
   gboolean ret = GST_STATE_CHANGE_FAILURE;
   GnlComposition *comp = (GnlComposition *) bin;
   GstClockTime curpos;
+  GnlCompositionEntry *entry;
 
   GST_DEBUG_OBJECT (bin, "element %s", GST_OBJECT_NAME (element));
   /* we only accept GnlObject */
@@ -2353,17 +5160,19 @@ gnl_composition_remove_object (GstBin * bin, GstElement * element)
   /* handle default source */
   if (((GnlObject *) element)->priority == G_MAXUINT32) {
     comp->private->defaultobject = NULL;
+    invalidate_schedule (comp, 0, GST_CLOCK_TIME_NONE);
+    if ((GnlObject *) element == comp->private->gapobject) {
+      comp->private->gapobject = NULL;
+      comp->private->gapsrc = NULL;
+    }
   } else {
-    /* remove it from the objects list and resort the lists */
-    comp->private->objects_start = g_list_remove
-        (comp->private->objects_start, element);
-    comp->private->objects_start = g_list_sort
-        (comp->private->objects_start, (GCompareFunc) objects_start_compare);
-
-    comp->private->objects_stop = g_list_remove
-        (comp->private->objects_stop, element);
-    comp->private->objects_stop = g_list_sort
-        (comp->private->objects_stop, (GCompareFunc) objects_stop_compare);
+    /* remove it from the objects sequences, they stay sorted */
+    if ((entry = COMP_ENTRY (comp, element))) {
+      g_sequence_remove (entry->start_iter);
+      g_sequence_remove (entry->stop_iter);
+      entry->start_iter = entry->stop_iter = NULL;
+      invalidate_schedule (comp, entry->start, entry->stop);
+    }
 
     GST_LOG_OBJECT (element, "Removed from the objects start/stop list");
   }
@@ -2382,7 +5191,7 @@ gnl_composition_remove_object (GstBin * bin, GstElement * element)
       || (((GnlObject *) element)->priority == G_MAXUINT32))
     update_pipeline (comp, curpos, TRUE, TRUE, TRUE);
   else
-    update_start_stop_duration (comp);
+    timeline_changed (comp);
 
   ret = GST_BIN_CLASS (parent_class)->remove_element (bin, element);
 
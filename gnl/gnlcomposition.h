@@ -54,9 +54,20 @@ struct _GnlComposition
 struct _GnlCompositionClass
 {
   GnlObjectClass parent_class;
+
+  /* action signals */
+  GValueArray *(*get_partitions) (GnlComposition * comp, guint n);
+  GstElement *(*clone) (GnlComposition * comp);
+  GValueArray *(*query_range) (GnlComposition * comp, guint64 start,
+      guint64 stop, guint minprio, guint maxprio);
+  GValueArray *(*get_schedule) (GnlComposition * comp);
+  GValueArray *(*extract_frames) (GnlComposition * comp,
+      GValueArray * timestamps);
 };
 
 GType gnl_composition_get_type (void);
 
+GnlCache *gnl_composition_get_cache (GnlComposition * comp);
+
 G_END_DECLS
 #endif /* __GNL_COMPOSITION_H__ */
@@ -22,8 +22,15 @@
 #include "config.h"
 #endif
 
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 #include "gnl.h"
 
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /**
  * SECTION:element-gnlfilesource
  * @short_description: GNonLin File Source
@@ -55,18 +62,47 @@ enum
 {
   ARG_0,
   ARG_LOCATION,
+  ARG_PASSTHROUGH_CAPS,
+  ARG_USE_MMAP,
+  ARG_PROXY_LOCATION,
+  ARG_USE_PROXY,
+  ARG_AUDIO_CACHE_DIR,
+  ARG_AUDIO_CACHE_CAPS,
 };
 
 struct _GnlFileSourcePrivate
 {
   gboolean dispose_has_run;
   GstElement *filesource;
+  GstElement *decodebin;
+  gchar *location;
+  gchar *proxy_location;
+  gboolean use_proxy;
+  GstCaps *passthrough_caps;
+  gboolean use_mmap;
+  /* TRUE if filesource is the mmap filesrc */
+  gboolean mmapped;
+
+  /* decoded audio cache, disabled if dir is NULL */
+  gchar *audio_cache_dir;
+  GstCaps *audio_cache_caps;
+
+  /* duration of the file, learnt the last time it was played */
+  GstClockTime file_duration;
 };
 
+/* Amount of data at the start of files needed for typefinding/headers */
+#define PREFETCH_HEAD_SIZE (1024 * 1024)
+
+static GstElementClass *source_class = NULL;
+
 static void gnl_filesource_dispose (GObject * object);
 
 static void gnl_filesource_finalize (GObject * object);
 
+static GstStateChangeReturn
+gnl_filesource_change_state (GstElement * element, GstStateChange transition);
+
 static void
 gnl_filesource_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -75,6 +111,8 @@ static void
 gnl_filesource_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
+static GstElement *gnl_filesource_make_cache_src (GnlSource * source);
+
 static void
 gnl_filesource_base_init (gpointer g_class)
 {
@@ -97,8 +135,11 @@ gnl_filesource_class_init (GnlFileSourceClass * klass)
   gnlsource_class = (GnlSourceClass *) klass;
 
   parent_class = g_type_class_ref (GNL_TYPE_OBJECT);
+  source_class = g_type_class_peek_parent (klass);
 
   gnlsource_class->controls_one = FALSE;
+  gnlsource_class->make_cache_src =
+      GST_DEBUG_FUNCPTR (gnl_filesource_make_cache_src);
 
   GST_DEBUG_CATEGORY_INIT (gnlfilesource, "gnlfilesource",
       GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin File Source Element");
@@ -109,23 +150,188 @@ gnl_filesource_class_init (GnlFileSourceClass * klass)
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gnl_filesource_set_property);
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gnl_filesource_get_property);
 
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gnl_filesource_change_state);
+
   gst_element_class_install_std_props (GST_ELEMENT_CLASS (klass),
       "location", ARG_LOCATION, G_PARAM_READWRITE, NULL);
 
+  /**
+   * GnlFileSource:passthrough-caps:
+   *
+   * Encoded formats that should be output as-is instead of being decoded,
+   * ex: to pass compressed data through untouched segments when
+   * smart-rendering a #GnlComposition.
+   *
+   * Only supported with decodebin2 (USE_DECODEBIN2 environment variable).
+   */
+  g_object_class_install_property (gobject_class, ARG_PASSTHROUGH_CAPS,
+      g_param_spec_boxed ("passthrough-caps", "Passthrough caps",
+          "Encoded formats to output without decoding them",
+          GST_TYPE_CAPS, G_PARAM_READWRITE));
+
+  /**
+   * GnlFileSource:use-mmap:
+   *
+   * Read the file with a memory-mapping filesrc, whose buffers point
+   * directly to the page cache instead of being copied. Useful for local
+   * high-bitrate files. Other locations (ex: http:// uris) are still read
+   * with gnomevfssrc.
+   *
+   * Must be set before the object goes to READY.
+   */
+  g_object_class_install_property (gobject_class, ARG_USE_MMAP,
+      g_param_spec_boolean ("use-mmap", "Use mmap",
+          "Read local files through mmap() instead of read()",
+          FALSE, G_PARAM_READWRITE));
+
+  /**
+   * GnlFileSource:proxy-location:
+   *
+   * Location of a lighter version of the media (ex: low-resolution), with the
+   * same duration and timestamps, decoded instead of the
+   * #GnlFileSource:location when #GnlFileSource:use-proxy is set.
+   */
+  g_object_class_install_property (gobject_class, ARG_PROXY_LOCATION,
+      g_param_spec_string ("proxy-location", "Proxy location",
+          "Location of the proxy media", NULL, G_PARAM_READWRITE));
+
+  /**
+   * GnlFileSource:use-proxy:
+   *
+   * Decode the #GnlFileSource:proxy-location, if any, instead of the
+   * #GnlFileSource:location. Changes are applied the next time the source
+   * goes to PAUSED, so that a #GnlComposition switches to the proxies at
+   * its next stack switch.
+   *
+   * Usually set through the #GnlComposition:proxy property.
+   */
+  g_object_class_install_property (gobject_class, ARG_USE_PROXY,
+      g_param_spec_boolean ("use-proxy", "Use proxy",
+          "Decode the proxy media instead of the original one",
+          FALSE, G_PARAM_READWRITE));
+
+  /**
+   * GnlFileSource:audio-cache-dir:
+   *
+   * Directory in which the audio of the file is decoded once, in the
+   * background, to raw samples in the #GnlFileSource:audio-cache-caps
+   * format. Once that is done the source memory-maps the samples instead of
+   * decoding the file, making seeks immediate and exact to the sample.
+   *
+   * Only used for local files, and if the caps of the source are restricted
+   * to audio. NULL disables the cache.
+   */
+  g_object_class_install_property (gobject_class, ARG_AUDIO_CACHE_DIR,
+      g_param_spec_string ("audio-cache-dir", "Audio cache directory",
+          "Directory of the decoded audio files (NULL = no cache)", NULL,
+          G_PARAM_READWRITE));
+
+  /**
+   * GnlFileSource:audio-cache-caps:
+   *
+   * Fixed raw audio caps the audio is decoded to in the
+   * #GnlFileSource:audio-cache-dir, usually the format of the output of the
+   * composition. Defaults to 48kHz stereo 16bit samples.
+   */
+  g_object_class_install_property (gobject_class, ARG_AUDIO_CACHE_CAPS,
+      g_param_spec_boxed ("audio-cache-caps", "Audio cache caps",
+          "Format of the decoded audio files", GST_TYPE_CAPS,
+          G_PARAM_READWRITE));
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gnl_filesource_src_template));
 }
 
+/*
+ * get_location:
+ *
+ * Returns: The location of the media to decode.
+ */
+
+static const gchar *
+get_location (GnlFileSource * fs)
+{
+  if (fs->private->use_proxy && fs->private->proxy_location)
+    return fs->private->proxy_location;
+
+  return fs->private->location;
+}
+
 static void
-gnl_filesource_init (GnlFileSource * filesource,
-    GnlFileSourceClass * klass G_GNUC_UNUSED)
+gnl_filesource_apply_passthrough_caps (GnlFileSource * fs)
 {
-  GstElement *filesrc, *decodebin;
+  GstCaps *dcaps;
 
-  GST_OBJECT_FLAG_SET (filesource, GNL_OBJECT_SOURCE);
-  filesource->private = g_new0 (GnlFileSourcePrivate, 1);
+  if (!fs->private->decodebin)
+    return;
 
-  /* We create a bin with source and decodebin within */
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS
+          (fs->private->decodebin), "caps")) {
+    GST_WARNING_OBJECT (fs,
+        "decodebin can't output encoded streams, use decodebin2 for passthrough");
+    return;
+  }
+
+  /* decodebin2 stops decoding when reaching any of those caps */
+  dcaps = gst_caps_from_string (GNL_DEFAULT_RAW_CAPS);
+  if (fs->private->passthrough_caps)
+    gst_caps_append (dcaps, gst_caps_copy (fs->private->passthrough_caps));
+
+  GST_DEBUG_OBJECT (fs, "decodebin final caps %" GST_PTR_FORMAT, dcaps);
+  g_object_set (fs->private->decodebin, "caps", dcaps, NULL);
+  gst_caps_unref (dcaps);
+}
+
+/*
+ * make_mmap_source:
+ *
+ * Returns a filesrc reading through mmap, or NULL if not available.
+ */
+
+static GstElement *
+make_mmap_source (GnlFileSource * fs)
+{
+  GstElement *filesrc;
+
+  if (!(filesrc = gst_element_factory_make ("filesrc", "internal-filesource")))
+    return NULL;
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (filesrc), "use-mmap")) {
+    GST_WARNING_OBJECT (fs, "filesrc doesn't support mmap");
+    gst_object_unref (filesrc);
+    return NULL;
+  }
+
+  /* Clips are read from media-start to media-stop, tell the kernel so, and
+   * don't fault in the pages before the demuxer needs them */
+  g_object_set (filesrc, "use-mmap", TRUE, "sequential", TRUE, "touch", FALSE,
+      NULL);
+
+  return filesrc;
+}
+
+/*
+ * make_source:
+ *
+ * Returns the element reading @location: a mmap filesrc for local files if
+ * use-mmap is set, else gnomevfssrc, or filesrc if it isn't available.
+ */
+
+static GstElement *
+make_source (GnlFileSource * fs, const gchar * location)
+{
+  GstElement *filesrc = NULL;
+  gchar *path;
+
+  fs->private->mmapped = FALSE;
+  if (fs->private->use_mmap && (path = gnl_get_local_path (location))) {
+    g_free (path);
+    if ((filesrc = make_mmap_source (fs))) {
+      fs->private->mmapped = TRUE;
+      return filesrc;
+    }
+  }
 
   if (!(filesrc =
           gst_element_factory_make ("gnomevfssrc", "internal-filesource")))
@@ -133,6 +339,136 @@ gnl_filesource_init (GnlFileSource * filesource,
             gst_element_factory_make ("filesrc", "internal-filesource")))
       g_warning
           ("Could not create a gnomevfssrc or filesource element, are you sure you have any of them installed ?");
+
+  return filesrc;
+}
+
+/*
+ * replace_source:
+ *
+ * Replaces the source element by one able to read @location, when switching
+ * between local and remote locations (ex: to/from a proxy) with use-mmap.
+ */
+
+static void
+replace_source (GnlFileSource * fs, const gchar * location)
+{
+  GstElement *filesrc;
+
+  GST_DEBUG_OBJECT (fs, "Replacing source element for %s", location);
+
+  gst_element_set_state (fs->private->filesource, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (fs), fs->private->filesource);
+  fs->private->filesource = NULL;
+
+  if (!(filesrc = make_source (fs, location)))
+    return;
+
+  fs->private->filesource = filesrc;
+  gst_bin_add (GST_BIN (fs), filesrc);
+  if (!(gst_element_link (filesrc, fs->private->decodebin)))
+    g_warning ("Could not link the file source element to decodebin");
+  gst_element_sync_state_with_parent (filesrc);
+}
+
+/*
+ * get_cache_key:
+ *
+ * Returns: The key under which the decoded buffers of @location are shared.
+ * For local files it also contains their modification time and size, so
+ * that the buffers decoded before a file was rewritten aren't used.
+ */
+
+static gchar *
+get_cache_key (const gchar * location)
+{
+  gchar *path, *ret;
+  struct stat st;
+
+  if (!location)
+    return NULL;
+
+  if ((path = gnl_get_local_path (location)) && (g_stat (path, &st) == 0))
+    ret = g_strdup_printf ("%s|%" G_GINT64_FORMAT "|%" G_GINT64_FORMAT,
+        location, (gint64) st.st_mtime, (gint64) st.st_size);
+  else
+    ret = g_strdup (location);
+  g_free (path);
+
+  return ret;
+}
+
+/*
+ * set_internal_location:
+ *
+ * filesrc only understands paths, convert local uris for the mmap source.
+ */
+
+static void
+set_internal_location (GnlFileSource * fs)
+{
+  const gchar *location = get_location (fs);
+  gchar *path;
+
+  /* decoded buffers can be shared by the sources of the same file */
+  path = get_cache_key (location);
+  g_object_set (fs, "cache-key", path, NULL);
+  g_free (path);
+
+  if (!fs->private->filesource || !location)
+    return;
+
+  path = fs->private->use_mmap ? gnl_get_local_path (location) : NULL;
+
+  if (fs->private->mmapped != (path != NULL)) {
+    replace_source (fs, location);
+    if (!fs->private->filesource)
+      goto beach;
+  }
+
+  if (fs->private->mmapped)
+    g_object_set (fs->private->filesource, "location", path, NULL);
+  else
+    g_object_set (fs->private->filesource, "location", location, NULL);
+
+beach:
+  g_free (path);
+}
+
+static void
+gnl_filesource_init (GnlFileSource * filesource,
+    GnlFileSourceClass * klass G_GNUC_UNUSED)
+{
+  GST_OBJECT_FLAG_SET (filesource, GNL_OBJECT_SOURCE);
+  filesource->private = g_new0 (GnlFileSourcePrivate, 1);
+  filesource->private->file_duration = GST_CLOCK_TIME_NONE;
+  filesource->private->audio_cache_caps =
+      gst_caps_new_simple ("audio/x-raw-int",
+      "rate", G_TYPE_INT, 48000,
+      "channels", G_TYPE_INT, 2,
+      "endianness", G_TYPE_INT, G_BYTE_ORDER,
+      "width", G_TYPE_INT, 16,
+      "depth", G_TYPE_INT, 16, "signed", G_TYPE_BOOLEAN, TRUE, NULL);
+
+  GST_DEBUG_OBJECT (filesource, "done");
+}
+
+/*
+ * gnl_filesource_create_elements:
+ *
+ * Creates the source and decodebin elements. This is only done when going
+ * to READY, so that objects which are never played (or are copies of other
+ * objects) don't cost anything.
+ */
+
+static gboolean
+gnl_filesource_create_elements (GnlFileSource * filesource)
+{
+  GstElement *filesrc, *decodebin;
+
+  /* We create a bin with source and decodebin within */
+
+  filesrc = make_source (filesource, get_location (filesource));
   if (g_getenv ("USE_DECODEBIN2"))
     decodebin = gst_element_factory_make ("decodebin2", "internal-decodebin");
   else
@@ -141,20 +477,30 @@ gnl_filesource_init (GnlFileSource * filesource,
     g_warning
         ("Could not create a decodebin element, are you sure you have decodebin installed ?");
 
+  if (!filesrc || !decodebin) {
+    if (filesrc)
+      gst_object_unref (filesrc);
+    if (decodebin)
+      gst_object_unref (decodebin);
+    return FALSE;
+  }
+
   filesource->private->filesource = filesrc;
+  filesource->private->decodebin = decodebin;
 
-  if (filesrc && decodebin) {
-    gst_bin_add_many (GST_BIN (filesource), filesrc, decodebin, NULL);
-    if (!(gst_element_link (filesrc, decodebin)))
-      g_warning ("Could not link the file source element to decodebin");
-  }
+  gst_bin_add_many (GST_BIN (filesource), filesrc, decodebin, NULL);
+  if (!(gst_element_link (filesrc, decodebin)))
+    g_warning ("Could not link the file source element to decodebin");
 
-  if (decodebin) {
-    GNL_SOURCE_GET_CLASS (filesource)->control_element (
-        (GnlSource *) filesource, decodebin);
-  }
+  set_internal_location (filesource);
+  gnl_filesource_apply_passthrough_caps (filesource);
 
-  GST_DEBUG_OBJECT (filesource, "done");
+  GNL_SOURCE_GET_CLASS (filesource)->control_element (
+      (GnlSource *) filesource, decodebin);
+
+  GST_DEBUG_OBJECT (filesource, "created elements");
+
+  return TRUE;
 }
 
 static void
@@ -178,11 +524,182 @@ gnl_filesource_finalize (GObject * object)
   GnlFileSource *filesource = (GnlFileSource *) object;
 
   GST_INFO_OBJECT (object, "finalize");
+  if (filesource->private->passthrough_caps)
+    gst_caps_unref (filesource->private->passthrough_caps);
+  g_free (filesource->private->location);
+  g_free (filesource->private->proxy_location);
+  g_free (filesource->private->audio_cache_dir);
+  if (filesource->private->audio_cache_caps)
+    gst_caps_unref (filesource->private->audio_cache_caps);
   g_free (filesource->private);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gnl_filesource_set_passthrough_caps (GnlFileSource * fs, const GstCaps * caps)
+{
+  if (fs->private->passthrough_caps)
+    gst_caps_unref (fs->private->passthrough_caps);
+  fs->private->passthrough_caps = caps ? gst_caps_copy (caps) : NULL;
+
+  gnl_filesource_apply_passthrough_caps (fs);
+}
+
+/*
+ * gnl_filesource_make_cache_src:
+ *
+ * Returns a GnlBufferSrc outputting the decoded audio of the file if it is
+ * in the audio cache, else starts filling the cache and returns NULL.
+ */
+
+static GstElement *
+gnl_filesource_make_cache_src (GnlSource * source)
+{
+  GnlFileSource *fs = (GnlFileSource *) source;
+  GnlObject *object = (GnlObject *) source;
+  GnlFileSourcePrivate *priv = fs->private;
+  GstElement *buffersrc = NULL;
+  GstCaps *caps;
+  GstClockTime start;
+  gboolean audio;
+  gchar *path;
+
+  if (!priv->audio_cache_dir || !get_location (fs)
+      || !priv->audio_cache_caps || !gst_caps_is_fixed (priv->audio_cache_caps))
+    return NULL;
+
+  /* the file might contain other streams than the audio one */
+  if (gst_caps_is_any (object->caps))
+    return NULL;
+  caps = gst_caps_intersect (object->caps, priv->audio_cache_caps);
+  audio = !gst_caps_is_empty (caps);
+  gst_caps_unref (caps);
+  if (!audio)
+    return NULL;
+
+  path = gnl_audio_cache_lookup (priv->audio_cache_dir, get_location (fs),
+      priv->audio_cache_caps, &start);
+  if (!path) {
+    GST_DEBUG_OBJECT (fs, "Audio isn't cached yet");
+    return NULL;
+  }
+
+  GST_DEBUG_OBJECT (fs, "Using decoded audio from %s", path);
+
+  buffersrc = (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  if (!gnl_buffer_src_set_raw_file ((GnlBufferSrc *) buffersrc, path,
+          priv->audio_cache_caps, start)) {
+    gst_object_unref (buffersrc);
+    buffersrc = NULL;
+  }
+  g_free (path);
+
+  return buffersrc;
+}
+
+static GstStateChangeReturn
+gnl_filesource_change_state (GstElement * element, GstStateChange transition)
+{
+  GnlFileSource *fs = (GnlFileSource *) element;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (!fs->private->decodebin && !gnl_filesource_create_elements (fs))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      /* switch to/from the proxy media if needed */
+      set_internal_location (fs);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+    {
+      GstFormat format = GST_FORMAT_TIME;
+      gint64 duration;
+
+      /* Remember the file duration for gnl_filesource_prefetch() */
+      if (gst_element_query_duration (fs->private->decodebin, &format,
+              &duration) && (format == GST_FORMAT_TIME))
+        fs->private->file_duration = duration;
+      break;
+    }
+    default:
+      break;
+  }
+
+  return source_class->change_state (element, transition);
+}
+
+/**
+ * gnl_filesource_prefetch:
+ * @fs: a #GnlFileSource
+ *
+ * Tells the kernel the file will soon be read, so that it can start loading
+ * it in the page cache. If the duration of the file is known from a previous
+ * activation, only the head of the file and the region corresponding to the
+ * media-start/media-stop values (assuming a constant bitrate) are hinted.
+ *
+ * Only works with local files.
+ *
+ * Returns: TRUE if the hint could be given.
+ */
+
+gboolean
+gnl_filesource_prefetch (GnlFileSource * fs)
+{
+#ifdef HAVE_POSIX_FADVISE
+  GnlObject *object = (GnlObject *) fs;
+  gchar *path;
+  struct stat st;
+  off_t start, stop;
+  int fd;
+  gboolean ret = FALSE;
+
+  if (!(path = gnl_get_local_path (get_location (fs)))) {
+    GST_DEBUG_OBJECT (fs, "Not a local file, can't prefetch");
+    return FALSE;
+  }
+
+  if ((fd = open (path, O_RDONLY)) < 0)
+    goto beach;
+
+  if (fstat (fd, &st) < 0)
+    goto close;
+
+  start = 0;
+  stop = st.st_size;
+  if (GST_CLOCK_TIME_IS_VALID (fs->private->file_duration)
+      && fs->private->file_duration > 0) {
+    /* head of the file */
+    posix_fadvise (fd, 0, MIN (PREFETCH_HEAD_SIZE, st.st_size),
+        POSIX_FADV_WILLNEED);
+
+    start = gst_util_uint64_scale (st.st_size, object->media_start,
+        fs->private->file_duration);
+    stop = gst_util_uint64_scale (st.st_size, object->media_stop,
+        fs->private->file_duration);
+    /* leave some margin for variable bitrates */
+    start = MAX (start - st.st_size / 20, 0);
+    stop = MIN (stop + st.st_size / 20, st.st_size);
+  }
+
+  GST_DEBUG_OBJECT (fs, "prefetching bytes %" G_GINT64_FORMAT "-%"
+      G_GINT64_FORMAT " of %s", (gint64) start, (gint64) stop, path);
+
+  if (stop > start)
+    ret = (posix_fadvise (fd, start, stop - start, POSIX_FADV_WILLNEED) == 0);
+
+close:
+  close (fd);
+
+beach:
+  g_free (path);
+  return ret;
+#else
+  return FALSE;
+#endif
+}
+
 static void
 gnl_filesource_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -191,9 +708,35 @@ gnl_filesource_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case ARG_LOCATION:
+      g_free (fs->private->location);
+      fs->private->location = g_value_dup_string (value);
       /* proxy to gnomevfssrc */
-      g_object_set_property (G_OBJECT (fs->private->filesource), "location",
-          value);
+      set_internal_location (fs);
+      break;
+    case ARG_PASSTHROUGH_CAPS:
+      gnl_filesource_set_passthrough_caps (fs, gst_value_get_caps (value));
+      break;
+    case ARG_USE_MMAP:
+      fs->private->use_mmap = g_value_get_boolean (value);
+      break;
+    case ARG_PROXY_LOCATION:
+      g_free (fs->private->proxy_location);
+      fs->private->proxy_location = g_value_dup_string (value);
+      break;
+    case ARG_USE_PROXY:
+      fs->private->use_proxy = g_value_get_boolean (value);
+      break;
+    case ARG_AUDIO_CACHE_DIR:
+      g_free (fs->private->audio_cache_dir);
+      fs->private->audio_cache_dir = g_value_dup_string (value);
+      break;
+    case ARG_AUDIO_CACHE_CAPS:{
+      const GstCaps *caps = gst_value_get_caps (value);
+
+      if (fs->private->audio_cache_caps)
+        gst_caps_unref (fs->private->audio_cache_caps);
+      fs->private->audio_cache_caps = caps ? gst_caps_copy (caps) : NULL;
+    }
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -209,9 +752,25 @@ gnl_filesource_get_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case ARG_LOCATION:
-      /* proxy from gnomevfssrc */
-      g_object_get_property (G_OBJECT (fs->private->filesource), "location",
-          value);
+      g_value_set_string (value, fs->private->location);
+      break;
+    case ARG_PASSTHROUGH_CAPS:
+      gst_value_set_caps (value, fs->private->passthrough_caps);
+      break;
+    case ARG_USE_MMAP:
+      g_value_set_boolean (value, fs->private->use_mmap);
+      break;
+    case ARG_PROXY_LOCATION:
+      g_value_set_string (value, fs->private->proxy_location);
+      break;
+    case ARG_USE_PROXY:
+      g_value_set_boolean (value, fs->private->use_proxy);
+      break;
+    case ARG_AUDIO_CACHE_DIR:
+      g_value_set_string (value, fs->private->audio_cache_dir);
+      break;
+    case ARG_AUDIO_CACHE_CAPS:
+      gst_value_set_caps (value, fs->private->audio_cache_caps);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
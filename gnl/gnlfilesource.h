@@ -54,7 +54,16 @@ struct _GnlFileSourceClass
   GnlSourceClass parent_class;
 };
 
+/* The caps decodebin2 stops autoplugging at by default, ie decoded media */
+#define GNL_DEFAULT_RAW_CAPS \
+  "video/x-raw-yuv; video/x-raw-rgb; video/x-raw-gray; " \
+  "audio/x-raw-int; audio/x-raw-float; " \
+  "text/plain; text/x-pango-markup; " \
+  "video/x-dvd-subpicture; subpicture/x-pgs"
+
 GType gnl_filesource_get_type (void);
 
+gboolean gnl_filesource_prefetch (GnlFileSource * fs);
+
 G_END_DECLS
 #endif /* __GNL_FILESOURCE_H__ */
@@ -0,0 +1,291 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gnl.h"
+
+/**
+ * SECTION:element-gnlmemorysource
+ * @short_description: GNonLin In-Memory Source
+ *
+ * GnlMemorySource is a #GnlSource outputting media generated by the
+ * application (overlays, synthetic audio...), without needing an appsrc.
+ *
+ * The media is either given as an array of timestamped buffers with the
+ * #GnlMemorySource:buffers property, seeks then looking the buffers up by
+ * binary search, or produced on demand by the #GnlMemorySource::pull
+ * signal. In both cases the buffers are pushed as they are, their data is
+ * never copied.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (gnlmemorysource);
+#define GST_CAT_DEFAULT gnlmemorysource
+
+GST_BOILERPLATE (GnlMemorySource, gnl_memory_source, GnlSource,
+    GNL_TYPE_SOURCE);
+
+static GstElementDetails gnl_memory_source_details = GST_ELEMENT_DETAILS
+    ("GNonLin Memory Source",
+    "Filter/Editor",
+    "Outputs buffers generated by the application",
+    "Gnonlin developers <gstreamer-devel@lists.sourceforge.net>");
+
+enum
+{
+  ARG_0,
+  ARG_BUFFERS,
+};
+
+enum
+{
+  PULL_SIGNAL,
+  LAST_SIGNAL
+};
+
+static guint _signals[LAST_SIGNAL] = { 0 };
+
+struct _GnlMemorySourcePrivate
+{
+  GstElement *buffersrc;
+
+  /* copy of the buffers property */
+  GValueArray *buffers;
+};
+
+static void gnl_memory_source_finalize (GObject * object);
+
+static void gnl_memory_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gnl_memory_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GstBuffer *pull_func (GstClockTime position, GnlMemorySource * source);
+
+/* GstBuffer* (*) (gpointer, guint64, gpointer) marshaller. glib-genmarshal
+ * only knows boxed types, and a GstBuffer is a GstMiniObject */
+static void
+marshal_BUFFER__UINT64 (GClosure * closure, GValue * return_value,
+    guint n_param_values, const GValue * param_values,
+    gpointer invocation_hint G_GNUC_UNUSED, gpointer marshal_data)
+{
+  typedef GstBuffer *(*GMarshalFunc_BUFFER__UINT64) (gpointer data1,
+      guint64 arg_1, gpointer data2);
+  GMarshalFunc_BUFFER__UINT64 callback;
+  GCClosure *cc = (GCClosure *) closure;
+  gpointer data1, data2;
+  GstBuffer *v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 2);
+
+  if (G_CCLOSURE_SWAP_DATA (closure)) {
+    data1 = closure->data;
+    data2 = g_value_peek_pointer (param_values + 0);
+  } else {
+    data1 = g_value_peek_pointer (param_values + 0);
+    data2 = closure->data;
+  }
+  callback = (GMarshalFunc_BUFFER__UINT64) (marshal_data ? marshal_data :
+      cc->callback);
+
+  v_return = callback (data1, g_value_get_uint64 (param_values + 1), data2);
+
+  gst_value_take_buffer (return_value, v_return);
+}
+
+static void
+gnl_memory_source_base_init (gpointer g_class)
+{
+  GstElementClass *gstclass = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_set_details (gstclass, &gnl_memory_source_details);
+}
+
+static void
+gnl_memory_source_class_init (GnlMemorySourceClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gnlmemorysource, "gnlmemorysource",
+      GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin Memory Source Element");
+
+  gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_memory_source_finalize);
+  gobject_class->set_property =
+      GST_DEBUG_FUNCPTR (gnl_memory_source_set_property);
+  gobject_class->get_property =
+      GST_DEBUG_FUNCPTR (gnl_memory_source_get_property);
+
+  /**
+   * GnlMemorySource:buffers:
+   *
+   * The #GstBuffer to output, with caps and valid timestamps and durations,
+   * sorted by timestamp. Their timestamps are media times, ie the buffers
+   * between media-start and media-stop are used.
+   *
+   * A reference is taken on each buffer, which is pushed as it is: elements
+   * wanting to modify them will have to copy them.
+   *
+   * Must be set before the object goes to PAUSED.
+   */
+  g_object_class_install_property (gobject_class, ARG_BUFFERS,
+      g_param_spec_value_array ("buffers", "Buffers",
+          "Timestamped buffers to output",
+          gst_param_spec_mini_object ("buffer", "Buffer", "A buffer",
+              GST_TYPE_BUFFER, G_PARAM_READWRITE), G_PARAM_READWRITE));
+
+  /**
+   * GnlMemorySource::pull:
+   * @source: a #GnlMemorySource
+   * @position: media time of the wanted buffer
+   *
+   * Emitted from the streaming thread when no #GnlMemorySource:buffers were
+   * set, with the media time following the previous buffer (or the one
+   * seeked to). In reverse playback, it is the media time just before the
+   * previous buffer (or the seek stop).
+   *
+   * Returns: The #GstBuffer to output (its reference is taken), with caps
+   * and a valid timestamp and duration, ending after @position (starting at
+   * or before it in reverse playback), or NULL at the end of the stream.
+   */
+  _signals[PULL_SIGNAL] =
+      g_signal_new ("pull", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0,
+      NULL, NULL, marshal_BUFFER__UINT64, GST_TYPE_BUFFER, 1, G_TYPE_UINT64);
+}
+
+static void
+gnl_memory_source_init (GnlMemorySource * source,
+    GnlMemorySourceClass * klass G_GNUC_UNUSED)
+{
+  source->priv = g_new0 (GnlMemorySourcePrivate, 1);
+
+  source->priv->buffersrc =
+      (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  gst_bin_add (GST_BIN (source), source->priv->buffersrc);
+
+  /* only used when no buffers are set */
+  gnl_buffer_src_set_pull_func ((GnlBufferSrc *) source->priv->buffersrc,
+      (GnlBufferSrcPullFunc) pull_func, source);
+}
+
+static void
+gnl_memory_source_finalize (GObject * object)
+{
+  GnlMemorySource *source = (GnlMemorySource *) object;
+
+  if (source->priv->buffers)
+    g_value_array_free (source->priv->buffers);
+  g_free (source->priv);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+set_buffers (GnlMemorySource * source, GPtrArray * buffers)
+{
+  GPtrArray *copy = NULL;
+  guint i;
+
+  if (buffers) {
+    copy = g_ptr_array_sized_new (buffers->len);
+    for (i = 0; i < buffers->len; i++)
+      g_ptr_array_add (copy, gst_buffer_ref (g_ptr_array_index (buffers, i)));
+
+    GST_DEBUG_OBJECT (source, "%u buffers", copy->len);
+  }
+
+  gnl_buffer_src_set_buffers ((GnlBufferSrc *) source->priv->buffersrc, copy);
+}
+
+static void
+gnl_memory_source_set_buffers_array (GnlMemorySource * source,
+    GValueArray * array)
+{
+  GPtrArray *buffers = NULL;
+  GstMiniObject *buffer;
+  guint i;
+
+  if (source->priv->buffers)
+    g_value_array_free (source->priv->buffers);
+  source->priv->buffers = NULL;
+
+  if (array) {
+    source->priv->buffers = g_value_array_copy (array);
+
+    /* the GValueArray holds references, only point to its buffers */
+    buffers = g_ptr_array_sized_new (array->n_values);
+    for (i = 0; i < array->n_values; i++) {
+      buffer = gst_value_get_mini_object (g_value_array_get_nth (array, i));
+      if (!GST_IS_BUFFER (buffer)) {
+        GST_WARNING_OBJECT (source, "Value %u isn't a buffer", i);
+        continue;
+      }
+      g_ptr_array_add (buffers, buffer);
+    }
+  }
+
+  set_buffers (source, buffers);
+  if (buffers)
+    g_ptr_array_free (buffers, TRUE);
+}
+
+static void
+gnl_memory_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GnlMemorySource *source = (GnlMemorySource *) object;
+
+  switch (prop_id) {
+    case ARG_BUFFERS:
+      gnl_memory_source_set_buffers_array (source, g_value_get_boxed (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gnl_memory_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GnlMemorySource *source = (GnlMemorySource *) object;
+
+  switch (prop_id) {
+    case ARG_BUFFERS:
+      g_value_set_boxed (value, source->priv->buffers);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstBuffer *
+pull_func (GstClockTime position, GnlMemorySource * source)
+{
+  GstBuffer *buffer = NULL;
+
+  g_signal_emit (source, _signals[PULL_SIGNAL], 0, (guint64) position,
+      &buffer);
+
+  return buffer;
+}
@@ -67,6 +67,8 @@ enum
   ARG_PRIORITY,
   ARG_ACTIVE,
   ARG_CAPS,
+  ARG_OPAQUE,
+  ARG_OPTIONAL,
 };
 
 static void gnl_object_dispose (GObject * object);
@@ -91,6 +93,9 @@ static GstStateChangeReturn gnl_object_prepare (GnlObject * object);
 
 static void gnl_object_handle_message (GstBin * bin, GstMessage * message);
 
+static void compute_transform (GnlObject * object,
+    GnlTimeTransform * transform);
+
 static void
 gnl_object_base_init (gpointer g_class G_GNUC_UNUSED)
 {
@@ -171,6 +176,32 @@ gnl_object_class_init (GnlObjectClass * klass)
       g_param_spec_boxed ("caps", "Caps",
           "Caps used to filter/choose the output stream",
           GST_TYPE_CAPS, G_PARAM_READWRITE));
+
+  /**
+   * GnlObject:opaque:
+   *
+   * Hint that the output of this object entirely covers the output of all
+   * lower-priority objects playing at the same time (ex: a full-frame video
+   * without alpha). The parent #GnlComposition will not build, preroll nor
+   * decode the objects hidden below an opaque #GnlSource.
+   */
+  g_object_class_install_property (gobject_class, ARG_OPAQUE,
+      g_param_spec_boolean ("opaque", "Opaque",
+          "Hides all lower-priority objects in the parent composition", FALSE,
+          G_PARAM_READWRITE));
+
+  /**
+   * GnlObject:optional:
+   *
+   * Marks objects (ex: effects, overlay layers) the output can do without.
+   * When the #GnlComposition:degrade property of the parent
+   * #GnlComposition is set and playback is persistently late, optional
+   * objects are left out of the stacks until it catches up again.
+   */
+  g_object_class_install_property (gobject_class, ARG_OPTIONAL,
+      g_param_spec_boolean ("optional", "Optional",
+          "Can be left out by the parent composition when playback is late",
+          FALSE, G_PARAM_READWRITE));
 }
 
 static void
@@ -185,14 +216,19 @@ gnl_object_init (GnlObject * object, GnlObjectClass * klass)
   object->media_stop = GST_CLOCK_TIME_NONE;
 
   object->rate = 1.0;
+  object->rate_num = object->rate_denom = 1;
   object->priority = 0;
   object->active = TRUE;
+  object->opaque = FALSE;
+  object->optional = FALSE;
 
   object->caps = gst_caps_new_any ();
 
   object->segment_rate = 1.0;
   object->segment_start = -1;
   object->segment_stop = -1;
+
+  gnl_object_update_transform (object);
 }
 
 static void
@@ -208,6 +244,38 @@ gnl_object_dispose (GObject * object)
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+/*
+ * Conversions are done with integer maths (media_duration / duration as a
+ * fraction), so that they are exact and don't drift on long clips.
+ */
+
+/* media time of @otime, which must not be before transform->start */
+static inline GstClockTime
+transform_map (const GnlTimeTransform * transform, GstClockTime otime)
+{
+  if (transform->identity)
+    return otime;
+  if (transform->rate_num == transform->rate_denom)
+    return otime - transform->start + transform->media_start;
+  return gst_util_uint64_scale (otime - transform->start, transform->rate_num,
+      transform->rate_denom) + transform->media_start;
+}
+
+/* object time at which @transform reaches @mtime, or transform->start if
+ * it's before that */
+static inline GstClockTime
+transform_reverse (const GnlTimeTransform * transform, GstClockTime mtime)
+{
+  if (mtime <= transform->media_start)
+    return transform->start;
+  if (transform->identity)
+    return mtime;
+  if (transform->rate_num == transform->rate_denom)
+    return mtime - transform->media_start + transform->start;
+  return gst_util_uint64_scale (mtime - transform->media_start,
+      transform->rate_denom, transform->rate_num) + transform->start;
+}
+
 /**
  * gnl_object_to_media_time:
  * @object: a #GnlObject
@@ -253,12 +321,9 @@ gnl_object_to_media_time (GnlObject * object, GstClockTime otime,
     return FALSE;
   }
 
-  if (object->media_start == GST_CLOCK_TIME_NONE) {
-    /* no time shifting, for live sources ? */
-    *mtime = otime;
-  } else {
-    *mtime = (otime - object->start) * object->rate + object->media_start;
-  }
+  /* Every change of start/stop updates the transform */
+  if (!gnl_time_transform_apply (&object->transform, otime, mtime))
+    g_return_val_if_reached (FALSE);
 
   GST_DEBUG_OBJECT (object, "Returning MediaTime : %" GST_TIME_FORMAT,
       GST_TIME_ARGS (*mtime));
@@ -310,13 +375,36 @@ gnl_media_to_object_time (GnlObject * object, GstClockTime mtime,
         "media time is at or after media_stop, forcing to stop");
     *otime = object->stop;
   } else
-    *otime = (mtime - object->media_start) / object->rate + object->start;
+    *otime = transform_reverse (&object->transform, mtime);
 
   GST_DEBUG_OBJECT (object, "Returning ObjectTime : %" GST_TIME_FORMAT,
       GST_TIME_ARGS (*otime));
   return TRUE;
 }
 
+/**
+ * gnl_time_transform_apply:
+ * @transform: a #GnlTimeTransform
+ * @otime: The object #GstClockTime to convert
+ * @mtime: A pointer on a #GstClockTime to fill
+ *
+ * Converts @otime to media time with @transform.
+ *
+ * Returns: TRUE if @otime was within the range of @transform, FALSE
+ * otherwise, in which case @mtime isn't modified.
+ */
+gboolean
+gnl_time_transform_apply (const GnlTimeTransform * transform,
+    GstClockTime otime, GstClockTime * mtime)
+{
+  if ((otime < transform->start) || (otime >= transform->stop))
+    return FALSE;
+
+  *mtime = transform_map (transform, otime);
+
+  return TRUE;
+}
+
 static gboolean
 gnl_object_covers_func (GnlObject * object,
     GstClockTime start, GstClockTime stop, GnlCoverType type)
@@ -403,6 +491,86 @@ gnl_object_cleanup (GnlObject * object)
   return ret;
 }
 
+/**
+ * gnl_frames_to_time:
+ * @pad: a #GstPad
+ * @frames: a number of frames
+ * @time: where to store the duration of @frames
+ *
+ * Converts a number of frames to a duration, using the framerate of the caps
+ * negotiated on @pad.
+ *
+ * Returns: TRUE if the caps of @pad have a framerate, else FALSE.
+ */
+
+gboolean
+gnl_frames_to_time (GstPad * pad, guint64 frames, GstClockTime * time)
+{
+  GstCaps *caps;
+  gint num, denom;
+  gboolean ret = FALSE;
+
+  if (!(caps = gst_pad_get_negotiated_caps (pad)))
+    return FALSE;
+
+  if ((gst_caps_get_size (caps) > 0)
+      && gst_structure_get_fraction (gst_caps_get_structure (caps, 0),
+          "framerate", &num, &denom) && (num > 0)) {
+    *time = gst_util_uint64_scale (frames, GST_SECOND * denom, num);
+    ret = TRUE;
+  }
+
+  gst_caps_unref (caps);
+
+  return ret;
+}
+
+/**
+ * gnl_frame_seek_to_time:
+ * @pad: the #GstPad receiving @event
+ * @event: a seek #GstEvent. Ownership is taken.
+ *
+ * Converts seeks in GST_FORMAT_DEFAULT (frames) to GST_FORMAT_TIME, using
+ * the framerate negotiated on @pad.
+ *
+ * Returns: The TIME seek, or @event if it wasn't a frame seek or couldn't be
+ * converted.
+ */
+
+GstEvent *
+gnl_frame_seek_to_time (GstPad * pad, GstEvent * event)
+{
+  GstEvent *event2;
+  GstFormat format;
+  gdouble rate;
+  GstSeekFlags flags;
+  GstSeekType curtype, stoptype;
+  gint64 cur, stop;
+  GstClockTime ncur = GST_CLOCK_TIME_NONE, nstop = GST_CLOCK_TIME_NONE;
+
+  gst_event_parse_seek (event, &rate, &format, &flags,
+      &curtype, &cur, &stoptype, &stop);
+
+  if (format != GST_FORMAT_DEFAULT)
+    return event;
+
+  if (((cur >= 0) && !gnl_frames_to_time (pad, cur, &ncur))
+      || ((stop >= 0) && !gnl_frames_to_time (pad, stop, &nstop))) {
+    GST_WARNING_OBJECT (pad, "No framerate, can't convert frame seek");
+    return event;
+  }
+
+  GST_DEBUG_OBJECT (pad, "frames %" G_GINT64_FORMAT " -- %" G_GINT64_FORMAT
+      " are %" GST_TIME_FORMAT " -- %" GST_TIME_FORMAT, cur, stop,
+      GST_TIME_ARGS (ncur), GST_TIME_ARGS (nstop));
+
+  event2 = gst_event_new_seek (rate, GST_FORMAT_TIME, flags,
+      curtype, (gint64) ncur, stoptype, (gint64) nstop);
+  gst_event_unref (event);
+
+  return event2;
+}
+
 static GstEvent *
 translate_incoming_qos (GnlObject * object, GstEvent * event)
 {
@@ -421,12 +589,15 @@ translate_incoming_qos (GnlObject * object, GstEvent * event)
       ((diff < 0) && (-diff > timestamp))) {
     GST_DEBUG ("Invalid timestamp, discarding event");
     gst_event_unref (event);
+  } else if (timestamp2 == timestamp) {
+    event2 = event;
   } else {
     GST_DEBUG_OBJECT (object,
         "translated qos prop:%f, diff:%" G_GINT64_FORMAT
         ", timestamp:%" GST_TIME_FORMAT, prop, diff,
         GST_TIME_ARGS (timestamp2));
     event2 = gst_event_new_qos (prop, diff, timestamp2);
+    gst_event_unref (event);
   }
   return event2;
 }
@@ -437,7 +608,7 @@ translate_incoming_seek (GnlObject * object, GstEvent * event)
   GstEvent *event2;
   GstFormat format;
   gdouble rate, nrate;
-  GstSeekFlags flags;
+  GstSeekFlags flags, nflags;
   GstSeekType curtype, stoptype;
   GstSeekType ncurtype;
   gint64 cur;
@@ -495,22 +666,28 @@ translate_incoming_seek (GnlObject * object, GstEvent * event)
 
 
   /* add accurate seekflags */
+  nflags = flags;
   if (!(flags & GST_SEEK_FLAG_ACCURATE)) {
     GST_DEBUG_OBJECT (object, "Adding GST_SEEK_FLAG_ACCURATE");
-    flags |= GST_SEEK_FLAG_ACCURATE;
+    nflags |= GST_SEEK_FLAG_ACCURATE;
   } else {
     GST_DEBUG_OBJECT (object,
         "event already has GST_SEEK_FLAG_ACCURATE : %d", flags);
   }
 
-
+  /* Nothing changed (ex: identity mapping), forward the same event */
+  if ((nrate == rate) && (nflags == flags) && (ncurtype == curtype)
+      && (ncur == (guint64) cur) && (stoptype == GST_SEEK_TYPE_SET) && (nstop == stop)) {
+    GST_DEBUG_OBJECT (object, "Seek doesn't need to be modified");
+    return event;
+  }
 
   GST_DEBUG_OBJECT (object,
       "SENDING SEEK rate:%f, format:TIME, flags:%d, curtype:%d, stoptype:SET, %"
-      GST_TIME_FORMAT " -- %" GST_TIME_FORMAT, nrate, flags, ncurtype,
+      GST_TIME_FORMAT " -- %" GST_TIME_FORMAT, nrate, nflags, ncurtype,
       GST_TIME_ARGS (ncur), GST_TIME_ARGS (nstop));
 
-  event2 = gst_event_new_seek (nrate, GST_FORMAT_TIME, flags,
+  event2 = gst_event_new_seek (nrate, GST_FORMAT_TIME, nflags,
       ncurtype, (gint64) ncur, GST_SEEK_TYPE_SET, (gint64) nstop);
 
   gst_event_unref (event);
@@ -525,6 +702,34 @@ invalid_format:
   }
 }
 
+static GstEvent *
+translate_incoming_step (GnlObject * object, GstEvent * event)
+{
+  GstFormat format;
+  guint64 amount, namount;
+  gdouble rate;
+  gboolean flush, intermediate;
+
+  gst_event_parse_step (event, &format, &amount, &rate, &flush,
+      &intermediate);
+
+  /* frame and buffer counts are the same in media time, only durations
+   * need converting */
+  if ((format != GST_FORMAT_TIME) || (object->rate_num == object->rate_denom))
+    return event;
+
+  namount = gst_util_uint64_scale (amount, object->rate_num,
+      object->rate_denom);
+
+  GST_DEBUG_OBJECT (object, "step of %" GST_TIME_FORMAT " is %"
+      GST_TIME_FORMAT " in media time", GST_TIME_ARGS (amount),
+      GST_TIME_ARGS (namount));
+
+  gst_event_unref (event);
+
+  return gst_event_new_step (format, namount, rate, flush, intermediate);
+}
+
 static GstEvent *
 translate_outgoing_seek (GnlObject * object, GstEvent * event)
 {
@@ -564,6 +769,9 @@ translate_outgoing_new_segment (GnlObject * object, GstEvent * event)
   if (nstream > G_MAXINT64)
     GST_WARNING_OBJECT (object, "Return value too big...");
 
+  if (nstream == (guint64) stream)
+    return event;
+
   GST_DEBUG_OBJECT (object,
       "Sending NEWSEGMENT %" GST_TIME_FORMAT " -- %" GST_TIME_FORMAT " // %"
       GST_TIME_FORMAT, GST_TIME_ARGS (start), GST_TIME_ARGS (stop),
@@ -715,7 +923,11 @@ ghostpad_event_function (GstPad * ghostpad, GstEvent * event)
     {
       switch (GST_EVENT_TYPE (event)) {
         case GST_EVENT_SEEK:
-          event = translate_incoming_seek (object, event);
+          event = translate_incoming_seek (object,
+              gnl_frame_seek_to_time (ghostpad, event));
+          break;
+        case GST_EVENT_STEP:
+          event = translate_incoming_step (object, event);
           break;
         case GST_EVENT_QOS:
           event = translate_incoming_qos (object, event);
@@ -990,8 +1202,9 @@ translate_message_segment_start (GnlObject * object, GstMessage * message)
   GST_LOG_OBJECT (object, "format:%d, position:%" GST_TIME_FORMAT,
       format, GST_TIME_ARGS (position));
   gnl_media_to_object_time (object, position, &pos2);
-  if (pos2 > G_MAXINT64) {
-    g_warning ("getting values too big...");
+  if ((pos2 > G_MAXINT64) || (pos2 == (guint64) position)) {
+    if (pos2 > G_MAXINT64)
+      g_warning ("getting values too big...");
     return message;
   }
   message2 = gst_message_new_segment_start (GST_MESSAGE_SRC (message),
@@ -1103,19 +1316,58 @@ update_values (GnlObject * object)
 
   /* check if rate has changed */
   if ((object->media_duration != GST_CLOCK_TIME_NONE)
-      && (object->duration)
-      && (object->media_duration)
-      && (((gdouble) object->media_duration / (gdouble) object->duration) !=
-          object->rate)) {
-    object->rate =
-        (gdouble) object->media_duration / (gdouble) object->duration;
-    GST_LOG_OBJECT (object,
-        "Updated rate : %f [mduration:%" GST_TIME_FORMAT ", duration:%"
-        GST_TIME_FORMAT "]", object->rate,
-        GST_TIME_ARGS (object->media_duration),
-        GST_TIME_ARGS (object->duration));
-    g_object_notify (G_OBJECT (object), "rate");
+      && (object->duration > 0)
+      && (object->media_duration > 0)) {
+    guint64 gcd = gcd64 (object->media_duration, object->duration);
+    guint64 num = (guint64) object->media_duration / gcd;
+    guint64 denom = (guint64) object->duration / gcd;
+
+    if ((num != object->rate_num) || (denom != object->rate_denom)) {
+      object->rate_num = num;
+      object->rate_denom = denom;
+      object->rate = (gdouble) num / (gdouble) denom;
+      GST_LOG_OBJECT (object,
+          "Updated rate : %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT
+          " [mduration:%" GST_TIME_FORMAT ", duration:%" GST_TIME_FORMAT "]",
+          num, denom, GST_TIME_ARGS (object->media_duration),
+          GST_TIME_ARGS (object->duration));
+      g_object_notify (G_OBJECT (object), "rate");
+    }
   }
+
+  gnl_object_update_transform (object);
+}
+
+static void
+compute_transform (GnlObject * object, GnlTimeTransform * transform)
+{
+  transform->start = object->start;
+  transform->stop = object->stop;
+  if (object->media_start == GST_CLOCK_TIME_NONE) {
+    /* no time shifting */
+    transform->media_start = object->start;
+    transform->rate_num = transform->rate_denom = 1;
+  } else {
+    transform->media_start = object->media_start;
+    transform->rate_num = object->rate_num;
+    transform->rate_denom = object->rate_denom;
+  }
+  transform->identity = (transform->media_start == transform->start)
+      && (transform->rate_num == transform->rate_denom);
+}
+
+/**
+ * gnl_object_update_transform:
+ * @object: a #GnlObject
+ *
+ * Updates the #GnlTimeTransform of @object from its start, stop,
+ * media-start and rate. Must be called by subclasses modifying those values
+ * directly instead of through the properties (ex: #GnlComposition).
+ */
+void
+gnl_object_update_transform (GnlObject * object)
+{
+  compute_transform (object, &object->transform);
 }
 
 static void
@@ -1137,6 +1389,7 @@ gnl_object_set_property (GObject * object, guint prop_id,
       break;
     case ARG_MEDIA_START:
       gnlobject->media_start = g_value_get_uint64 (value);
+      gnl_object_update_transform (gnlobject);
       break;
     case ARG_MEDIA_DURATION:
       gnlobject->media_duration = g_value_get_int64 (value);
@@ -1151,6 +1404,12 @@ gnl_object_set_property (GObject * object, guint prop_id,
     case ARG_CAPS:
       gnl_object_set_caps (gnlobject, gst_value_get_caps (value));
       break;
+    case ARG_OPAQUE:
+      gnlobject->opaque = g_value_get_boolean (value);
+      break;
+    case ARG_OPTIONAL:
+      gnlobject->optional = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1194,6 +1453,12 @@ gnl_object_get_property (GObject * object, guint prop_id,
     case ARG_CAPS:
       gst_value_set_caps (value, gnlobject->caps);
       break;
+    case ARG_OPAQUE:
+      g_value_set_boolean (value, gnlobject->opaque);
+      break;
+    case ARG_OPTIONAL:
+      g_value_set_boolean (value, gnlobject->optional);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
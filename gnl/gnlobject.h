@@ -80,6 +80,31 @@ typedef enum
 #define GNL_OBJECT_IS_OPERATION(obj) \
   (GST_OBJECT_FLAG_IS_SET(obj, GNL_OBJECT_OPERATION))
 
+/**
+ * GnlTimeTransform:
+ * @start: first object time of the mapping
+ * @stop: object time at which the mapping ends (excluded)
+ * @media_start: media time corresponding to @start
+ * @rate_num: numerator of the rate (media time elapsed per unit of object
+ * time)
+ * @rate_denom: denominator of the rate
+ * @identity: TRUE if object and media times are the same
+ *
+ * Affine mapping from object (container) time to media time:
+ * media = (object - start) * rate_num / rate_denom + media_start, for
+ * start <= object < stop.
+ */
+
+struct _GnlTimeTransform
+{
+  GstClockTime start;
+  GstClockTime stop;
+  GstClockTime media_start;
+  guint64 rate_num;
+  guint64 rate_denom;
+  gboolean identity;
+};
+
 struct _GnlObject
 {
   GstBin parent;
@@ -100,15 +125,29 @@ struct _GnlObject
   /* read-only */
   gdouble rate;
 
+  /* read-only, media_duration / duration as an irreducible fraction, used
+   * for time conversions */
+  guint64 rate_num;
+  guint64 rate_denom;
+
   /* priority in parent */
   guint32 priority;
 
   /* active in parent */
   gboolean active;
 
+  /* hides all lower-priority objects in parent */
+  gboolean opaque;
+
+  /* can be left out by the parent when playback is late */
+  gboolean optional;
+
   /* Filtering caps */
   GstCaps *caps;
 
+  /* object to media time mapping, updated along with the values above */
+  GnlTimeTransform transform;
+
   /* current segment seek <RO> */
   gdouble segment_rate;
   GstSeekFlags segment_flags;
@@ -155,5 +194,14 @@ gboolean
 gnl_media_to_object_time (GnlObject * object, GstClockTime mtime,
 			  GstClockTime * otime);
 
+gboolean gnl_frames_to_time (GstPad * pad, guint64 frames, GstClockTime * time);
+
+GstEvent *gnl_frame_seek_to_time (GstPad * pad, GstEvent * event);
+
+gboolean gnl_time_transform_apply (const GnlTimeTransform * transform,
+    GstClockTime otime, GstClockTime * mtime);
+
+void gnl_object_update_transform (GnlObject * object);
+
 G_END_DECLS
 #endif /* __GNL_OBJECT_H__ */
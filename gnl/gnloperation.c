@@ -86,6 +86,18 @@ static void gnl_operation_release_pad (GstElement * element, GstPad * pad);
 
 static void synchronize_sinks (GnlOperation * operation);
 
+static gboolean ghostpad_query_function (GstPad * ghostpad, GstQuery * query);
+static void control_sink_latency (GstPad * ghostpad);
+
+/* Highest minimum latency of the inputs the controlled element queried while
+ * answering a latency query, see aggregate_latency(). Queries are answered
+ * synchronously, so it lives on the stack of the querying thread */
+static GStaticPrivate seen_latency = G_STATIC_PRIVATE_INIT;
+
+/* Stores the original query function of the internal pads of the sink
+ * ghostpads */
+static GQuark internal_query_quark = 0;
+
 static void
 gnl_operation_base_init (gpointer g_class)
 {
@@ -106,6 +118,8 @@ gnl_operation_class_init (GnlOperationClass * klass)
   GST_DEBUG_CATEGORY_INIT (gnloperation, "gnloperation",
       GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin Operation element");
 
+  internal_query_quark = g_quark_from_static_string ("gnl-internal-query");
+
   gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_operation_finalize);
 
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gnl_operation_set_property);
@@ -323,6 +337,8 @@ gnl_operation_add_element (GstBin * bin, GstElement * element)
         if (!operation->ghostpad) {
           operation->ghostpad =
               gst_ghost_pad_new_no_target ("src", GST_PAD_SRC);
+          gst_pad_set_query_function (operation->ghostpad,
+              GST_DEBUG_FUNCPTR (ghostpad_query_function));
           gst_pad_set_active (operation->ghostpad, TRUE);
           gst_element_add_pad ((GstElement *) bin, operation->ghostpad);
         }
@@ -594,6 +610,7 @@ add_sink_pad (GnlOperation * operation)
   if (gpad) {
     gst_pad_set_active (gpad, TRUE);
     gst_element_add_pad ((GstElement *) operation, gpad);
+    control_sink_latency (gpad);
     operation->sinks = g_list_append (operation->sinks, gpad);
     operation->realsinks++;
     GST_DEBUG ("Created new pad %s:%s ghosting %s:%s",
@@ -661,6 +678,128 @@ synchronize_sinks (GnlOperation * operation)
   }
 }
 
+/* Records the latency of the inputs the controlled element queries */
+static gboolean
+internalpad_query_function (GstPad * internal, GstQuery * query)
+{
+  GstPadQueryFunction func;
+  GstClockTime *seen;
+  gboolean res, live;
+  GstClockTime min, max;
+
+  func = (GstPadQueryFunction) g_object_get_qdata ((GObject *) internal,
+      internal_query_quark);
+  res = func (internal, query);
+
+  if (res && (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY)
+      && (seen = g_static_private_get (&seen_latency))) {
+    gst_query_parse_latency (query, &live, &min, &max);
+    if (GST_CLOCK_TIME_IS_VALID (min) && (!GST_CLOCK_TIME_IS_VALID (*seen)
+            || (min > *seen)))
+      *seen = min;
+  }
+
+  return res;
+}
+
+static void
+control_sink_latency (GstPad * ghostpad)
+{
+  GstIterator *it;
+  gpointer internal = NULL;
+
+  it = gst_pad_iterate_internal_links (ghostpad);
+  if (!it || gst_iterator_next (it, &internal) != GST_ITERATOR_OK) {
+    GST_WARNING_OBJECT (ghostpad, "Couldn't get the internal pad");
+    goto beach;
+  }
+
+  g_object_set_qdata ((GObject *) internal, internal_query_quark,
+      (gpointer) GST_PAD_QUERYFUNC (internal));
+  gst_pad_set_query_function ((GstPad *) internal,
+      GST_DEBUG_FUNCPTR (internalpad_query_function));
+  gst_object_unref (internal);
+
+beach:
+  if (it)
+    gst_iterator_free (it);
+}
+
+/* Most elements only forward latency queries to one of their sink pads,
+ * adding their own latency. That latency is the difference between the
+ * element's answer and the latency of the inputs it queried (@seen), and the
+ * latency of the operation is the one of its slowest input plus it. */
+static void
+aggregate_latency (GnlOperation * operation, GstQuery * query,
+    GstClockTime seen)
+{
+  GstQuery *peerquery;
+  GList *tmp;
+  gboolean live, peerlive;
+  GstClockTime min, max, peermin, peermax, own;
+  GstClockTime inmin = GST_CLOCK_TIME_NONE;
+
+  gst_query_parse_latency (query, &live, &min, &max);
+
+  /* The element didn't query any input, its answer is its own latency */
+  own = GST_CLOCK_TIME_IS_VALID (min) ? min : 0;
+  if (GST_CLOCK_TIME_IS_VALID (seen))
+    own = (own > seen) ? own - seen : 0;
+
+  peerquery = gst_query_new_latency ();
+  for (tmp = operation->sinks; tmp; tmp = tmp->next) {
+    if (!gst_pad_peer_query ((GstPad *) tmp->data, peerquery))
+      continue;
+
+    gst_query_parse_latency (peerquery, &peerlive, &peermin, &peermax);
+    live |= peerlive;
+    if (GST_CLOCK_TIME_IS_VALID (peermin))
+      inmin = GST_CLOCK_TIME_IS_VALID (inmin) ? MAX (inmin, peermin) : peermin;
+    if (GST_CLOCK_TIME_IS_VALID (peermax))
+      max = GST_CLOCK_TIME_IS_VALID (max) ? MIN (max, peermax) : peermax;
+  }
+  gst_query_unref (peerquery);
+
+  if (GST_CLOCK_TIME_IS_VALID (inmin))
+    min = inmin + own;
+
+  GST_DEBUG_OBJECT (operation, "live:%d, own:%" GST_TIME_FORMAT ", min:%"
+      GST_TIME_FORMAT ", max:%" GST_TIME_FORMAT, live, GST_TIME_ARGS (own),
+      GST_TIME_ARGS (min), GST_TIME_ARGS (max));
+
+  gst_query_set_latency (query, live, min, max);
+}
+
+static gboolean
+ghostpad_query_function (GstPad * ghostpad, GstQuery * query)
+{
+  GnlOperation *operation;
+  GstPad *target;
+  GstClockTime seen = GST_CLOCK_TIME_NONE;
+  gpointer prevseen;
+  gboolean res = FALSE;
+
+  if (!(operation = (GnlOperation *) gst_pad_get_parent (ghostpad)))
+    return FALSE;
+
+  if (!(target = gst_ghost_pad_get_target ((GstGhostPad *) ghostpad)))
+    goto beach;
+
+  /* Nested operations answer from within the query of the upper one */
+  prevseen = g_static_private_get (&seen_latency);
+  g_static_private_set (&seen_latency, &seen, NULL);
+  res = gst_pad_query (target, query);
+  g_static_private_set (&seen_latency, prevseen, NULL);
+  gst_object_unref (target);
+
+  if (res && (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY))
+    aggregate_latency (operation, query, seen);
+
+beach:
+  gst_object_unref (operation);
+  return res;
+}
+
 static gboolean
 gnl_operation_prepare (GnlObject * object)
 {
@@ -50,6 +50,12 @@ static GstElementDetails gnl_source_details = GST_ELEMENT_DETAILS
     "Manages source elements",
     "Wim Taymans <wim.taymans@gmail.com>, Edward Hervey <bilboed@bilboed.com>");
 
+enum
+{
+  ARG_0,
+  ARG_CACHE_KEY,
+};
+
 struct _GnlSourcePrivate
 {
   gboolean dispose_has_run;
@@ -63,6 +69,23 @@ struct _GnlSourcePrivate
 
   gboolean pendingblock;        /* We have a pending pad_block */
   GstPad *ghostedpad;           /* Pad (to be) ghosted */
+
+  gchar *cache_key;             /* protected by the object lock */
+
+  /* Decoded buffer cache, only set between READY and PAUSED */
+  GnlCache *cache;
+  gchar *key;                   /* cache_key and caps */
+  GstElement *cachesrc;         /* outputs the cached buffers instead of element */
+
+  /* Recording of the decoded buffers, protected by the object lock */
+  GstPad *recpad;
+  gulong bufferprobe;
+  gulong eventprobe;
+  GPtrArray *recording;
+  GstClockTime rec_start;
+  GstClockTime rec_stop;
+  GstClockTime rec_last;
+  guint64 rec_size;
 };
 
 static gboolean gnl_source_prepare (GnlObject * object);
@@ -74,6 +97,11 @@ static gboolean gnl_source_remove_element (GstBin * bin, GstElement * element);
 static void gnl_source_dispose (GObject * object);
 static void gnl_source_finalize (GObject * object);
 
+static void gnl_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gnl_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
 static gboolean gnl_source_send_event (GstElement * element, GstEvent * event);
 
 static GstStateChangeReturn
@@ -123,10 +151,28 @@ gnl_source_class_init (GnlSourceClass * klass)
 
   gobject_class->dispose = GST_DEBUG_FUNCPTR (gnl_source_dispose);
   gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_source_finalize);
+  gobject_class->set_property = GST_DEBUG_FUNCPTR (gnl_source_set_property);
+  gobject_class->get_property = GST_DEBUG_FUNCPTR (gnl_source_get_property);
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gnl_source_src_template));
 
+  /**
+   * GnlSource:cache-key:
+   *
+   * Identifies the media this source decodes (ex: its location), so that
+   * its decoded buffers can be shared through the
+   * #GnlComposition:cache-budget cache with the other sources using the
+   * same media and caps. Sources outputting something else than the media
+   * (ex: applying effects) must not share a key.
+   *
+   * #GnlFileSource sets it to its location. NULL (the default) disables
+   * caching for this source.
+   */
+  g_object_class_install_property (gobject_class, ARG_CACHE_KEY,
+      g_param_spec_string ("cache-key", "Cache key",
+          "Identifies the decoded media in the composition cache "
+          "(NULL = not cached)", NULL, G_PARAM_READWRITE));
 }
 
 
@@ -167,6 +213,8 @@ gnl_source_dispose (GObject * object)
     gnl_object_remove_ghost_pad ((GnlObject *) object, source->priv->ghostpad);
   source->priv->ghostpad = NULL;
 
+  cleanup_cache (source);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -177,11 +225,49 @@ gnl_source_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (object, "finalize");
 
+  g_free (source->priv->cache_key);
   g_free (source->priv);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gnl_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GnlSource *source = (GnlSource *) object;
+
+  switch (prop_id) {
+    case ARG_CACHE_KEY:
+      GST_OBJECT_LOCK (source);
+      g_free (source->priv->cache_key);
+      source->priv->cache_key = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (source);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gnl_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GnlSource *source = (GnlSource *) object;
+
+  switch (prop_id) {
+    case ARG_CACHE_KEY:
+      GST_OBJECT_LOCK (source);
+      g_value_set_string (value, source->priv->cache_key);
+      GST_OBJECT_UNLOCK (source);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static gboolean
 gnl_source_prepare (GnlObject * object)
 {
@@ -303,6 +389,290 @@ get_valid_src_pad (GnlSource * source, GstElement * element, GstPad ** pad)
   return FALSE;
 }
 
+/*
+ * Decoded buffer cache
+ *
+ * Sources with a cache-key record the buffers their element outputs and add
+ * them to the cache of the outermost composition. Sources whose whole media
+ * range is in the cache output the cached buffers from a GnlBufferSrc
+ * instead, their element being kept in READY.
+ */
+
+static void
+free_buffers (GPtrArray * buffers)
+{
+  guint i;
+
+  for (i = 0; i < buffers->len; i++)
+    gst_buffer_unref (GST_BUFFER (g_ptr_array_index (buffers, i)));
+  g_ptr_array_free (buffers, TRUE);
+}
+
+static GnlCache *
+get_toplevel_cache (GnlSource * source)
+{
+  GstObject *parent, *toplevel = NULL;
+  GnlCache *cache = NULL;
+
+  parent = gst_object_get_parent ((GstObject *) source);
+  while (parent && GNL_IS_COMPOSITION (parent)) {
+    if (toplevel)
+      gst_object_unref (toplevel);
+    toplevel = parent;
+    parent = gst_object_get_parent (toplevel);
+  }
+  if (parent)
+    gst_object_unref (parent);
+
+  if (toplevel) {
+    cache = gnl_composition_get_cache ((GnlComposition *) toplevel);
+    gst_object_unref (toplevel);
+  }
+
+  return cache;
+}
+
+/*
+ * setup_cache:
+ *
+ * Looks the media range of @source up in the cache, and if it is there
+ * makes the cached buffers output instead of the controlled element.
+ *
+ * Subclasses with their own cached media (see make_cache_src()) take
+ * precedence over the cache.
+ */
+
+static void
+setup_cache (GnlSource * source)
+{
+  GnlObject *object = (GnlObject *) source;
+  GnlSourcePrivate *priv = source->priv;
+  GnlSourceClass *klass = GNL_SOURCE_GET_CLASS (source);
+  GPtrArray *buffers;
+  gchar *key, *caps;
+
+  if (klass->make_cache_src
+      && (priv->cachesrc = klass->make_cache_src (source))) {
+    GST_DEBUG_OBJECT (source, "Outputting subclass cached media");
+    goto use_cachesrc;
+  }
+
+  GST_OBJECT_LOCK (source);
+  key = g_strdup (priv->cache_key);
+  GST_OBJECT_UNLOCK (source);
+
+  if (!key)
+    return;
+
+  if (!GST_CLOCK_TIME_IS_VALID (object->media_start)
+      || !GST_CLOCK_TIME_IS_VALID (object->media_stop))
+    goto beach;
+
+  priv->cache = get_toplevel_cache (source);
+  if (!priv->cache)
+    goto beach;
+
+  if (!gnl_cache_get_budget (priv->cache)) {
+    gnl_cache_unref (priv->cache);
+    priv->cache = NULL;
+    goto beach;
+  }
+
+  caps = gst_caps_to_string (object->caps);
+  priv->key = g_strdup_printf ("%s|%s", key, caps);
+  g_free (caps);
+
+  buffers = gnl_cache_lookup (priv->cache, priv->key, object->media_start,
+      object->media_stop);
+  if (!buffers)
+    goto beach;
+
+  GST_DEBUG_OBJECT (source, "Outputting %u cached buffers", buffers->len);
+
+  priv->cachesrc = (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  gnl_buffer_src_set_buffers ((GnlBufferSrc *) priv->cachesrc, buffers);
+  g_free (key);
+
+use_cachesrc:
+  gst_element_set_locked_state (source->element, TRUE);
+  /* bypass our add_element, the cache source isn't controlled */
+  GST_BIN_CLASS (parent_class)->add_element ((GstBin *) source,
+      priv->cachesrc);
+  return;
+
+beach:
+  g_free (key);
+}
+
+/* Must be called with the object lock */
+static void
+commit_recording (GnlSource * source)
+{
+  GnlSourcePrivate *priv = source->priv;
+
+  if (!priv->recording)
+    return;
+
+  /* runs which are empty or too small are dropped by the cache */
+  gnl_cache_add (priv->cache, priv->key, priv->rec_start,
+      MIN (priv->rec_last, priv->rec_stop), priv->recording);
+  priv->recording = NULL;
+}
+
+/* Must be called with the object lock */
+static void
+start_recording (GnlSource * source, GstClockTime start, GstClockTime stop)
+{
+  GnlSourcePrivate *priv = source->priv;
+
+  priv->recording = g_ptr_array_new ();
+  priv->rec_start = start;
+  priv->rec_stop = stop;
+  priv->rec_last = start;
+  priv->rec_size = 0;
+}
+
+static gboolean
+record_event_probe (GstPad * pad G_GNUC_UNUSED, GstEvent * event,
+    GnlSource * source)
+{
+  GST_OBJECT_LOCK (source);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_NEWSEGMENT:{
+      gboolean update;
+      gdouble rate;
+      GstFormat format;
+      gint64 start, stop, position;
+
+      gst_event_parse_new_segment (event, &update, &rate, &format, &start,
+          &stop, &position);
+      if (update)
+        break;
+
+      commit_recording (source);
+      /* buffers are only kept sorted in forward playback */
+      if ((format == GST_FORMAT_TIME) && (rate > 0.0)
+          && GST_CLOCK_TIME_IS_VALID (start))
+        start_recording (source, start, stop);
+    }
+      break;
+    case GST_EVENT_FLUSH_START:
+    case GST_EVENT_EOS:
+      commit_recording (source);
+      break;
+    default:
+      break;
+  }
+
+  GST_OBJECT_UNLOCK (source);
+
+  return TRUE;
+}
+
+static gboolean
+record_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GnlSource * source)
+{
+  GnlSourcePrivate *priv = source->priv;
+  GstClockTime ts, end;
+
+  GST_OBJECT_LOCK (source);
+
+  if (!priv->recording)
+    goto beach;
+
+  ts = GST_BUFFER_TIMESTAMP (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (ts)
+      || !GST_BUFFER_DURATION_IS_VALID (buffer) || !GST_BUFFER_CAPS (buffer))
+    goto drop;
+  end = ts + GST_BUFFER_DURATION (buffer);
+
+  /* buffers decoded before the segment start */
+  if (end <= priv->rec_start)
+    goto beach;
+
+  if (!priv->recording->len) {
+    if (ts > priv->rec_start)
+      priv->rec_start = priv->rec_last = ts;
+  } else if (ts > priv->rec_last) {
+    /* runs don't have holes, start a new one */
+    commit_recording (source);
+    start_recording (source, ts, priv->rec_stop);
+  } else if (ts < GST_BUFFER_TIMESTAMP (g_ptr_array_index (priv->recording,
+              priv->recording->len - 1)))
+    goto drop;
+
+  priv->rec_size += GST_BUFFER_SIZE (buffer);
+  if (priv->rec_size > gnl_cache_get_budget (priv->cache))
+    goto drop;
+
+  g_ptr_array_add (priv->recording, gst_buffer_ref (buffer));
+  priv->rec_last = MAX (priv->rec_last, end);
+
+beach:
+  GST_OBJECT_UNLOCK (source);
+
+  return TRUE;
+
+drop:
+  GST_DEBUG_OBJECT (source, "Can't cache this segment");
+  free_buffers (priv->recording);
+  priv->recording = NULL;
+  goto beach;
+}
+
+static void
+setup_recording (GnlSource * source, GstPad * pad)
+{
+  GnlSourcePrivate *priv = source->priv;
+
+  GST_DEBUG_OBJECT (source, "Recording decoded buffers from %s:%s",
+      GST_DEBUG_PAD_NAME (pad));
+
+  priv->recpad = gst_object_ref (pad);
+  priv->eventprobe = gst_pad_add_event_probe (pad,
+      G_CALLBACK (record_event_probe), source);
+  priv->bufferprobe = gst_pad_add_buffer_probe (pad,
+      G_CALLBACK (record_buffer_probe), source);
+}
+
+static void
+cleanup_cache (GnlSource * source)
+{
+  GnlSourcePrivate *priv = source->priv;
+
+  if (priv->recpad) {
+    gst_pad_remove_event_probe (priv->recpad, priv->eventprobe);
+    gst_pad_remove_buffer_probe (priv->recpad, priv->bufferprobe);
+    gst_object_unref (priv->recpad);
+    priv->recpad = NULL;
+
+    GST_OBJECT_LOCK (source);
+    commit_recording (source);
+    GST_OBJECT_UNLOCK (source);
+  }
+
+  if (priv->cachesrc) {
+    GstElement *cachesrc = gst_object_ref (priv->cachesrc);
+
+    gst_bin_remove ((GstBin *) source, cachesrc);
+    gst_element_set_state (cachesrc, GST_STATE_NULL);
+    gst_object_unref (cachesrc);
+    priv->cachesrc = NULL;
+
+    if (source->element)
+      gst_element_set_locked_state (source->element, FALSE);
+  }
+
+  if (priv->cache) {
+    gnl_cache_unref (priv->cache);
+    priv->cache = NULL;
+  }
+  g_free (priv->key);
+  priv->key = NULL;
+}
+
 static gpointer
 ghost_seek_pad (GnlSource * source)
 {
@@ -315,6 +685,9 @@ ghost_seek_pad (GnlSource * source)
 
   source->priv->ghostpad = gnl_object_ghost_pad_full
       ((GnlObject *) source, GST_PAD_NAME (pad), pad, TRUE);
+
+  if (source->priv->cache && !source->priv->cachesrc && !source->priv->recpad)
+    setup_recording (source, pad);
   GST_DEBUG_OBJECT (source, "emitting no more pads");
   gst_pad_set_active (source->priv->ghostpad, TRUE);
 
@@ -532,9 +905,19 @@ gnl_source_change_state (GstElement * element, GstStateChange transition)
 
         GST_LOG_OBJECT (source, "no ghostpad and not dynamic pads");
 
+        if (!source->priv->cache && !source->priv->cachesrc)
+          setup_cache (source);
+
         /* Do an async block on valid source pad */
 
-        if (!(get_valid_src_pad (source, source->element, &pad))) {
+        if (source->priv->cachesrc) {
+          pad = gst_element_get_static_pad (source->priv->cachesrc, "src");
+          source->priv->ghostedpad = pad;
+          source->priv->pendingblock = TRUE;
+          gst_pad_set_blocked_async (pad, TRUE,
+              (GstPadBlockCallback) pad_blocked_cb, source);
+          gst_object_unref (pad);
+        } else if (!(get_valid_src_pad (source, source->element, &pad))) {
           GST_WARNING_OBJECT (source, "Couldn't find a valid source pad");
         } else {
           GST_LOG_OBJECT (source, "Trying to async block source pad %s:%s",
@@ -574,6 +957,7 @@ gnl_source_change_state (GstElement * element, GstStateChange transition)
         source->priv->ghostpad = NULL;
         source->priv->ghostedpad = NULL;
       }
+      cleanup_cache (source);
     default:
       break;
   }
@@ -60,6 +60,9 @@ struct _GnlSourceClass
   gboolean controls_one;
   /* control_element() takes care of controlling the given element */
     gboolean (*control_element) (GnlSource * source, GstElement * element);
+  /* make_cache_src() returns an element outputting the same media as the
+   * controlled one from a subclass-specific cache, or NULL */
+    GstElement *(*make_cache_src) (GnlSource * source);
 };
 
 GType gnl_source_get_type (void);
@@ -0,0 +1,524 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gnl.h"
+
+/**
+ * SECTION:element-gnlstillsource
+ * @short_description: GNonLin Still Image Source
+ *
+ * GnlStillSource is a #GnlSource which outputs a still image (title, logo,
+ * photo...) at a given framerate.
+ *
+ * The image is only decoded once, from the streaming thread when the first
+ * GnlStillSource using it starts outputting buffers, so that state changes
+ * never wait for the decoder. The decoded frame is shared by all the
+ * GnlStillSources with the same location, and released when none of them
+ * is in PAUSED or PLAYING anymore. The outgoing buffers all share the data
+ * of that frame, no decoder runs while playing.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (gnlstillsource);
+#define GST_CAT_DEFAULT gnlstillsource
+
+GST_BOILERPLATE (GnlStillSource, gnl_still_source, GnlSource, GNL_TYPE_SOURCE);
+
+static GstElementDetails gnl_still_source_details = GST_ELEMENT_DETAILS
+    ("GNonLin Still Source",
+    "Filter/Editor",
+    "Outputs a still image decoded only once",
+    "Gnonlin developers <gstreamer-devel@lists.sourceforge.net>");
+
+enum
+{
+  ARG_0,
+  ARG_LOCATION,
+  ARG_FRAMERATE,
+};
+
+#define DEFAULT_FRAMERATE_N 25
+#define DEFAULT_FRAMERATE_D 1
+
+/* How long to wait for an image to be decoded */
+#define DECODE_TIMEOUT (10 * GST_SECOND)
+
+struct _GnlStillSourcePrivate
+{
+  gchar *location;
+  gint fps_n;
+  gint fps_d;
+
+  /* Only used from the streaming thread, or while it isn't running */
+  /* shared decoded frame, acquired for location */
+  GstBuffer *frame;
+  /* frame with the output caps */
+  GstBuffer *template;
+
+  GstElement *buffersrc;
+};
+
+static void gnl_still_source_finalize (GObject * object);
+
+static void gnl_still_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gnl_still_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GstStateChangeReturn
+gnl_still_source_change_state (GstElement * element,
+    GstStateChange transition);
+
+static GstBuffer *pull_frame (GstClockTime position, GnlStillSource * still);
+
+/*
+ * Decoded frames shared by all the GnlStillSources, by location
+ */
+
+typedef struct _GnlStillFrame
+{
+  GstBuffer *buffer;
+  guint users;
+} GnlStillFrame;
+
+static GStaticMutex frames_lock = G_STATIC_MUTEX_INIT;
+static GHashTable *frames = NULL;
+
+static void
+gnl_still_source_base_init (gpointer g_class)
+{
+  GstElementClass *gstclass = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_set_details (gstclass, &gnl_still_source_details);
+}
+
+static void
+gnl_still_source_class_init (GnlStillSourceClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gnlstillsource, "gnlstillsource",
+      GST_DEBUG_FG_BLUE | GST_DEBUG_BOLD, "GNonLin Still Source Element");
+
+  gobject_class->finalize = GST_DEBUG_FUNCPTR (gnl_still_source_finalize);
+  gobject_class->set_property =
+      GST_DEBUG_FUNCPTR (gnl_still_source_set_property);
+  gobject_class->get_property =
+      GST_DEBUG_FUNCPTR (gnl_still_source_get_property);
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gnl_still_source_change_state);
+
+  /* Like the framerate, it can only be changed in the NULL and READY
+   * states */
+  gst_element_class_install_std_props (GST_ELEMENT_CLASS (klass),
+      "location", ARG_LOCATION, G_PARAM_READWRITE, NULL);
+
+  /**
+   * GnlStillSource:framerate:
+   *
+   * Framerate at which the image is output. It can only be changed in the
+   * NULL and READY states.
+   */
+  g_object_class_install_property (gobject_class, ARG_FRAMERATE,
+      gst_param_spec_fraction ("framerate", "Framerate",
+          "Framerate at which the image is output", 1, 1, G_MAXINT, 1,
+          DEFAULT_FRAMERATE_N, DEFAULT_FRAMERATE_D, G_PARAM_READWRITE));
+}
+
+static void
+gnl_still_source_init (GnlStillSource * still,
+    GnlStillSourceClass * klass G_GNUC_UNUSED)
+{
+  still->priv = g_new0 (GnlStillSourcePrivate, 1);
+  still->priv->fps_n = DEFAULT_FRAMERATE_N;
+  still->priv->fps_d = DEFAULT_FRAMERATE_D;
+
+  /* The GnlBufferSrc never changes, it asks for the frames from its
+   * streaming thread, where the image is decoded */
+  still->priv->buffersrc =
+      (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  gnl_buffer_src_set_pull_func ((GnlBufferSrc *) still->priv->buffersrc,
+      (GnlBufferSrcPullFunc) pull_frame, still);
+  gst_bin_add (GST_BIN (still), still->priv->buffersrc);
+}
+
+static void
+decoded_pad_added_cb (GstElement * decodebin G_GNUC_UNUSED, GstPad * pad,
+    GstElement * sink)
+{
+  GstPad *sinkpad;
+  GstCaps *caps;
+  gboolean video;
+
+  caps = gst_pad_get_caps (pad);
+  video = !gst_caps_is_empty (caps) && g_str_has_prefix
+      (gst_structure_get_name (gst_caps_get_structure (caps, 0)), "video/");
+  gst_caps_unref (caps);
+
+  if (!video)
+    return;
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  if (!gst_pad_is_linked (sinkpad))
+    gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static void
+preroll_handoff_cb (GstElement * sink G_GNUC_UNUSED, GstBuffer * buffer,
+    GstPad * pad G_GNUC_UNUSED, GstBuffer ** frame)
+{
+  if (!*frame)
+    *frame = gst_buffer_ref (buffer);
+}
+
+/*
+ * decode_frame:
+ *
+ * Decodes the first frame of @location by prerolling a temporary pipeline.
+ * Called from the streaming thread, never from a state change.
+ *
+ * Returns: The decoded frame, or NULL if it couldn't be decoded.
+ */
+
+static GstBuffer *
+decode_frame (GnlStillSource * still, const gchar * location)
+{
+  GstElement *pipeline, *src, *decodebin, *sink;
+  GstBuffer *frame = NULL;
+
+  GST_DEBUG_OBJECT (still, "Decoding %s", location);
+
+  if (gst_uri_is_valid (location))
+    src = gst_element_make_from_uri (GST_URI_SRC, location, NULL);
+  else if ((src = gst_element_factory_make ("filesrc", NULL)))
+    g_object_set (src, "location", location, NULL);
+  if (g_getenv ("USE_DECODEBIN2"))
+    decodebin = gst_element_factory_make ("decodebin2", NULL);
+  else
+    decodebin = gst_element_factory_make ("decodebin", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+
+  if (!src || !decodebin || !sink) {
+    GST_WARNING_OBJECT (still, "Couldn't create the decoding elements");
+    if (src)
+      gst_object_unref (src);
+    if (decodebin)
+      gst_object_unref (decodebin);
+    if (sink)
+      gst_object_unref (sink);
+    return NULL;
+  }
+
+  pipeline = gst_pipeline_new (NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, decodebin, sink, NULL);
+  gst_element_link (src, decodebin);
+
+  g_object_set (sink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (decodebin, "pad-added",
+      G_CALLBACK (decoded_pad_added_cb), sink);
+  g_signal_connect (sink, "preroll-handoff",
+      G_CALLBACK (preroll_handoff_cb), &frame);
+
+  if (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE)
+    gst_element_get_state (pipeline, NULL, NULL, DECODE_TIMEOUT);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  if (frame && !GST_BUFFER_CAPS (frame)) {
+    gst_buffer_unref (frame);
+    frame = NULL;
+  }
+
+  return frame;
+}
+
+static void
+still_frame_free (GnlStillFrame * shared)
+{
+  gst_buffer_unref (shared->buffer);
+  g_free (shared);
+}
+
+/*
+ * acquire_frame:
+ *
+ * Returns: A reference on the decoded frame of @location, decoding it if no
+ * other GnlStillSource uses it yet. Must be released with release_frame().
+ */
+
+static GstBuffer *
+acquire_frame (GnlStillSource * still, const gchar * location)
+{
+  GnlStillFrame *shared;
+  GstBuffer *buffer;
+
+  g_static_mutex_lock (&frames_lock);
+  if (!frames)
+    frames = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) still_frame_free);
+
+  if ((shared = g_hash_table_lookup (frames, location))) {
+    GST_DEBUG_OBJECT (still, "Reusing decoded frame of %s", location);
+    shared->users++;
+    buffer = gst_buffer_ref (shared->buffer);
+    g_static_mutex_unlock (&frames_lock);
+    return buffer;
+  }
+  g_static_mutex_unlock (&frames_lock);
+
+  /* Don't hold the lock while decoding, other images can be used meanwhile */
+  if (!(buffer = decode_frame (still, location)))
+    return NULL;
+
+  g_static_mutex_lock (&frames_lock);
+  if ((shared = g_hash_table_lookup (frames, location))) {
+    /* decoded by another source in the meantime */
+    gst_buffer_unref (buffer);
+    buffer = gst_buffer_ref (shared->buffer);
+  } else {
+    shared = g_new0 (GnlStillFrame, 1);
+    shared->buffer = gst_buffer_ref (buffer);
+    g_hash_table_insert (frames, g_strdup (location), shared);
+  }
+  shared->users++;
+  g_static_mutex_unlock (&frames_lock);
+
+  return buffer;
+}
+
+static void
+release_frame (const gchar * location)
+{
+  GnlStillFrame *shared;
+
+  g_static_mutex_lock (&frames_lock);
+  if ((shared = g_hash_table_lookup (frames, location)) && !--shared->users)
+    g_hash_table_remove (frames, location);
+  g_static_mutex_unlock (&frames_lock);
+}
+
+/*
+ * gnl_still_source_reset:
+ *
+ * Drops the decoded frame (if @frame) and the output template.
+ */
+
+static void
+gnl_still_source_reset (GnlStillSource * still, gboolean frame)
+{
+  GnlStillSourcePrivate *priv = still->priv;
+
+  if (priv->template) {
+    gst_buffer_unref (priv->template);
+    priv->template = NULL;
+  }
+
+  if (frame && priv->frame) {
+    release_frame (priv->location);
+    gst_buffer_unref (priv->frame);
+    priv->frame = NULL;
+  }
+}
+
+/*
+ * gnl_still_source_prepare_template:
+ *
+ * Makes the template buffer output by pull_frame(), sharing the data of the
+ * decoded frame but with the wanted framerate.
+ */
+
+static gboolean
+gnl_still_source_prepare_template (GnlStillSource * still)
+{
+  GnlStillSourcePrivate *priv = still->priv;
+  GstCaps *caps;
+
+  if (priv->template)
+    return TRUE;
+
+  if (!priv->location)
+    return FALSE;
+
+  if (!priv->frame && !(priv->frame = acquire_frame (still, priv->location)))
+    return FALSE;
+
+  priv->template = gst_buffer_create_sub (priv->frame, 0,
+      GST_BUFFER_SIZE (priv->frame));
+  caps = gst_caps_copy (GST_BUFFER_CAPS (priv->frame));
+  gst_caps_set_simple (caps, "framerate", GST_TYPE_FRACTION, priv->fps_n,
+      priv->fps_d, NULL);
+  gst_buffer_set_caps (priv->template, caps);
+  gst_caps_unref (caps);
+
+  return TRUE;
+}
+
+/*
+ * pull_frame:
+ *
+ * GnlBufferSrcPullFunc outputting the frame containing @position, at the
+ * wanted framerate. The image is decoded on the first call.
+ */
+
+static GstBuffer *
+pull_frame (GstClockTime position, GnlStillSource * still)
+{
+  GnlStillSourcePrivate *priv = still->priv;
+  GstBuffer *buffer;
+  guint64 n;
+
+  if (!gnl_still_source_prepare_template (still)) {
+    GST_ELEMENT_ERROR (still, RESOURCE, READ, (NULL),
+        ("Couldn't decode image %s", GST_STR_NULL (priv->location)));
+    return NULL;
+  }
+
+  /* frame playing at position, taking rounding errors into account */
+  n = gst_util_uint64_scale (position, priv->fps_n,
+      (guint64) priv->fps_d * GST_SECOND);
+  if (gst_util_uint64_scale (n + 1, (guint64) priv->fps_d * GST_SECOND,
+          priv->fps_n) <= position)
+    n++;
+
+  buffer = gst_buffer_create_sub (priv->template, 0,
+      GST_BUFFER_SIZE (priv->template));
+  gst_buffer_set_caps (buffer, GST_BUFFER_CAPS (priv->template));
+  GST_BUFFER_OFFSET (buffer) = n;
+  GST_BUFFER_OFFSET_END (buffer) = n + 1;
+  GST_BUFFER_TIMESTAMP (buffer) =
+      gst_util_uint64_scale (n, (guint64) priv->fps_d * GST_SECOND,
+      priv->fps_n);
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale (n + 1, (guint64) priv->fps_d * GST_SECOND,
+      priv->fps_n) - GST_BUFFER_TIMESTAMP (buffer);
+
+  return buffer;
+}
+
+static void
+gnl_still_source_finalize (GObject * object)
+{
+  GnlStillSource *still = (GnlStillSource *) object;
+
+  gnl_still_source_reset (still, TRUE);
+  g_free (still->priv->location);
+  g_free (still->priv);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gnl_still_source_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GnlStillSource *still = (GnlStillSource *) object;
+  GstState state, pending;
+
+  /* The streaming thread uses the template, frame, location and framerate
+   * without locking */
+  GST_OBJECT_LOCK (still);
+  state = GST_STATE (still);
+  pending = GST_STATE_PENDING (still);
+  GST_OBJECT_UNLOCK (still);
+  if ((state > GST_STATE_READY) || (pending > GST_STATE_READY)) {
+    GST_WARNING_OBJECT (still, "Can't change %s above READY",
+        g_param_spec_get_name (pspec));
+    return;
+  }
+
+  switch (prop_id) {
+    case ARG_LOCATION:
+      gnl_still_source_reset (still, TRUE);
+      g_free (still->priv->location);
+      still->priv->location = g_value_dup_string (value);
+      break;
+    case ARG_FRAMERATE:
+      gnl_still_source_reset (still, FALSE);
+      still->priv->fps_n = gst_value_get_fraction_numerator (value);
+      still->priv->fps_d = gst_value_get_fraction_denominator (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gnl_still_source_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GnlStillSource *still = (GnlStillSource *) object;
+
+  switch (prop_id) {
+    case ARG_LOCATION:
+      g_value_set_string (value, still->priv->location);
+      break;
+    case ARG_FRAMERATE:
+      gst_value_set_fraction (value, still->priv->fps_n, still->priv->fps_d);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstStateChangeReturn
+gnl_still_source_change_state (GstElement * element, GstStateChange transition)
+{
+  GnlStillSource *still = (GnlStillSource *) element;
+
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      /* The image is decoded later, from the streaming thread */
+      if (!still->priv->location) {
+        GST_ELEMENT_ERROR (still, RESOURCE, NOT_FOUND, (NULL),
+            ("No location was set"));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* The streaming thread is stopped, give the shared frame back */
+      gnl_still_source_reset (still, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
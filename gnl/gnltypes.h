@@ -27,6 +27,8 @@
 typedef struct _GnlObject GnlObject;
 typedef struct _GnlObjectClass GnlObjectClass;
 
+typedef struct _GnlTimeTransform GnlTimeTransform;
+
 typedef struct _GnlComposition GnlComposition;
 typedef struct _GnlCompositionClass GnlCompositionClass;
 
@@ -39,4 +41,15 @@ typedef struct _GnlSourceClass GnlSourceClass;
 typedef struct _GnlFileSource GnlFileSource;
 typedef struct _GnlFileSourceClass GnlFileSourceClass;
 
+typedef struct _GnlStillSource GnlStillSource;
+typedef struct _GnlStillSourceClass GnlStillSourceClass;
+
+typedef struct _GnlMemorySource GnlMemorySource;
+typedef struct _GnlMemorySourceClass GnlMemorySourceClass;
+
+typedef struct _GnlBufferSrc GnlBufferSrc;
+typedef struct _GnlBufferSrcClass GnlBufferSrcClass;
+
+typedef struct _GnlCache GnlCache;
+
 #endif
@@ -0,0 +1,92 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measures the cost of the object to media time conversions done for every
+ * event going through a GnlObject, and how far the former floating point
+ * computation drifted from the exact value on a long clip.
+ *
+ * Usage: tests/benchmarks/conversion [iterations]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include "gnl.h"
+
+/* three hours */
+#define CLIP_DURATION (3 * 3600 * GST_SECOND)
+
+static void
+run (const gchar * name, GstClockTime mstart, GstClockTimeDiff mduration,
+    guint iterations)
+{
+  GnlObject *object;
+  GTimer *timer;
+  GstClockTime otime, mtime, otime2, step;
+  GstClockTime exact, drift, maxdrift = 0;
+  gdouble elapsed;
+  guint i;
+
+  object = (GnlObject *) g_object_new (GNL_TYPE_OBJECT, NULL);
+  g_object_set (object, "start", (GstClockTime) 10 * GST_SECOND,
+      "duration", (GstClockTimeDiff) CLIP_DURATION,
+      "media-start", mstart, "media-duration", mduration, NULL);
+
+  step = MAX (CLIP_DURATION / iterations, 1);
+
+  timer = g_timer_new ();
+  for (i = 0, otime = object->start; i < iterations; i++, otime += step) {
+    gnl_object_to_media_time (object, otime, &mtime);
+    gnl_media_to_object_time (object, mtime, &otime2);
+  }
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  for (i = 0, otime = object->start; i < iterations; i++, otime += step) {
+    exact = gst_util_uint64_scale (otime - object->start, mduration,
+        CLIP_DURATION) + mstart;
+    mtime = (otime - object->start) * object->rate + mstart;
+    drift = (mtime > exact) ? mtime - exact : exact - mtime;
+    maxdrift = MAX (maxdrift, drift);
+  }
+
+  g_print ("%-9s: %6.1f ns per conversion, floating point drift up to %"
+      G_GUINT64_FORMAT " ns\n", name, elapsed * 1e9 / (2 * iterations),
+      maxdrift);
+
+  gst_object_unref (object);
+}
+
+int
+main (int argc, char **argv)
+{
+  guint iterations = 1000000;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    iterations = MAX (atoi (argv[1]), 1);
+
+  run ("identity", 10 * GST_SECOND, CLIP_DURATION, iterations);
+  run ("shifted", 0, CLIP_DURATION, iterations);
+  run ("29.97fps", 0, gst_util_uint64_scale (CLIP_DURATION, 1000, 1001),
+      iterations);
+  run ("double", 0, 2 * CLIP_DURATION, iterations);
+
+  return 0;
+}
@@ -0,0 +1,193 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Renders a composition of back-to-back videotestsrc clips to a fakesink as
+ * fast as possible, without any main loop, and compares it with a single
+ * videotestsrc pushing the same amount of data.
+ *
+ * Fails if the composition is less than TARGET_RATIO as fast, ie if the
+ * stack switching overhead isn't negligible.
+ *
+ * Usage: GST_PLUGIN_PATH=gnl/.libs tests/benchmarks/render [nbclips]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define CLIP_DURATION GST_SECOND
+#define CLIP_FRAMES 30
+#define CLIP_CAPS "video/x-raw-yuv,framerate=(fraction)30/1"
+
+#define TARGET_RATIO 0.9
+
+static void
+composition_pad_added_cb (GstElement * comp, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static GstElement *
+make_clip (guint i)
+{
+  GstElement *source, *videotestsrc;
+  GstCaps *caps;
+
+  caps = gst_caps_from_string (CLIP_CAPS);
+  source = gst_element_factory_make ("gnlsource", NULL);
+  g_object_set (source, "start", (guint64) i * CLIP_DURATION,
+      "duration", (gint64) CLIP_DURATION, "media-start", (guint64) 0,
+      "media-duration", (gint64) CLIP_DURATION, "priority", 1,
+      "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  videotestsrc = gst_element_factory_make ("videotestsrc", NULL);
+  g_object_set (videotestsrc, "pattern", i % 2, NULL);
+  gst_bin_add (GST_BIN (source), videotestsrc);
+
+  return source;
+}
+
+/* Returns how long @pipeline took to reach EOS, in seconds, or a negative
+ * value on errors */
+static gdouble
+run (GstElement * pipeline)
+{
+  GstMessage *message;
+  GstBus *bus;
+  GTimer *timer;
+  gboolean done = FALSE, error = FALSE;
+  gdouble elapsed;
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  while (!done) {
+    message = gst_bus_timed_pop (bus, GST_CLOCK_TIME_NONE);
+
+    switch (GST_MESSAGE_TYPE (message)) {
+      case GST_MESSAGE_EOS:
+        done = TRUE;
+        break;
+      case GST_MESSAGE_ERROR:
+        g_printerr ("Error from %s\n", GST_OBJECT_NAME (message->src));
+        error = done = TRUE;
+        break;
+      default:
+        break;
+    }
+    gst_message_unref (message);
+  }
+
+  elapsed = error ? -1.0 : g_timer_elapsed (timer, NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_timer_destroy (timer);
+  gst_object_unref (bus);
+
+  return elapsed;
+}
+
+static gdouble
+run_composition (guint nbclips)
+{
+  GstElement *pipeline, *comp, *sink;
+  gdouble ret;
+  guint i;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  comp = gst_element_factory_make ("gnlcomposition", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!comp || !sink) {
+    g_printerr ("Couldn't create gnlcomposition or fakesink\n");
+    return -1.0;
+  }
+
+  g_object_set (comp, "render-mode", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  for (i = 0; i < nbclips; i++)
+    gst_bin_add (GST_BIN (comp), make_clip (i));
+
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+  g_signal_connect (comp, "pad-added",
+      G_CALLBACK (composition_pad_added_cb), sink);
+
+  ret = run (pipeline);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+static gdouble
+run_single_source (guint nbclips)
+{
+  GstElement *pipeline, *src, *sink;
+  GstCaps *caps;
+  gdouble ret;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!src || !sink) {
+    g_printerr ("Couldn't create videotestsrc or fakesink\n");
+    return -1.0;
+  }
+
+  g_object_set (src, "num-buffers", nbclips * CLIP_FRAMES, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  caps = gst_caps_from_string (CLIP_CAPS);
+  gst_element_link_filtered (src, sink, caps);
+  gst_caps_unref (caps);
+
+  ret = run (pipeline);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+int
+main (int argc, char **argv)
+{
+  gdouble single, composition, ratio;
+  guint nbclips = 100;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    nbclips = atoi (argv[1]);
+
+  single = run_single_source (nbclips);
+  composition = run_composition (nbclips);
+  if (single < 0.0 || composition < 0.0)
+    return 1;
+
+  ratio = single / composition;
+  g_print ("Rendered %u clips (%" GST_TIME_FORMAT ") in %.3fs: %.1fx realtime, "
+      "%.0f%% of the speed of a single source (%.3fs), target %.0f%%\n",
+      nbclips, GST_TIME_ARGS (nbclips * CLIP_DURATION), composition,
+      (gdouble) nbclips * CLIP_DURATION / GST_SECOND / composition,
+      ratio * 100, single, TARGET_RATIO * 100);
+
+  return (ratio >= TARGET_RATIO) ? 0 : 1;
+}
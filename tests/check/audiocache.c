@@ -0,0 +1,243 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Unit tests of the decoded audio cache and of the raw file mode of
+ * GnlBufferSrc, which aren't reachable through the elements' API.
+ * gnlaudiocache.c and gnlbuffersrc.c are built into this program. */
+
+#include <sys/stat.h>
+#include "common.h"
+#include "gnlaudiocache.h"
+#include "gnlbuffersrc.h"
+
+/* 48kHz stereo 16bit native endian samples */
+static GstCaps *
+make_raw_caps (void)
+{
+  return gst_caps_new_simple ("audio/x-raw-int",
+      "rate", G_TYPE_INT, 48000,
+      "channels", G_TYPE_INT, 2,
+      "endianness", G_TYPE_INT, G_BYTE_ORDER,
+      "width", G_TYPE_INT, 16,
+      "depth", G_TYPE_INT, 16, "signed", G_TYPE_BOOLEAN, TRUE, NULL);
+}
+
+/* Looks @location up until it is decoded, at most 20s */
+static gchar *
+wait_decoded (const gchar * dir, const gchar * location, GstCaps * caps,
+    GstClockTime * start)
+{
+  gchar *path = NULL;
+  guint i;
+
+  for (i = 0; (i < 200) && !path; i++) {
+    if (!(path = gnl_audio_cache_lookup (dir, location, caps, start)))
+      g_usleep (G_USEC_PER_SEC / 10);
+  }
+
+  return path;
+}
+
+static void
+remove_cache_file (const gchar * path)
+{
+  gchar *startpath = g_strdup_printf ("%s.start", path);
+
+  g_unlink (startpath);
+  g_unlink (path);
+  g_free (startpath);
+}
+
+GST_START_TEST (test_decode)
+{
+  GstCaps *caps;
+  GstClockTime start;
+  gchar *dir, *locations[3], *paths[3], *name, *tmppath;
+  struct stat st;
+  guint i;
+
+  dir = g_build_filename (g_get_tmp_dir (), "gnl-audiocache-test", NULL);
+  caps = make_raw_caps ();
+
+  /* More files than decoding threads, the others are queued */
+  for (i = 0; i < 3; i++) {
+    name = g_strdup_printf ("gnl-audiocache-test-%u.wav", i);
+    locations[i] = make_audio_file (name);
+    g_free (name);
+    fail_unless (gnl_audio_cache_lookup (dir, locations[i], caps,
+            &start) == NULL);
+  }
+
+  for (i = 0; i < 3; i++) {
+    paths[i] = wait_decoded (dir, locations[i], caps, &start);
+    fail_unless (paths[i] != NULL);
+
+    /* 1s of contiguous samples, from the first timestamp */
+    fail_unless_equals_uint64 (start, 0);
+    fail_unless (g_stat (paths[i], &st) == 0);
+    fail_unless_equals_int (st.st_size, 48000 * 4);
+
+    /* and the temporary file is gone */
+    tmppath = g_strdup_printf ("%s.tmp", paths[i]);
+    fail_if (g_file_test (tmppath, G_FILE_TEST_EXISTS));
+    g_free (tmppath);
+  }
+
+  /* Each file has its own cache file */
+  fail_if (g_str_equal (paths[0], paths[1]));
+
+  /* Only local files are cached */
+  fail_unless (gnl_audio_cache_lookup (dir, "http://localhost/test.wav",
+          caps, &start) == NULL);
+  fail_unless (gnl_audio_cache_lookup (dir, "/nonexistent/test.wav",
+          caps, &start) == NULL);
+
+  for (i = 0; i < 3; i++) {
+    remove_cache_file (paths[i]);
+    g_unlink (locations[i]);
+    g_free (paths[i]);
+    g_free (locations[i]);
+  }
+  g_rmdir (dir);
+  g_free (dir);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+static gboolean
+first_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GstBuffer ** first)
+{
+  if (!*first)
+    *first = gst_buffer_ref (buffer);
+
+  return TRUE;
+}
+
+/* First buffer output by a GnlBufferSrc reading @path, seeked to @position */
+static GstBuffer *
+play_raw_file (const gchar * path, GstCaps * caps, GstClockTime start,
+    GstClockTime position)
+{
+  GstElement *pipeline, *src, *sink;
+  GstBuffer *first = NULL;
+  GstPad *sinkpad;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  src = (GstElement *) g_object_new (GNL_TYPE_BUFFER_SRC, NULL);
+  fail_unless (gnl_buffer_src_set_raw_file ((GnlBufferSrc *) src, path, caps,
+          start));
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (first_buffer_probe), &first);
+  gst_object_unref (sinkpad);
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, position));
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (pipeline);
+
+  fail_unless (first != NULL);
+  return first;
+}
+
+GST_START_TEST (test_raw_file_start)
+{
+  GstCaps *caps;
+  GstBuffer *buffer;
+  gint16 *samples;
+  gchar *path;
+  guint i;
+
+  /* 1s of samples, the left channel of each one holds its index / 2 */
+  samples = g_new (gint16, 48000 * 2);
+  for (i = 0; i < 48000; i++) {
+    samples[2 * i] = i / 2;
+    samples[2 * i + 1] = 0;
+  }
+  path = g_build_filename (g_get_tmp_dir (), "gnl-raw-file-test.pcm", NULL);
+  fail_unless (g_file_set_contents (path, (gchar *) samples, 48000 * 4,
+          NULL));
+  g_free (samples);
+
+  caps = make_raw_caps ();
+
+  /* The first sample plays at 1s */
+  buffer = play_raw_file (path, caps, GST_SECOND, 1500 * GST_MSECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer),
+      1500 * GST_MSECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buffer), 24000);
+  fail_unless_equals_int (((gint16 *) GST_BUFFER_DATA (buffer))[0], 12000);
+  gst_buffer_unref (buffer);
+
+  /* There is nothing before the first sample */
+  buffer = play_raw_file (path, caps, GST_SECOND, 500 * GST_MSECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), GST_SECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buffer), 0);
+  gst_buffer_unref (buffer);
+
+  g_unlink (path);
+  g_free (path);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+Suite *
+gnonlin_suite (void)
+{
+  Suite *s = suite_create ("gnonlin");
+  TCase *tc_chain = tcase_create ("gnlaudiocache");
+
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, test_decode);
+  tcase_add_test (tc_chain, test_raw_file_start);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  int nf;
+
+  Suite *s = gnonlin_suite ();
+  SRunner *sr = srunner_create (s);
+
+  gst_check_init (&argc, &argv);
+
+  srunner_run_all (sr, CK_NORMAL);
+  nf = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  return nf;
+}
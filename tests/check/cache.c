@@ -0,0 +1,270 @@
+/* Gnonlin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Unit tests of the decoded buffer cache, which isn't reachable through
+ * the elements' API. gnlcache.c is built into this program. */
+
+#include <gst/check/gstcheck.h>
+#include "gnlcache.h"
+
+/* @n buffers of @size bytes, evenly covering [start, stop[ */
+static GPtrArray *
+make_run (GstClockTime start, GstClockTime stop, guint n, guint size)
+{
+  GPtrArray *buffers = g_ptr_array_new ();
+  GstBuffer *buffer;
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    buffer = gst_buffer_new_and_alloc (size);
+    GST_BUFFER_TIMESTAMP (buffer) = start + i * (stop - start) / n;
+    GST_BUFFER_DURATION (buffer) = (stop - start) / n;
+    g_ptr_array_add (buffers, buffer);
+  }
+
+  return buffers;
+}
+
+static void
+free_run (GPtrArray * buffers)
+{
+  guint i;
+
+  for (i = 0; i < buffers->len; i++)
+    gst_buffer_unref (GST_BUFFER (g_ptr_array_index (buffers, i)));
+  g_ptr_array_free (buffers, TRUE);
+}
+
+/* Whether [start, stop[ of @key is cached (counts a hit or a miss) */
+static gboolean
+is_cached (GnlCache * cache, const gchar * key, GstClockTime start,
+    GstClockTime stop)
+{
+  GPtrArray *buffers = gnl_cache_lookup (cache, key, start, stop);
+
+  if (!buffers)
+    return FALSE;
+  free_run (buffers);
+  return TRUE;
+}
+
+GST_START_TEST (test_insert_lookup)
+{
+  GnlCache *cache;
+  GPtrArray *buffers;
+  guint hits, misses;
+  guint64 size;
+
+  cache = gnl_cache_new ();
+  gnl_cache_set_budget (cache, 1000);
+
+  /* 10 buffers of 100ms, 10 bytes each */
+  gnl_cache_add (cache, "a", 0, GST_SECOND, make_run (0, GST_SECOND, 10, 10));
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 100);
+
+  /* the whole run */
+  buffers = gnl_cache_lookup (cache, "a", 0, GST_SECOND);
+  fail_unless (buffers != NULL);
+  fail_unless_equals_int (buffers->len, 10);
+  free_run (buffers);
+
+  /* only the buffers overlapping the range */
+  buffers = gnl_cache_lookup (cache, "a", 250 * GST_MSECOND,
+      500 * GST_MSECOND);
+  fail_unless (buffers != NULL);
+  fail_unless_equals_int (buffers->len, 3);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (g_ptr_array_index (buffers,
+              0)), 200 * GST_MSECOND);
+  free_run (buffers);
+
+  /* other keys and ranges which aren't covered entirely */
+  fail_unless (gnl_cache_lookup (cache, "b", 0, GST_SECOND) == NULL);
+  fail_unless (gnl_cache_lookup (cache, "a", 0, 2 * GST_SECOND) == NULL);
+
+  gnl_cache_get_stats (cache, &hits, &misses, NULL);
+  fail_unless_equals_int (hits, 2);
+  fail_unless_equals_int (misses, 2);
+
+  /* a run covered by an existing one is dropped */
+  gnl_cache_add (cache, "a", 0, 500 * GST_MSECOND,
+      make_run (0, 500 * GST_MSECOND, 5, 10));
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 100);
+
+  /* empty runs are dropped */
+  gnl_cache_add (cache, "c", 0, GST_SECOND, g_ptr_array_new ());
+  fail_unless (!is_cached (cache, "c", 0, GST_SECOND));
+
+  gnl_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_eviction_order)
+{
+  GnlCache *cache;
+
+  cache = gnl_cache_new ();
+  gnl_cache_set_budget (cache, 300);
+
+  gnl_cache_add (cache, "a", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  gnl_cache_add (cache, "b", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  gnl_cache_add (cache, "c", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+
+  /* a becomes the most recently used, b the least */
+  fail_unless (is_cached (cache, "a", 0, GST_SECOND));
+
+  gnl_cache_add (cache, "d", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  fail_unless (!is_cached (cache, "b", 0, GST_SECOND));
+  fail_unless (is_cached (cache, "a", 0, GST_SECOND));
+  fail_unless (is_cached (cache, "c", 0, GST_SECOND));
+  fail_unless (is_cached (cache, "d", 0, GST_SECOND));
+
+  /* now a is the least recently used */
+  gnl_cache_add (cache, "e", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  fail_unless (!is_cached (cache, "a", 0, GST_SECOND));
+  fail_unless (is_cached (cache, "c", 0, GST_SECOND));
+
+  gnl_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_budget)
+{
+  GnlCache *cache;
+  guint64 size;
+
+  cache = gnl_cache_new ();
+
+  /* disabled by default */
+  fail_unless_equals_uint64 (gnl_cache_get_budget (cache), 0);
+  gnl_cache_add (cache, "a", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 1));
+  fail_unless (!is_cached (cache, "a", 0, GST_SECOND));
+
+  gnl_cache_set_budget (cache, 250);
+
+  /* bigger than the budget, dropped */
+  gnl_cache_add (cache, "a", 0, GST_SECOND, make_run (0, GST_SECOND, 3, 100));
+  fail_unless (!is_cached (cache, "a", 0, GST_SECOND));
+
+  /* never over the budget */
+  gnl_cache_add (cache, "a", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  gnl_cache_add (cache, "b", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  gnl_cache_add (cache, "c", 0, GST_SECOND, make_run (0, GST_SECOND, 1, 100));
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 200);
+  fail_unless (!is_cached (cache, "a", 0, GST_SECOND));
+
+  /* lowering the budget evicts */
+  gnl_cache_set_budget (cache, 150);
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 100);
+  fail_unless (!is_cached (cache, "b", 0, GST_SECOND));
+  fail_unless (is_cached (cache, "c", 0, GST_SECOND));
+
+  /* 0 empties it */
+  gnl_cache_set_budget (cache, 0);
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 0);
+  fail_unless (!is_cached (cache, "c", 0, GST_SECOND));
+
+  gnl_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_media_change)
+{
+  GnlCache *cache;
+  GPtrArray *buffers;
+  guint64 size;
+
+  cache = gnl_cache_new ();
+  gnl_cache_set_budget (cache, 1000);
+
+  /* A source with media-start 0s and media-duration 1s played */
+  gnl_cache_add (cache, "file|caps", 0, GST_SECOND,
+      make_run (0, GST_SECOND, 10, 10));
+
+  /* Its media-duration is extended to 2s, the range isn't cached anymore */
+  fail_unless (!is_cached (cache, "file|caps", 0, 2 * GST_SECOND));
+
+  /* Its media-start is moved to 500ms, only the remaining buffers are
+   * output */
+  buffers = gnl_cache_lookup (cache, "file|caps", 500 * GST_MSECOND,
+      GST_SECOND);
+  fail_unless (buffers != NULL);
+  fail_unless_equals_int (buffers->len, 5);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (g_ptr_array_index (buffers,
+              0)), 500 * GST_MSECOND);
+  free_run (buffers);
+
+  /* Partly outside of what was played */
+  fail_unless (!is_cached (cache, "file|caps", 500 * GST_MSECOND,
+          1500 * GST_MSECOND));
+
+  /* The new range replaces the run it covers */
+  gnl_cache_add (cache, "file|caps", 0, 2 * GST_SECOND,
+      make_run (0, 2 * GST_SECOND, 20, 10));
+  gnl_cache_get_stats (cache, NULL, NULL, &size);
+  fail_unless_equals_uint64 (size, 200);
+  fail_unless (is_cached (cache, "file|caps", 500 * GST_MSECOND,
+          1500 * GST_MSECOND));
+
+  /* Other caps (ex: the stream changed) are another key */
+  fail_unless (!is_cached (cache, "file|othercaps", 0, GST_SECOND));
+
+  gnl_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+Suite *
+gnonlin_suite (void)
+{
+  Suite *s = suite_create ("gnonlin");
+  TCase *tc_chain = tcase_create ("gnlcache");
+
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, test_insert_lookup);
+  tcase_add_test (tc_chain, test_eviction_order);
+  tcase_add_test (tc_chain, test_budget);
+  tcase_add_test (tc_chain, test_media_change);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  int nf;
+
+  Suite *s = gnonlin_suite ();
+  SRunner *sr = srunner_create (s);
+
+  gst_check_init (&argc, &argv);
+
+  srunner_run_all (sr, CK_NORMAL);
+  nf = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  return nf;
+}
@@ -1,5 +1,6 @@
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 
 typedef struct _Segment {
   gdouble	rate;
@@ -275,3 +276,74 @@ segment_new (gdouble rate, GstFormat format, gint64 start, gint64 stop, gint64 p
     fail_if (duration != durval); \
   }
 
+
+/* Writes a small PNG image to a temporary file, returns its location */
+static gchar *
+make_still_image (const gchar * name)
+{
+  GstElement * pipeline;
+  GstElement * sink;
+  GstBus * bus;
+  GstMessage * message;
+  gchar * location;
+
+  location = g_build_filename (g_get_tmp_dir (), name, NULL);
+
+  pipeline = gst_parse_launch ("videotestsrc num-buffers=1 ! "
+      "video/x-raw-yuv,width=16,height=16 ! ffmpegcolorspace ! pngenc ! "
+      "filesink name=sink", NULL);
+  fail_if (pipeline == NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "location", location, NULL);
+  gst_object_unref (sink);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_if (gst_element_set_state (pipeline,
+	  GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS);
+  gst_message_unref (message);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+/* Writes 1s of 48kHz stereo 16bit audio to a wav file named @name in the
+ * temporary directory, returns its location */
+static gchar *
+make_audio_file (const gchar * name)
+{
+  GstElement * pipeline;
+  GstElement * sink;
+  GstBus * bus;
+  GstMessage * message;
+  gchar * location;
+
+  location = g_build_filename (g_get_tmp_dir (), name, NULL);
+
+  pipeline = gst_parse_launch ("audiotestsrc num-buffers=10 "
+      "samplesperbuffer=4800 ! audio/x-raw-int,rate=48000,channels=2,"
+      "width=16,depth=16 ! wavenc ! filesink name=sink", NULL);
+  fail_if (pipeline == NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "location", location, NULL);
+  gst_object_unref (sink);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_if (gst_element_set_state (pipeline,
+	  GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS);
+  gst_message_unref (message);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return location;
+}
@@ -53,6 +53,39 @@ on_composition_pad_removed_cb (GstElement * composition, GstPad * pad,
   ++composition_pad_removed;
 }
 
+/* Plays @pipeline until EOS, failing on errors */
+static void
+play_to_eos (GstElement * pipeline)
+{
+  GstBus *bus;
+  GstMessage *message;
+  gboolean carry_on = TRUE;
+
+  bus = gst_element_get_bus (pipeline);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  while (carry_on) {
+    message = gst_bus_poll (bus, GST_MESSAGE_ANY, GST_SECOND / 2);
+    if (message) {
+      switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_EOS:
+          carry_on = FALSE;
+          break;
+        case GST_MESSAGE_ERROR:
+          GST_WARNING ("Saw an ERROR");
+          fail_if (TRUE);
+        default:
+          break;
+      }
+      gst_mini_object_unref (GST_MINI_OBJECT (message));
+    }
+  }
+
+  gst_object_unref (bus);
+}
+
 GST_START_TEST (test_change_object_start_stop_in_current_stack)
 {
   GstElement *pipeline;
@@ -213,6 +246,1552 @@ GST_START_TEST (test_change_object_start_stop_in_current_stack)
 
 GST_END_TEST;
 
+GST_START_TEST (test_clone)
+{
+  guint64 start, stop;
+  gint64 duration;
+  GstElement *comp, *source1, *def, *clone, *source1copy;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 1, 2);
+  def =
+      videotest_gnl_src ("default", 0 * GST_SECOND, 0 * GST_SECOND, 1,
+      G_MAXUINT32);
+  gst_bin_add_many (GST_BIN (comp), source1, def, NULL);
+  check_start_stop_duration (comp, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+
+  g_signal_emit_by_name (comp, "clone", &clone);
+  fail_unless (clone != NULL);
+  fail_unless_equals_int (GST_BIN (clone)->numchildren, 2);
+  check_start_stop_duration (clone, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+
+  source1copy = gst_bin_get_by_name (GST_BIN (clone), "source1");
+  fail_unless (source1copy != NULL);
+  fail_if (source1copy == source1);
+  fail_unless_equals_int (GST_BIN (source1copy)->numchildren, 1);
+
+  /* editing the original doesn't modify the copy */
+  g_object_set (source1, "start", 1 * GST_SECOND, NULL);
+  check_start_stop_duration (comp, 0, 3 * GST_SECOND, 3 * GST_SECOND);
+  check_start_stop_duration (source1copy, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+  check_start_stop_duration (clone, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+
+  gst_object_unref (source1copy);
+  gst_object_unref (clone);
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_clone_settings)
+{
+  GstElement *comp, *master, *source1, *clone, *source1copy, *bin;
+  GstElement *clonemaster;
+  GstPad *pad, *target;
+  guint64 window;
+  guint priority;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  master =
+      gst_element_factory_make_or_warn ("gnlcomposition", "master_composition");
+  g_object_set (comp, "master", master, "retention-window",
+      (guint64) GST_SECOND, "priority", 3, NULL);
+
+  /* controls a hand-made bin */
+  source1 = audiotest_bin_src ("source1", 0, 2 * GST_SECOND, 1, TRUE);
+  gst_bin_add (GST_BIN (comp), source1);
+
+  g_signal_emit_by_name (comp, "clone", &clone);
+  fail_unless (clone != NULL);
+
+  /* the object properties are copied, not the composition settings */
+  g_object_get (clone, "master", &clonemaster, "retention-window", &window,
+      "priority", &priority, NULL);
+  fail_unless (clonemaster == NULL);
+  fail_unless (window == GST_CLOCK_TIME_NONE);
+  fail_unless_equals_int (priority, 3);
+
+  /* the bin is copied with its children, links and ghost pad */
+  source1copy = gst_bin_get_by_name (GST_BIN (clone), "source1");
+  fail_unless (source1copy != NULL);
+  fail_unless_equals_int (GST_BIN (source1copy)->numchildren, 1);
+  bin = (GstElement *) GST_BIN_CHILDREN (source1copy)->data;
+  fail_unless_equals_int (GST_BIN (bin)->numchildren,
+      GST_BIN (GST_BIN_CHILDREN (source1)->data)->numchildren);
+  pad = gst_element_get_static_pad (bin, "src");
+  fail_unless (pad != NULL);
+  target = gst_ghost_pad_get_target ((GstGhostPad *) pad);
+  fail_unless (target != NULL);
+  gst_object_unref (target);
+  gst_object_unref (pad);
+
+  gst_object_unref (source1copy);
+  gst_object_unref (clone);
+  gst_object_unref (comp);
+  gst_object_unref (master);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_clone_unfactored)
+{
+  GstElement *comp, *source1, *element, *handmade, *clone;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /* controls an element created without its factory */
+  element = gst_element_factory_make_or_warn ("audiotestsrc", NULL);
+  handmade = (GstElement *) g_object_new (G_OBJECT_TYPE (element), NULL);
+  gst_object_unref (element);
+  source1 = gst_element_factory_make_or_warn ("gnlsource", "source1");
+  gst_bin_add (GST_BIN (source1), handmade);
+  g_object_set (source1, "start", (guint64) 0, "duration",
+      (gint64) GST_SECOND, "media-start", (guint64) 0, "media-duration",
+      (gint64) GST_SECOND, NULL);
+  gst_bin_add (GST_BIN (comp), source1);
+
+  /* it can't be copied, without warnings */
+  g_signal_emit_by_name (comp, "clone", &clone);
+  fail_unless (clone == NULL);
+
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_query_range)
+{
+  GstElement *comp, *source1, *source2, *source3;
+  GValueArray *objects;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     source1 [0s -- 2s[ priority 1
+     source2 [1s -- 3s[ priority 2
+     source3 [4s -- 5s[ priority 1
+   */
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 2 * GST_SECOND, 1, 2);
+  source3 = videotest_gnl_src ("source3", 4 * GST_SECOND, 1 * GST_SECOND, 1, 1);
+  gst_bin_add_many (GST_BIN (comp), source3, source2, source1, NULL);
+
+  /* everything */
+  g_signal_emit_by_name (comp, "query-range", (guint64) 0,
+      (guint64) 10 * GST_SECOND, 0, G_MAXUINT32, &objects);
+  fail_unless_equals_int (objects->n_values, 3);
+  fail_unless (g_value_get_object (&objects->values[0]) == (GObject *) source1);
+  fail_unless (g_value_get_object (&objects->values[1]) == (GObject *) source2);
+  fail_unless (g_value_get_object (&objects->values[2]) == (GObject *) source3);
+  g_value_array_free (objects);
+
+  /* stop is excluded, start is included */
+  g_signal_emit_by_name (comp, "query-range", (guint64) 2 * GST_SECOND,
+      (guint64) 4 * GST_SECOND, 0, G_MAXUINT32, &objects);
+  fail_unless_equals_int (objects->n_values, 1);
+  fail_unless (g_value_get_object (&objects->values[0]) == (GObject *) source2);
+  g_value_array_free (objects);
+
+  /* priority range */
+  g_signal_emit_by_name (comp, "query-range", (guint64) 0,
+      (guint64) 10 * GST_SECOND, 1, 1, &objects);
+  fail_unless_equals_int (objects->n_values, 2);
+  fail_unless (g_value_get_object (&objects->values[0]) == (GObject *) source1);
+  fail_unless (g_value_get_object (&objects->values[1]) == (GObject *) source3);
+  g_value_array_free (objects);
+
+  /* fewer objects stop after the start than start before the stop, they
+   * are still sorted by start */
+  g_signal_emit_by_name (comp, "query-range", (guint64) 2500 * GST_MSECOND,
+      (guint64) 10 * GST_SECOND, 0, G_MAXUINT32, &objects);
+  fail_unless_equals_int (objects->n_values, 2);
+  fail_unless (g_value_get_object (&objects->values[0]) == (GObject *) source2);
+  fail_unless (g_value_get_object (&objects->values[1]) == (GObject *) source3);
+  g_value_array_free (objects);
+
+  /* empty region */
+  g_signal_emit_by_name (comp, "query-range", (guint64) 3 * GST_SECOND,
+      (guint64) 4 * GST_SECOND, 0, G_MAXUINT32, &objects);
+  fail_unless_equals_int (objects->n_values, 0);
+  g_value_array_free (objects);
+
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+static GObject *
+schedule_top_object (const GValue * value)
+{
+  const GstStructure *entry, *stack;
+
+  entry = gst_value_get_structure (value);
+  if (!gst_structure_has_field (entry, "stack"))
+    return NULL;
+  stack = gst_value_get_structure (gst_structure_get_value (entry, "stack"));
+  return (GObject *)
+      g_value_get_object (gst_structure_get_value (stack, "object"));
+}
+
+static guint
+check_schedule (GValueArray * schedule, GstClockTime start, GstClockTime stop)
+{
+  const GstStructure *entry;
+  guint64 estart, estop;
+  guint i, gaps = 0;
+
+  for (i = 0; i < schedule->n_values; i++) {
+    entry = gst_value_get_structure (&schedule->values[i]);
+    estart = g_value_get_uint64 (gst_structure_get_value (entry, "start"));
+    estop = g_value_get_uint64 (gst_structure_get_value (entry, "stop"));
+    fail_unless (estart == start);
+    fail_unless (estop > estart);
+    if (!schedule_top_object (&schedule->values[i]))
+      gaps++;
+    start = estop;
+  }
+  fail_unless (start == stop);
+
+  return gaps;
+}
+
+GST_START_TEST (test_schedule)
+{
+  GstElement *comp, *source1, *source2, *source3;
+  GValueArray *schedule;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     source1 [0s -- 2s[ priority 1
+     source2 [1s -- 3s[ priority 2
+     source3 [4s -- 5s[ priority 1
+   */
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 2 * GST_SECOND, 1, 2);
+  source3 = videotest_gnl_src ("source3", 4 * GST_SECOND, 1 * GST_SECOND, 1, 1);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, source3, NULL);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 5 * GST_SECOND), 1);
+  fail_unless (schedule_top_object (&schedule->values[0]) ==
+      (GObject *) source1);
+  fail_unless (schedule_top_object (&schedule->values[schedule->n_values -
+              1]) == (GObject *) source3);
+  g_value_array_free (schedule);
+
+  /* Moving source3 fills the gap and shortens the timeline */
+  g_object_set (source3, "start", (guint64) 3 * GST_SECOND, NULL);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 4 * GST_SECOND), 0);
+  fail_unless (schedule_top_object (&schedule->values[schedule->n_values -
+              1]) == (GObject *) source3);
+  g_value_array_free (schedule);
+
+  /* Removing source1 */
+  gst_bin_remove (GST_BIN (comp), source1);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 1 * GST_SECOND,
+          4 * GST_SECOND), 0);
+  fail_unless (schedule_top_object (&schedule->values[0]) ==
+      (GObject *) source2);
+  g_value_array_free (schedule);
+
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_partitions)
+{
+  GstElement *comp, *source1, *source2, *source3, *source4;
+  GValueArray *schedule, *partitions;
+  const GstStructure *entry;
+  guint i;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     source1 [0s -- 4s[ priority 1
+     source2 [1s -- 3s[ priority 2, hidden below source1
+     source3 [4s -- 6s[ priority 1
+     source4 [5s -- 8s[ priority 0, above source3
+   */
+  source1 = videotest_gnl_src ("source1", 0, 4 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 2 * GST_SECOND, 1, 2);
+  source3 = videotest_gnl_src ("source3", 4 * GST_SECOND, 2 * GST_SECOND, 1, 1);
+  source4 = videotest_gnl_src ("source4", 5 * GST_SECOND, 3 * GST_SECOND, 1, 0);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, source3, source4, NULL);
+
+  /* a single range */
+  g_signal_emit_by_name (comp, "get-partitions", 1, &partitions);
+  fail_unless_equals_int (partitions->n_values, 2);
+  fail_unless (g_value_get_uint64 (&partitions->values[0]) == 0);
+  fail_unless (g_value_get_uint64 (&partitions->values[1]) == 8 * GST_SECOND);
+  g_value_array_free (partitions);
+
+  /* the middle is a stack boundary */
+  g_signal_emit_by_name (comp, "get-partitions", 2, &partitions);
+  fail_unless_equals_int (partitions->n_values, 3);
+  fail_unless (g_value_get_uint64 (&partitions->values[0]) == 0);
+  fail_unless (g_value_get_uint64 (&partitions->values[1]) == 4 * GST_SECOND);
+  fail_unless (g_value_get_uint64 (&partitions->values[2]) == 8 * GST_SECOND);
+  g_value_array_free (partitions);
+
+  /* with many ranges, every stack boundary is used, and only them */
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 8 * GST_SECOND), 0);
+  /* source4 starting above source3 splits it */
+  fail_unless (schedule->n_values >= 3);
+
+  g_signal_emit_by_name (comp, "get-partitions", 100, &partitions);
+  fail_unless_equals_int (partitions->n_values, schedule->n_values + 1);
+  fail_unless (g_value_get_uint64 (&partitions->values[0]) == 0);
+  for (i = 0; i < schedule->n_values; i++) {
+    entry = gst_value_get_structure (&schedule->values[i]);
+    fail_unless (g_value_get_uint64 (&partitions->values[i + 1]) ==
+        g_value_get_uint64 (gst_structure_get_value (entry, "stop")));
+  }
+  g_value_array_free (partitions);
+  g_value_array_free (schedule);
+
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+static guint
+schedule_top_children (const GValue * value)
+{
+  const GstStructure *entry, *stack;
+
+  entry = gst_value_get_structure (value);
+  stack = gst_value_get_structure (gst_structure_get_value (entry, "stack"));
+  return ((GValueArray *)
+      g_value_get_boxed (gst_structure_get_value (stack,
+              "children")))->n_values;
+}
+
+GST_START_TEST (test_opaque)
+{
+  guint64 start, stop;
+  gint64 duration;
+  GstElement *comp, *oper, *source1, *source2;
+  GValueArray *schedule;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     oper    [0s -- 2s[ priority 0, variable number of inputs
+     source1 [0s -- 2s[ priority 1
+     source2 [0s -- 2s[ priority 2
+   */
+  oper = new_operation ("oper", "videomixer", 0, 2 * GST_SECOND, 0);
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 0, 2 * GST_SECOND, 2, 2);
+  gst_bin_add_many (GST_BIN (comp), oper, source1, source2, NULL);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 2 * GST_SECOND), 0);
+  fail_unless (schedule_top_object (&schedule->values[0]) ==
+      (GObject *) oper);
+  fail_unless_equals_int (schedule_top_children (&schedule->values[0]), 2);
+  g_value_array_free (schedule);
+
+  /* source2 is hidden below source1 */
+  g_object_set (source1, "opaque", TRUE, NULL);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 2 * GST_SECOND), 0);
+  fail_unless_equals_int (schedule_top_children (&schedule->values[0]), 1);
+  g_value_array_free (schedule);
+
+  /* and visible again */
+  g_object_set (source1, "opaque", FALSE, NULL);
+  check_start_stop_duration (comp, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  fail_unless_equals_int (check_schedule (schedule, 0, 2 * GST_SECOND), 0);
+  fail_unless_equals_int (schedule_top_children (&schedule->values[0]), 2);
+  g_value_array_free (schedule);
+
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_extract_frames)
+{
+  GstElement *comp, *source1, *source2;
+  GValueArray *timestamps, *frames;
+  GValue val = { 0, };
+  GstBuffer *frame;
+  guint64 wanted[] = { 0, 100 * GST_MSECOND, 1500 * GST_MSECOND,
+    2900 * GST_MSECOND, 10 * GST_SECOND
+  };
+  guint i;
+
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     source1 [0s -- 1s[
+     source2 [1s -- 3s[
+   */
+  source1 = videotest_gnl_src ("source1", 0, 1 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 2 * GST_SECOND, 1,
+      1);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, NULL);
+
+  timestamps = g_value_array_new (G_N_ELEMENTS (wanted));
+  g_value_init (&val, G_TYPE_UINT64);
+  for (i = 0; i < G_N_ELEMENTS (wanted); i++) {
+    g_value_set_uint64 (&val, wanted[i]);
+    g_value_array_append (timestamps, &val);
+  }
+  g_value_unset (&val);
+
+  g_signal_emit_by_name (comp, "extract-frames", timestamps, &frames);
+  fail_unless (frames != NULL);
+  fail_unless_equals_int (frames->n_values, G_N_ELEMENTS (wanted));
+
+  /* One frame covering each position of the timeline, none after its end */
+  for (i = 0; i < G_N_ELEMENTS (wanted) - 1; i++) {
+    frame = (GstBuffer *) gst_value_get_mini_object (&frames->values[i]);
+    fail_unless (frame != NULL);
+    fail_unless (GST_BUFFER_TIMESTAMP (frame) <= wanted[i]);
+    fail_unless (GST_BUFFER_TIMESTAMP (frame) + GST_BUFFER_DURATION (frame) >
+        wanted[i]);
+  }
+  fail_unless (gst_value_get_mini_object (&frames->values[i]) == NULL);
+  g_value_array_free (frames);
+
+  /* Unsorted timestamps are refused */
+  g_value_init (&val, G_TYPE_UINT64);
+  g_value_set_uint64 (&val, 0);
+  g_value_array_append (timestamps, &val);
+  g_value_unset (&val);
+  g_signal_emit_by_name (comp, "extract-frames", timestamps, &frames);
+  fail_unless (frames == NULL);
+
+  g_value_array_free (timestamps);
+  gst_object_unref (comp);
+}
+
+GST_END_TEST;
+
+static gboolean
+stable_caps_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GList ** caps)
+{
+  if (!g_list_find (*caps, GST_BUFFER_CAPS (buffer)))
+    *caps = g_list_append (*caps, GST_BUFFER_CAPS (buffer));
+
+  return TRUE;
+}
+
+/* A pipeline rendering @nbclips consecutive 100ms clips in render-mode */
+static GstElement *
+render_mode_pipeline (guint nbclips)
+{
+  GstElement *pipeline, *comp, *sink;
+  gchar *name;
+  guint i;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "render-mode", TRUE, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  for (i = 0; i < nbclips; i++) {
+    name = g_strdup_printf ("source%u", i);
+    gst_bin_add (GST_BIN (comp), videotest_gnl_src (name,
+            i * 100 * GST_MSECOND, 100 * GST_MSECOND, i % 2, 1));
+    g_free (name);
+  }
+
+  return pipeline;
+}
+
+GST_START_TEST (test_render_mode)
+{
+  GstElement *pipeline;
+  GstMessage *message;
+  GstBus *bus;
+  guint i;
+
+  /* Stacks are switched without any main loop running */
+  pipeline = render_mode_pipeline (5);
+  bus = gst_element_get_bus (pipeline);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  message = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (message != NULL);
+  fail_unless (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS);
+  gst_message_unref (message);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  /* Stopping while stacks are being switched */
+  pipeline = render_mode_pipeline (50);
+  for (i = 0; i < 20; i++) {
+    fail_if (gst_element_set_state (pipeline,
+            GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+    g_usleep (i * G_USEC_PER_SEC / 100);
+    fail_if (gst_element_set_state (pipeline,
+            GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  }
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+/* Plays 3 consecutive 1s local files with @lookahead, and returns the
+ * prefetch stats */
+static void
+play_prefetch (guint64 lookahead, guint * hits, guint * misses)
+{
+  GstElement *pipeline, *comp, *source, *sink;
+  gchar *name, *locations[3];
+  guint i;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "lookahead", lookahead, NULL);
+
+  /* synchronized, so prefetching has time to complete */
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  for (i = 0; i < 3; i++) {
+    name = g_strdup_printf ("gnl-prefetch-test-%u.wav", i);
+    locations[i] = make_audio_file (name);
+    g_free (name);
+
+    source = gst_element_factory_make_or_warn ("gnlfilesource", NULL);
+    g_object_set (source, "location", locations[i],
+        "start", (guint64) i * GST_SECOND, "duration", (gint64) GST_SECOND,
+        "media-start", (guint64) 0, "media-duration", (gint64) GST_SECOND,
+        NULL);
+    gst_bin_add (GST_BIN (comp), source);
+  }
+
+  play_to_eos (pipeline);
+
+  g_object_get (comp, "prefetch-hits", hits, "prefetch-misses", misses, NULL);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (pipeline);
+
+  for (i = 0; i < 3; i++) {
+    g_unlink (locations[i]);
+    g_free (locations[i]);
+  }
+}
+
+GST_START_TEST (test_prefetch)
+{
+  guint hits, misses;
+
+  /* Disabled by default */
+  play_prefetch (0, &hits, &misses);
+  fail_unless_equals_int (hits, 0);
+  fail_unless_equals_int (misses, 0);
+
+  /* The first file can't be prefetched, the following ones start in the
+   * lookahead window of the previous stack */
+  play_prefetch (GST_SECOND, &hits, &misses);
+  fail_unless_equals_int (hits + misses, 3);
+  fail_unless (misses >= 1);
+#ifdef __linux__
+  /* posix_fadvise() is available */
+  fail_unless_equals_int (hits, 2);
+#endif
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stable_caps)
+{
+  GstElement *pipeline;
+  GstElement *comp, *source1, *source2, *sink;
+  GstPad *sinkpad;
+  GList *caps = NULL;
+  GstBus *bus;
+  GstMessage *message;
+  gboolean carry_on = TRUE;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 1s[
+     source2 [1s -- 2s[
+     Same format, different caps
+   */
+  source1 = videotest_gnl_src ("source1", 0, 1 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 1 * GST_SECOND, 2,
+      1);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, NULL);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (stable_caps_buffer_probe),
+      &caps);
+  gst_object_unref (sinkpad);
+
+  bus = gst_element_get_bus (GST_ELEMENT (pipeline));
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  while (carry_on) {
+    message = gst_bus_poll (bus, GST_MESSAGE_ANY, GST_SECOND / 2);
+    if (message) {
+      switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_EOS:
+          carry_on = FALSE;
+          break;
+        case GST_MESSAGE_ERROR:
+          GST_WARNING ("Saw an ERROR");
+          fail_if (TRUE);
+        default:
+          break;
+      }
+      gst_mini_object_unref (GST_MINI_OBJECT (message));
+    }
+  }
+
+  /* Both stacks output their buffers with the same caps */
+  fail_unless_equals_int (g_list_length (caps), 1);
+  g_list_free (caps);
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+  gst_object_unref (bus);
+}
+
+GST_END_TEST;
+
+/* Memory source outputting [0s -- 3s[ of encoded data with @caps, one
+ * buffer every 100ms and a keyframe every second */
+static GstElement *
+encoded_gnl_src (const gchar * name, guint64 start, guint64 mstart,
+    const gchar * caps)
+{
+  GstElement *gnlsource;
+  GValueArray *buffers;
+  GstBuffer *buffer;
+  GstCaps *bcaps;
+  GValue val = { 0, };
+  guint i;
+
+  gnlsource = gst_element_factory_make_or_warn ("gnlmemorysource", name);
+  g_object_set (gnlsource, "start", start, "duration", GST_SECOND,
+      "media-start", mstart, "media-duration", GST_SECOND, "priority", 1,
+      NULL);
+
+  bcaps = gst_caps_from_string (caps);
+  buffers = g_value_array_new (30);
+  g_value_init (&val, GST_TYPE_BUFFER);
+  for (i = 0; i < 30; i++) {
+    buffer = gst_buffer_new_and_alloc (16);
+    gst_buffer_set_caps (buffer, bcaps);
+    GST_BUFFER_TIMESTAMP (buffer) = i * 100 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 100 * GST_MSECOND;
+    if (i % 10)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    gst_value_take_mini_object (&val, (GstMiniObject *) buffer);
+    g_value_array_append (buffers, &val);
+  }
+  g_value_unset (&val);
+  gst_caps_unref (bcaps);
+
+  g_object_set (gnlsource, "buffers", buffers, NULL);
+  g_value_array_free (buffers);
+
+  return gnlsource;
+}
+
+GST_START_TEST (test_stable_caps_shared)
+{
+  GstElement *pipeline, *comp, *source1, *source2, *sink;
+  GstPad *sinkpad;
+  GList *caps = NULL;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 1s[
+     source2 [1s -- 2s[
+     Same format, different caps, and the buffers are shared with the
+     sources so their caps can't be changed in place
+   */
+  source1 = encoded_gnl_src ("source1", 0, 0, "video/x-h264,width=320");
+  source2 = encoded_gnl_src ("source2", GST_SECOND, 0,
+      "video/x-h264,width=320");
+  gst_bin_add_many (GST_BIN (comp), source1, source2, NULL);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (stable_caps_buffer_probe),
+      &caps);
+  gst_object_unref (sinkpad);
+
+  play_to_eos (pipeline);
+
+  fail_unless_equals_int (g_list_length (caps), 1);
+  g_list_free (caps);
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_smart_render)
+{
+  GstElement *pipeline, *comp, *sink;
+  GstBus *bus;
+  GstMessage *message;
+  const GstStructure *structure;
+  gboolean passthrough, carry_on = TRUE;
+  /* expected passthrough of each stack */
+  gboolean expected[] = { TRUE, FALSE, TRUE, FALSE };
+  guint nb = 0;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "smart-render", TRUE, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 1s[ from 0s, inpoint on a keyframe
+     source2 [1s -- 2s[ from 0.5s, inpoint on a delta unit
+     source3 [2s -- 3s[ from 1s, inpoint on a keyframe
+     source4 [3s -- 4s[ from 1s, inpoint on a keyframe of decoded subtitles
+   */
+  gst_bin_add_many (GST_BIN (comp),
+      encoded_gnl_src ("source1", 0, 0, "video/x-h264"),
+      encoded_gnl_src ("source2", 1 * GST_SECOND, 500 * GST_MSECOND,
+          "video/x-h264"),
+      encoded_gnl_src ("source3", 2 * GST_SECOND, 1 * GST_SECOND,
+          "video/x-h264"),
+      encoded_gnl_src ("source4", 3 * GST_SECOND, 1 * GST_SECOND,
+          "video/x-dvd-subpicture"), NULL);
+
+  bus = gst_element_get_bus (GST_ELEMENT (pipeline));
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  while (carry_on) {
+    message = gst_bus_poll (bus, GST_MESSAGE_ANY, GST_SECOND / 2);
+    if (message) {
+      switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ELEMENT:
+          structure = gst_message_get_structure (message);
+          if (gst_structure_has_name (structure, "gnl-smart-render")) {
+            fail_unless (nb < G_N_ELEMENTS (expected));
+            fail_unless (gst_structure_get_boolean (structure, "passthrough",
+                    &passthrough));
+            fail_unless_equals_int (passthrough, expected[nb]);
+            nb++;
+          }
+          break;
+        case GST_MESSAGE_EOS:
+          carry_on = FALSE;
+          break;
+        case GST_MESSAGE_ERROR:
+          GST_WARNING ("Saw an ERROR");
+          fail_if (TRUE);
+        default:
+          break;
+      }
+      gst_mini_object_unref (GST_MINI_OBJECT (message));
+    }
+  }
+
+  fail_unless_equals_int (nb, G_N_ELEMENTS (expected));
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+  gst_object_unref (bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_retention_window)
+{
+  guint64 start, stop;
+  gint64 duration;
+  GstElement *pipeline, *comp, *source1, *source2, *source3, *sink;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "retention-window", (guint64) 500 * GST_MSECOND, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 1s[
+     source2 [1s -- 2s[
+     source3 [2s -- 3s[
+   */
+  source1 = videotest_gnl_src ("source1", 0, 1 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 1 * GST_SECOND, 2,
+      1);
+  source3 = videotest_gnl_src ("source3", 2 * GST_SECOND, 1 * GST_SECOND, 3,
+      1);
+  gst_object_ref (source1);
+  gst_object_ref (source2);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, source3, NULL);
+
+  play_to_eos (pipeline);
+
+  /* When source3 started, source1 stopped more than 500ms before */
+  fail_unless (GST_OBJECT_PARENT (source1) == NULL);
+  fail_unless (GST_OBJECT_PARENT (source2) == (GstObject *) comp);
+
+  /* and the composition still starts at 0 */
+  check_start_stop_duration (comp, 0, 3 * GST_SECOND, 3 * GST_SECOND);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (source1);
+  gst_object_unref (source2);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static gboolean
+gap_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    guint * counts)
+{
+  /* GAP buffers must all be before the source, at 1s */
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_GAP)) {
+    fail_unless (GST_BUFFER_TIMESTAMP (buffer) < GST_SECOND);
+    counts[0]++;
+  } else {
+    fail_unless (GST_BUFFER_TIMESTAMP (buffer) >= GST_SECOND);
+    counts[1]++;
+  }
+  return TRUE;
+}
+
+GST_START_TEST (test_gap_buffer)
+{
+  GstElement *pipeline, *comp, *source1, *sink;
+  GstBuffer *gap, *zero, *current;
+  GstCaps *caps;
+  GstPad *sinkpad;
+  guint counts[2] = { 0, 0 };
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  caps = gst_caps_from_string ("video/x-raw-yuv,format=(fourcc)I420,"
+      "width=(int)16,height=(int)16,framerate=(fraction)25/1");
+
+  /* A template without duration would never advance, it's refused */
+  zero = gst_buffer_new_and_alloc (16 * 16 * 3 / 2);
+  gst_buffer_set_caps (zero, caps);
+  GST_BUFFER_DURATION (zero) = 0;
+  g_object_set (comp, "gap-buffer", zero, NULL);
+  g_object_get (comp, "gap-buffer", &current, NULL);
+  fail_unless (current == NULL);
+  gst_buffer_unref (zero);
+
+  gap = gst_buffer_new_and_alloc (16 * 16 * 3 / 2);
+  gst_buffer_set_caps (gap, caps);
+  GST_BUFFER_DURATION (gap) = 40 * GST_MSECOND;
+  g_object_set (comp, "gap-buffer", gap, NULL);
+  gst_buffer_unref (gap);
+  gst_caps_unref (caps);
+
+  /*
+     gap     [0s -- 1s[
+     source1 [1s -- 2s[
+   */
+  source1 = videotest_gnl_src ("source1", 1 * GST_SECOND, 1 * GST_SECOND, 1,
+      1);
+  gst_bin_add (GST_BIN (comp), source1);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (gap_buffer_probe), counts);
+  gst_object_unref (sinkpad);
+
+  play_to_eos (pipeline);
+
+  /* 25 frames of gap, then the source */
+  fail_unless_equals_int (counts[0], 25);
+  fail_unless (counts[1] > 0);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_master_boundaries)
+{
+  GstElement *pipeline, *master, *comp, *sink;
+  GstElement *msource1, *msource2, *source1;
+  CollectStructure *collect;
+  GstPad *sinkpad;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+
+  /*
+     master
+     msource1 [0s -- 1s[
+     msource2 [1s -- 2s[
+   */
+  master = gst_element_factory_make_or_warn ("gnlcomposition", "master");
+  msource1 = videotest_gnl_src ("msource1", 0, 1 * GST_SECOND, 1, 1);
+  msource2 = videotest_gnl_src ("msource2", 1 * GST_SECOND, 1 * GST_SECOND,
+      2, 1);
+  gst_bin_add_many (GST_BIN (master), msource1, msource2, NULL);
+
+  /*
+     comp, following master
+     source1 [0s -- 2s[
+   */
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 3, 1);
+  gst_bin_add (GST_BIN (comp), source1);
+  g_object_set (comp, "master", master, NULL);
+
+  /* The master is edited after being followed, its boundary moves to
+   * 500ms */
+  g_object_set (msource1, "duration", (gint64) 500 * GST_MSECOND, NULL);
+  g_object_set (msource2, "start", (guint64) 500 * GST_MSECOND,
+      "duration", (gint64) 1500 * GST_MSECOND, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  collect = g_new0 (CollectStructure, 1);
+  collect->comp = comp;
+  collect->sink = sink;
+
+  /* comp switches stacks where master does */
+  collect->expected_segments = g_list_append (collect->expected_segments,
+      segment_new (1.0, GST_FORMAT_TIME, 0, 500 * GST_MSECOND, 0));
+  collect->expected_segments = g_list_append (collect->expected_segments,
+      segment_new (1.0, GST_FORMAT_TIME, 500 * GST_MSECOND, 2 * GST_SECOND,
+          500 * GST_MSECOND));
+
+  g_signal_connect (G_OBJECT (comp), "pad-added",
+      G_CALLBACK (composition_pad_added_cb), collect);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_event_probe (sinkpad, G_CALLBACK (sinkpad_event_probe), collect);
+  gst_object_unref (sinkpad);
+
+  play_to_eos (pipeline);
+
+  fail_unless (collect->expected_segments == NULL);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+  gst_object_unref (master);
+  g_free (collect);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  gboolean seeked;
+  gboolean got_segment;
+  gint64 start;
+  gint64 position;
+  GstClockTime first_timestamp;
+} NestedSeekData;
+
+static gboolean
+nested_seek_event_probe (GstPad * pad G_GNUC_UNUSED, GstEvent * event,
+    NestedSeekData * data)
+{
+  gboolean update;
+  gdouble rate;
+  GstFormat format;
+  gint64 stop;
+
+  if (data->seeked && !data->got_segment
+      && GST_EVENT_TYPE (event) == GST_EVENT_NEWSEGMENT) {
+    gst_event_parse_new_segment (event, &update, &rate, &format,
+        &data->start, &stop, &data->position);
+    data->got_segment = !update;
+  }
+  return TRUE;
+}
+
+static gboolean
+nested_seek_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    NestedSeekData * data)
+{
+  if (data->got_segment && !GST_CLOCK_TIME_IS_VALID (data->first_timestamp))
+    data->first_timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  return TRUE;
+}
+
+GST_START_TEST (test_nested_seek)
+{
+  GstElement *pipeline, *comp, *inner, *source0, *source1, *sink;
+  NestedSeekData data = { FALSE, FALSE, -1, -1, GST_CLOCK_TIME_NONE };
+  GstPad *sinkpad;
+  guint64 start, stop;
+  gint64 duration;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     inner
+     source1 [1s -- 2s[
+   */
+  inner = gst_element_factory_make_or_warn ("gnlcomposition", "inner");
+  source1 = videotest_gnl_src ("source1", 1 * GST_SECOND, 1 * GST_SECOND, 2,
+      1);
+  gst_bin_add (GST_BIN (inner), source1);
+
+  /* The inner composition only gets its timing from its children */
+  check_start_stop_duration (inner, 1 * GST_SECOND, 2 * GST_SECOND,
+      1 * GST_SECOND);
+
+  /*
+     comp
+     source0 [0s -- 1s[
+     inner   [1s -- 2s[
+   */
+  source0 = videotest_gnl_src ("source0", 0, 1 * GST_SECOND, 1, 1);
+  g_object_set (inner, "priority", 2, NULL);
+  gst_bin_add_many (GST_BIN (comp), source0, inner, NULL);
+  check_start_stop_duration (comp, 0, 2 * GST_SECOND, 2 * GST_SECOND);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_event_probe (sinkpad, G_CALLBACK (nested_seek_event_probe),
+      &data);
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (nested_seek_buffer_probe),
+      &data);
+  gst_object_unref (sinkpad);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  /* Seek in the middle of the nested composition */
+  data.seeked = TRUE;
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+          1500 * GST_MSECOND));
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  play_to_eos (pipeline);
+
+  fail_unless (data.got_segment);
+  fail_unless_equals_int64 (data.start, 1500 * GST_MSECOND);
+  fail_unless_equals_int64 (data.position, 1500 * GST_MSECOND);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (data.first_timestamp));
+  fail_unless (data.first_timestamp >= 1500 * GST_MSECOND);
+  fail_unless (data.first_timestamp < 2 * GST_SECOND);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  gboolean seeked;
+  GstClockTime last;
+  guint counts[2];
+} ReverseData;
+
+static gboolean
+reverse_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    ReverseData * data)
+{
+  if (!data->seeked)
+    return TRUE;
+
+  /* Buffers come backwards */
+  if (GST_CLOCK_TIME_IS_VALID (data->last))
+    fail_unless (GST_BUFFER_TIMESTAMP (buffer) < data->last);
+  data->last = GST_BUFFER_TIMESTAMP (buffer);
+
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_GAP))
+    data->counts[0]++;
+  else
+    data->counts[1]++;
+  return TRUE;
+}
+
+/* Plays @comp (linked to @sink in @pipeline) backwards from @stop */
+static void
+play_backwards (GstElement * pipeline, GstElement * comp, GstElement * sink,
+    GstClockTime stop, ReverseData * data)
+{
+  GstPad *sinkpad;
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (reverse_buffer_probe), data);
+  gst_object_unref (sinkpad);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  data->seeked = TRUE;
+  fail_unless (gst_element_seek (pipeline, -1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET, 0,
+          GST_SEEK_TYPE_SET, stop));
+
+  play_to_eos (pipeline);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+}
+
+GST_START_TEST (test_reverse_gap)
+{
+  GstElement *pipeline, *comp, *source1, *sink;
+  ReverseData data = { FALSE, GST_CLOCK_TIME_NONE, {0, 0} };
+  GValueArray *buffers;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GValue val = { 0, };
+  guint i;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  caps = gst_caps_from_string ("video/x-raw-yuv,format=(fourcc)I420,"
+      "width=(int)16,height=(int)16,framerate=(fraction)25/1");
+
+  buffer = gst_buffer_new_and_alloc (16 * 16 * 3 / 2);
+  gst_buffer_set_caps (buffer, caps);
+  GST_BUFFER_DURATION (buffer) = 40 * GST_MSECOND;
+  g_object_set (comp, "gap-buffer", buffer, NULL);
+  gst_buffer_unref (buffer);
+
+  /*
+     gap     [0s -- 1s[
+     source1 [1s -- 2s[, 25 buffers
+   */
+  source1 =
+      gst_element_factory_make_or_warn ("gnlmemorysource", "source1");
+  g_object_set (source1, "start", (guint64) GST_SECOND,
+      "duration", (gint64) GST_SECOND, "media-start", (guint64) GST_SECOND,
+      "media-duration", (gint64) GST_SECOND, "priority", 1, NULL);
+
+  buffers = g_value_array_new (25);
+  g_value_init (&val, GST_TYPE_BUFFER);
+  for (i = 0; i < 25; i++) {
+    buffer = gst_buffer_new_and_alloc (16 * 16 * 3 / 2);
+    gst_buffer_set_caps (buffer, caps);
+    GST_BUFFER_TIMESTAMP (buffer) = GST_SECOND + i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 40 * GST_MSECOND;
+    gst_value_take_mini_object (&val, (GstMiniObject *) buffer);
+    g_value_array_append (buffers, &val);
+  }
+  g_value_unset (&val);
+  gst_caps_unref (caps);
+
+  g_object_set (source1, "buffers", buffers, NULL);
+  g_value_array_free (buffers);
+  gst_bin_add (GST_BIN (comp), source1);
+
+  play_backwards (pipeline, comp, sink, 2 * GST_SECOND, &data);
+
+  /* source1 then the 25 frames of the gap, ending with the first one */
+  fail_unless_equals_int (data.counts[1], 25);
+  fail_unless_equals_int (data.counts[0], 25);
+  fail_unless_equals_uint64 (data.last, 0);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reverse_still)
+{
+  GstElement *pipeline, *comp, *still, *sink;
+  ReverseData data = { FALSE, GST_CLOCK_TIME_NONE, {0, 0} };
+  gchar *location;
+
+  location = make_still_image ("gnl-reverse-still.png");
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  /*
+     still [0s -- 1s[, 25fps
+   */
+  still = gst_element_factory_make_or_warn ("gnlstillsource", "still");
+  g_object_set (still, "location", location, "start", (guint64) 0,
+      "duration", (gint64) GST_SECOND, "media-start", (guint64) 0,
+      "media-duration", (gint64) GST_SECOND, "framerate", 25, 1, NULL);
+  gst_bin_add (GST_BIN (comp), still);
+
+  play_backwards (pipeline, comp, sink, GST_SECOND, &data);
+
+  /* The 25 frames, from the last one at 960ms */
+  fail_unless_equals_int (data.counts[1], 25);
+  fail_unless_equals_uint64 (data.last, 0);
+
+  gst_object_unref (pipeline);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* Plays @pipeline to the end and back to NULL, returns the cache hits and
+ * misses of @comp */
+static void
+play_cached (GstElement * pipeline, GstElement * comp, guint * hits,
+    guint * misses)
+{
+  play_to_eos (pipeline);
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  g_object_get (comp, "cache-hits", hits, "cache-misses", misses, NULL);
+}
+
+GST_START_TEST (test_cache_media_change)
+{
+  GstElement *pipeline, *comp, *source1, *sink;
+  guint hits, misses, hits2, misses2;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "cache-budget", (guint64) 64 * 1024 * 1024, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 1s[, media [0s -- 1s[
+   */
+  source1 = videotest_gnl_src ("source1", 0, 1 * GST_SECOND, 1, 1);
+  g_object_set (source1, "cache-key", "videotest", NULL);
+  gst_bin_add (GST_BIN (comp), source1);
+
+  /* Decoded and recorded */
+  play_cached (pipeline, comp, &hits, &misses);
+  fail_unless_equals_int (hits, 0);
+  fail_unless (misses > 0);
+
+  /* Same media range, output from the cache */
+  play_cached (pipeline, comp, &hits2, &misses2);
+  fail_unless (hits2 > hits);
+  fail_unless_equals_int (misses2, misses);
+
+  /* media [500ms -- 1s[, still within what was recorded */
+  g_object_set (source1, "media-start", (guint64) 500 * GST_MSECOND,
+      "media-duration", (gint64) 500 * GST_MSECOND,
+      "duration", (gint64) 500 * GST_MSECOND, NULL);
+  play_cached (pipeline, comp, &hits, &misses);
+  fail_unless (hits > hits2);
+  fail_unless_equals_int (misses, misses2);
+
+  /* media [500ms -- 1.5s[, not recorded entirely, decoded again */
+  g_object_set (source1, "media-duration", (gint64) GST_SECOND,
+      "duration", (gint64) GST_SECOND, NULL);
+  play_cached (pipeline, comp, &hits2, &misses2);
+  fail_unless_equals_int (hits2, hits);
+  fail_unless (misses2 > misses);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_step_boundary)
+{
+  GstElement *pipeline, *comp, *source1, *source2, *sink;
+  NestedSeekData data = { FALSE, FALSE, -1, -1, GST_CLOCK_TIME_NONE };
+  GstMessage *message;
+  GstPad *sinkpad;
+  GstBus *bus;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+
+  /*
+     source1 [0s -- 1s[
+     source2 [1s -- 2s[
+   */
+  source1 = videotest_gnl_src ("source1", 0, 1 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 1 * GST_SECOND, 1 * GST_SECOND, 2,
+      1);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, NULL);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_event_probe (sinkpad, G_CALLBACK (nested_seek_event_probe),
+      &data);
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (nested_seek_buffer_probe),
+      &data);
+  gst_object_unref (sinkpad);
+
+  bus = gst_element_get_bus (pipeline);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  /* A step from 0s to 1.5s ends in source2, it seeks there directly */
+  data.seeked = TRUE;
+  fail_unless (gst_element_send_event (comp,
+          gst_event_new_step (GST_FORMAT_TIME, 1500 * GST_MSECOND, 1.0, TRUE,
+              FALSE)));
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  fail_unless (data.got_segment);
+  fail_unless_equals_int64 (data.start, 1500 * GST_MSECOND);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (data.first_timestamp));
+  fail_unless (data.first_timestamp >= 1500 * GST_MSECOND);
+  fail_unless (data.first_timestamp < 2 * GST_SECOND);
+
+  /* A step within source2 is performed by the sink */
+  fail_unless (gst_element_send_event (comp,
+          gst_event_new_step (GST_FORMAT_BUFFERS, 2, 1.0, TRUE, FALSE)));
+  message = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND,
+      GST_MESSAGE_STEP_DONE | GST_MESSAGE_ERROR);
+  fail_unless (message != NULL);
+  fail_unless (GST_MESSAGE_TYPE (message) == GST_MESSAGE_STEP_DONE);
+  fail_unless (GST_MESSAGE_SRC (message) == GST_OBJECT (sink));
+  gst_message_unref (message);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+/* Top object of the schedule entry containing @position */
+static GObject *
+top_object_at (GstElement * comp, GstClockTime position)
+{
+  GValueArray *schedule;
+  const GstStructure *entry;
+  GObject *ret = NULL;
+  guint i;
+
+  g_signal_emit_by_name (comp, "get-schedule", &schedule);
+  for (i = 0; i < schedule->n_values; i++) {
+    entry = gst_value_get_structure (&schedule->values[i]);
+    if (g_value_get_uint64 (gst_structure_get_value (entry, "stop")) >
+        position) {
+      ret = schedule_top_object (&schedule->values[i]);
+      break;
+    }
+  }
+  g_value_array_free (schedule);
+
+  return ret;
+}
+
+static void
+send_qos_events (GstElement * comp, GstClockTimeDiff diff, guint n)
+{
+  GstPad *srcpad = gst_element_get_static_pad (comp, "src");
+
+  fail_unless (srcpad != NULL);
+  while (n--)
+    gst_pad_send_event (srcpad, gst_event_new_qos (1.0, diff, 0));
+  gst_object_unref (srcpad);
+}
+
+GST_START_TEST (test_degrade)
+{
+  GstElement *pipeline, *comp, *source1, *source2, *source3, *sink;
+  gboolean degraded, proxy;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  g_object_set (comp, "degrade", TRUE, NULL);
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_object_connect (comp, "signal::pad-added",
+      on_composition_pad_added_cb, sink, NULL);
+
+  /*
+     source1 [0s -- 2s[ priority 1
+     source2 [500ms -- 1500ms[ priority 0, optional
+     source3 [2s -- 3s[ priority 1, file source with a proxy
+   */
+  source1 = videotest_gnl_src ("source1", 0, 2 * GST_SECOND, 1, 1);
+  source2 = videotest_gnl_src ("source2", 500 * GST_MSECOND, GST_SECOND, 2,
+      0);
+  g_object_set (source2, "optional", TRUE, NULL);
+  source3 = gst_element_factory_make_or_warn ("gnlfilesource", "source3");
+  g_object_set (source3, "start", (guint64) 2 * GST_SECOND, "duration",
+      (gint64) GST_SECOND, "media-start", (guint64) 0, "media-duration",
+      (gint64) GST_SECOND, "priority", 1, "location", "/tmp/original.ogg",
+      "proxy-location", "/tmp/proxy.ogg", NULL);
+  gst_bin_add_many (GST_BIN (comp), source1, source2, source3, NULL);
+
+  fail_unless (top_object_at (comp, GST_SECOND) == (GObject *) source2);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+
+  /* Persistently late, source2 is left out and source3 uses its proxy */
+  send_qos_events (comp, GST_SECOND, 10);
+  g_object_get (comp, "degraded", &degraded, NULL);
+  fail_unless (degraded);
+  g_object_get (source3, "use-proxy", &proxy, NULL);
+  fail_unless (proxy);
+  fail_unless (top_object_at (comp, GST_SECOND) == (GObject *) source1);
+
+  /* source2 isn't optional anymore, the cached schedule is updated */
+  g_object_set (source2, "optional", FALSE, NULL);
+  fail_unless (top_object_at (comp, GST_SECOND) == (GObject *) source2);
+  g_object_set (source2, "optional", TRUE, NULL);
+  fail_unless (top_object_at (comp, GST_SECOND) == (GObject *) source1);
+
+  /* Caught up */
+  send_qos_events (comp, -GST_SECOND, 100);
+  g_object_get (comp, "degraded", &degraded, NULL);
+  fail_unless (!degraded);
+  g_object_get (source3, "use-proxy", &proxy, NULL);
+  fail_unless (!proxy);
+  fail_unless (top_object_at (comp, GST_SECOND) == (GObject *) source2);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 Suite *
 gnonlin_suite (void)
 {
@@ -222,6 +1801,28 @@ gnonlin_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_change_object_start_stop_in_current_stack);
+  tcase_add_test (tc_chain, test_clone);
+  tcase_add_test (tc_chain, test_clone_settings);
+  tcase_add_test (tc_chain, test_clone_unfactored);
+  tcase_add_test (tc_chain, test_query_range);
+  tcase_add_test (tc_chain, test_schedule);
+  tcase_add_test (tc_chain, test_opaque);
+  tcase_add_test (tc_chain, test_partitions);
+  tcase_add_test (tc_chain, test_extract_frames);
+  tcase_add_test (tc_chain, test_render_mode);
+  tcase_add_test (tc_chain, test_prefetch);
+  tcase_add_test (tc_chain, test_stable_caps);
+  tcase_add_test (tc_chain, test_stable_caps_shared);
+  tcase_add_test (tc_chain, test_smart_render);
+  tcase_add_test (tc_chain, test_retention_window);
+  tcase_add_test (tc_chain, test_gap_buffer);
+  tcase_add_test (tc_chain, test_master_boundaries);
+  tcase_add_test (tc_chain, test_nested_seek);
+  tcase_add_test (tc_chain, test_reverse_gap);
+  tcase_add_test (tc_chain, test_reverse_still);
+  tcase_add_test (tc_chain, test_cache_media_change);
+  tcase_add_test (tc_chain, test_step_boundary);
+  tcase_add_test (tc_chain, test_degrade);
 
   return s;
 }
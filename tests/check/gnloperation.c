@@ -876,6 +876,140 @@ GST_START_TEST (test_complex_operations)
 
 GST_END_TEST;
 
+static void
+on_pad_added_link (GstElement * comp, GstPad * pad G_GNUC_UNUSED,
+    GstElement * sink)
+{
+  fail_unless (gst_element_link (comp, sink));
+}
+
+typedef struct
+{
+  GstPadQueryFunction query;    /* original query function */
+  GstClockTime latency;         /* latency of the element itself */
+  GstElement *operation;        /* forward to the input of @operation */
+  const gchar *input;           /* coming from the object named @input */
+} LatencyData;
+
+/* Answers latency queries like an element with some latency of its own,
+ * forwarding them to one of its inputs */
+static gboolean
+latency_query_function (GstPad * pad, GstQuery * query)
+{
+  LatencyData *data = g_object_get_data ((GObject *) pad, "latency-data");
+  GstPad *peer, *target;
+  GList *tmp;
+  gboolean res = FALSE, live;
+  GstClockTime min, max;
+
+  if ((GST_QUERY_TYPE (query) != GST_QUERY_LATENCY) || !data->operation)
+    res = data->query (pad, query);
+  else {
+    GST_OBJECT_LOCK (data->operation);
+    for (tmp = data->operation->sinkpads; tmp && !res; tmp = tmp->next) {
+      if (!(peer = gst_pad_get_peer ((GstPad *) tmp->data)))
+        continue;
+      if (g_str_equal (GST_OBJECT_NAME (GST_OBJECT_PARENT (peer)),
+              data->input)) {
+        target = gst_ghost_pad_get_target ((GstGhostPad *) tmp->data);
+        res = gst_pad_peer_query (target, query);
+        gst_object_unref (target);
+      }
+      gst_object_unref (peer);
+    }
+    GST_OBJECT_UNLOCK (data->operation);
+  }
+
+  if (res && (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY)) {
+    gst_query_parse_latency (query, &live, &min, &max);
+    gst_query_set_latency (query, TRUE, min + data->latency, max);
+  }
+
+  return res;
+}
+
+static void
+add_latency (GstElement * element, GstClockTime latency,
+    GstElement * operation, const gchar * input)
+{
+  GstPad *pad = gst_element_get_static_pad (element, "src");
+  LatencyData *data = g_new0 (LatencyData, 1);
+
+  data->query = GST_PAD_QUERYFUNC (pad);
+  data->latency = latency;
+  data->operation = operation;
+  data->input = input;
+  g_object_set_data_full ((GObject *) pad, "latency-data", data, g_free);
+  gst_pad_set_query_function (pad, latency_query_function);
+  gst_object_unref (pad);
+}
+
+GST_START_TEST (test_latency_nested_operation)
+{
+  GstElement *pipeline, *comp, *outer, *inner, *source1, *source2, *sink;
+  GstPad *srcpad;
+  GstQuery *query;
+  gboolean live;
+  GstClockTime min, max;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  g_signal_connect (comp, "pad-added", G_CALLBACK (on_pad_added_link), sink);
+
+  /*
+     outer (videomixer, 15ms of its own, forwards to source2's input)
+     Priority : 0
+       inner (identity, 30ms of its own)
+       Priority : 1
+         source1 (20ms)
+         Priority : 2
+       source2 (10ms)
+       Priority : 3
+   */
+  source1 = videotest_in_bin_gnl_src ("source1", 0, GST_SECOND, 1, 2);
+  fail_if (source1 == NULL);
+  source2 = videotest_in_bin_gnl_src ("source2", 0, GST_SECOND, 2, 3);
+  fail_if (source2 == NULL);
+  inner = new_operation ("inner", "identity", 0, GST_SECOND, 1);
+  outer = new_operation ("outer", "videomixer", 0, GST_SECOND, 0);
+
+  add_latency (GST_BIN_CHILDREN (source1)->data, 20 * GST_MSECOND, NULL,
+      NULL);
+  add_latency (GST_BIN_CHILDREN (source2)->data, 10 * GST_MSECOND, NULL,
+      NULL);
+  add_latency (GST_BIN_CHILDREN (inner)->data, 30 * GST_MSECOND, inner,
+      "source1");
+  add_latency (GST_BIN_CHILDREN (outer)->data, 15 * GST_MSECOND, outer,
+      "source2");
+
+  gst_bin_add_many (GST_BIN (comp), source1, source2, inner, outer, NULL);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  /* inner : 20ms + 30ms. outer : the slowest of inner and source2 + 15ms */
+  srcpad = gst_element_get_static_pad (comp, "src");
+  query = gst_query_new_latency ();
+  fail_unless (gst_pad_query (srcpad, query));
+  gst_query_parse_latency (query, &live, &min, &max);
+  fail_unless (live);
+  fail_unless_equals_uint64 (min, 65 * GST_MSECOND);
+  gst_query_unref (query);
+  gst_object_unref (srcpad);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 Suite *
 gnonlin_suite (void)
 {
@@ -889,6 +1023,7 @@ gnonlin_suite (void)
   tcase_add_test (tc_chain, test_pyramid_operations);
   tcase_add_test (tc_chain, test_pyramid_operations2);
   tcase_add_test (tc_chain, test_complex_operations);
+  tcase_add_test (tc_chain, test_latency_nested_operation);
 
   return s;
 }
@@ -205,6 +205,541 @@ GST_START_TEST (test_videotestsrc_in_bin)
 
 GST_END_TEST;
 
+static gboolean
+memory_buffer_probe (GstPad * pad, GstBuffer * buffer, GList ** timestamps)
+{
+  *timestamps = g_list_append (*timestamps,
+      g_memdup (&GST_BUFFER_TIMESTAMP (buffer), sizeof (GstClockTime)));
+  return TRUE;
+}
+
+GST_START_TEST (test_memory_source)
+{
+  GstElement *pipeline;
+  GstElement *gnlsource, *sink;
+  CollectStructure *collect;
+  GValueArray *array;
+  GValue val = { 0, };
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GList *timestamps = NULL, *tmp;
+  GstBus *bus;
+  GstMessage *message;
+  gboolean carry_on = TRUE;
+  GstPad *sinkpad;
+  guint i;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+
+  /*
+     Memory source
+     Start : 0s
+     Duration : 500ms
+     Media-start : 250ms
+     Buffers : 10 x 100ms, from 0s
+   */
+  gnlsource =
+      gst_element_factory_make_or_warn ("gnlmemorysource", "memorysource");
+  g_object_set (G_OBJECT (gnlsource), "start", (guint64) 0,
+      "duration", (gint64) 500 * GST_MSECOND,
+      "media-start", (guint64) 250 * GST_MSECOND,
+      "media-duration", (gint64) 500 * GST_MSECOND, NULL);
+
+  caps = gst_caps_from_string ("video/x-raw-yuv,format=(fourcc)I420");
+  array = g_value_array_new (10);
+  g_value_init (&val, GST_TYPE_BUFFER);
+  for (i = 0; i < 10; i++) {
+    buffer = gst_buffer_new_and_alloc (16);
+    gst_buffer_set_caps (buffer, caps);
+    GST_BUFFER_TIMESTAMP (buffer) = i * 100 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 100 * GST_MSECOND;
+    gst_value_take_mini_object (&val, (GstMiniObject *) buffer);
+    g_value_array_append (array, &val);
+  }
+  g_value_unset (&val);
+  gst_caps_unref (caps);
+
+  g_object_set (G_OBJECT (gnlsource), "buffers", array, NULL);
+  g_value_array_free (array);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  fail_if (sink == NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), gnlsource, sink, NULL);
+
+  collect = g_new0 (CollectStructure, 1);
+  collect->comp = gnlsource;
+  collect->sink = sink;
+
+  g_signal_connect (G_OBJECT (gnlsource), "pad-added",
+      G_CALLBACK (composition_pad_added_cb), collect);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  fail_if (sinkpad == NULL);
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (memory_buffer_probe),
+      &timestamps);
+
+  bus = gst_element_get_bus (pipeline);
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  while (carry_on) {
+    message = gst_bus_poll (bus, GST_MESSAGE_ANY, GST_SECOND / 2);
+    if (message) {
+      switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_EOS:
+          carry_on = FALSE;
+          break;
+        case GST_MESSAGE_ERROR:
+          GST_WARNING ("Saw an ERROR");
+          fail_if (TRUE);
+        default:
+          break;
+      }
+      gst_mini_object_unref (GST_MINI_OBJECT (message));
+    }
+  }
+
+  fail_if (gst_element_set_state (GST_ELEMENT (pipeline),
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  /* The buffers overlapping [250ms, 750ms[ were pushed as they are */
+  fail_unless_equals_int (g_list_length (timestamps), 6);
+  for (tmp = timestamps, i = 2; tmp; tmp = tmp->next, i++) {
+    fail_unless (*((GstClockTime *) tmp->data) == i * 100 * GST_MSECOND);
+    g_free (tmp->data);
+  }
+  g_list_free (timestamps);
+
+  gst_object_unref (sinkpad);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+  g_free (collect);
+}
+
+GST_END_TEST;
+
+static void
+check_internal_source (GstElement * gnlsource, gboolean mmapped,
+    const gchar * location)
+{
+  GstElement *filesrc;
+  gboolean use_mmap = FALSE;
+  gchar *loc;
+
+  filesrc = gst_bin_get_by_name (GST_BIN (gnlsource), "internal-filesource");
+  fail_if (filesrc == NULL);
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (filesrc), "use-mmap"))
+    g_object_get (filesrc, "use-mmap", &use_mmap, NULL);
+  fail_unless (use_mmap == mmapped);
+
+  g_object_get (filesrc, "location", &loc, NULL);
+  fail_unless_equals_string (loc, location);
+  g_free (loc);
+
+  gst_object_unref (filesrc);
+}
+
+GST_START_TEST (test_mmap_location)
+{
+  GstElement *gnlsource, *filesrc;
+
+  /* Only check if filesrc can mmap */
+  filesrc = gst_element_factory_make ("filesrc", NULL);
+  if (!filesrc)
+    return;
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (filesrc), "use-mmap")) {
+    gst_object_unref (filesrc);
+    return;
+  }
+  gst_object_unref (filesrc);
+
+  gnlsource = gst_element_factory_make_or_warn ("gnlfilesource", "source");
+  g_object_set (G_OBJECT (gnlsource), "use-mmap", TRUE,
+      "location", "file:///tmp/gnl-mmap-test.ogg", NULL);
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  /* local uris are read through mmap, as paths */
+  check_internal_source (gnlsource, TRUE, "/tmp/gnl-mmap-test.ogg");
+
+  /* other uris still go to gnomevfssrc */
+  g_object_set (G_OBJECT (gnlsource), "location",
+      "http://localhost/gnl-mmap-test.ogg", NULL);
+  check_internal_source (gnlsource, FALSE,
+      "http://localhost/gnl-mmap-test.ogg");
+
+  /* and back */
+  g_object_set (G_OBJECT (gnlsource), "location", "/tmp/gnl-mmap-test.ogg",
+      NULL);
+  check_internal_source (gnlsource, TRUE, "/tmp/gnl-mmap-test.ogg");
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (gnlsource);
+}
+
+GST_END_TEST;
+
+/* Plays @pipeline until EOS or an error, returns the type of the last
+ * message */
+static GstMessageType
+play_to_end (GstElement * pipeline)
+{
+  GstBus *bus;
+  GstMessage *message;
+  GstMessageType type;
+
+  bus = gst_element_get_bus (pipeline);
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  type = GST_MESSAGE_TYPE (message);
+  gst_message_unref (message);
+  gst_object_unref (bus);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+
+  return type;
+}
+
+static gboolean
+still_buffer_probe (GstPad * pad G_GNUC_UNUSED, GstBuffer * buffer,
+    GList ** datas)
+{
+  *datas = g_list_append (*datas, GST_BUFFER_DATA (buffer));
+  return TRUE;
+}
+
+static GstElement *
+still_gnl_src (const gchar * name, const gchar * location, guint64 start)
+{
+  GstElement *still;
+
+  still = gst_element_factory_make_or_warn ("gnlstillsource", name);
+  g_object_set (still, "location", location, "start", start,
+      "duration", (gint64) GST_SECOND, "media-start", (guint64) 0,
+      "media-duration", (gint64) GST_SECOND, "priority", 1,
+      "framerate", 25, 1, NULL);
+
+  return still;
+}
+
+GST_START_TEST (test_cache_key)
+{
+  GstElement *gnlsource;
+  gchar *location, *key1, *key2;
+
+  location = g_build_filename (g_get_tmp_dir (), "gnl-cache-key-test.ogg",
+      NULL);
+  fail_unless (g_file_set_contents (location, "abc", -1, NULL));
+
+  gnlsource = gst_element_factory_make_or_warn ("gnlfilesource", "source");
+  g_object_set (G_OBJECT (gnlsource), "location", location, NULL);
+  g_object_get (G_OBJECT (gnlsource), "cache-key", &key1, NULL);
+  fail_unless (key1 != NULL);
+
+  /* the file is rewritten in place, its decoded buffers can't be used */
+  fail_unless (g_file_set_contents (location, "abcdef", -1, NULL));
+  g_object_set (G_OBJECT (gnlsource), "location", location, NULL);
+  g_object_get (G_OBJECT (gnlsource), "cache-key", &key2, NULL);
+  fail_unless (key2 != NULL);
+  fail_if (g_str_equal (key1, key2));
+  g_free (key1);
+  g_free (key2);
+
+  /* remote locations are only identified by their uri */
+  g_object_set (G_OBJECT (gnlsource), "location", "http://localhost/test.ogg",
+      NULL);
+  g_object_get (G_OBJECT (gnlsource), "cache-key", &key1, NULL);
+  fail_unless_equals_string (key1, "http://localhost/test.ogg");
+  g_free (key1);
+
+  gst_object_unref (gnlsource);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_still_source)
+{
+  GstElement *pipeline, *comp, *sink, *still;
+  CollectStructure *collect;
+  GList *datas = NULL, *tmp;
+  GstPad *sinkpad;
+  gchar *location, *stilllocation;
+  gint fps_n, fps_d;
+  guint i;
+
+  location = make_still_image ("gnl-still-test.png");
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  /*
+     still1 [0s -- 1s[
+     still2 [1s -- 2s[, same image
+   */
+  gst_bin_add_many (GST_BIN (comp),
+      still_gnl_src ("still1", location, 0),
+      still_gnl_src ("still2", location, GST_SECOND), NULL);
+
+  collect = g_new0 (CollectStructure, 1);
+  collect->comp = comp;
+  collect->sink = sink;
+  g_signal_connect (G_OBJECT (comp), "pad-added",
+      G_CALLBACK (composition_pad_added_cb), collect);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (still_buffer_probe), &datas);
+  gst_object_unref (sinkpad);
+
+  /* Played twice, the frame being released in between */
+  for (i = 0; i < 2; i++) {
+    fail_unless (play_to_end (pipeline) == GST_MESSAGE_EOS);
+
+    /* 25 frames per source, all sharing the data of the decoded image */
+    fail_unless_equals_int (g_list_length (datas), 50);
+    for (tmp = datas->next; tmp; tmp = tmp->next)
+      fail_unless (tmp->data == datas->data);
+    g_list_free (datas);
+    datas = NULL;
+  }
+
+  /* The image can't be changed while it is being output */
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE);
+  still = gst_bin_get_by_name (GST_BIN (comp), "still1");
+  g_object_set (still, "location", "/nonexistent.png", "framerate", 1, 1,
+      NULL);
+  g_object_get (still, "location", &stilllocation, "framerate", &fps_n,
+      &fps_d, NULL);
+  fail_unless_equals_string (stilllocation, location);
+  fail_unless_equals_int (fps_n, 25);
+  fail_unless_equals_int (fps_d, 1);
+  g_free (stilllocation);
+  gst_object_unref (still);
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  g_list_free (datas);
+
+  gst_object_unref (pipeline);
+  g_free (collect);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_still_source_error)
+{
+  GstElement *pipeline, *comp, *sink;
+  CollectStructure *collect;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+  comp =
+      gst_element_factory_make_or_warn ("gnlcomposition", "test_composition");
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+
+  gst_bin_add (GST_BIN (comp), still_gnl_src ("still",
+          "/nonexistent/gnl-still.png", 0));
+
+  collect = g_new0 (CollectStructure, 1);
+  collect->comp = comp;
+  collect->sink = sink;
+  g_signal_connect (G_OBJECT (comp), "pad-added",
+      G_CALLBACK (composition_pad_added_cb), collect);
+
+  /* The image isn't decoded during the state change, the failure is posted
+   * from the streaming thread */
+  fail_unless (play_to_end (pipeline) == GST_MESSAGE_ERROR);
+
+  gst_object_unref (pipeline);
+  g_free (collect);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+memory_pull_cb (GstElement * source G_GNUC_UNUSED, guint64 position,
+    GstCaps * caps)
+{
+  GstBuffer *buffer;
+
+  /* 100ms buffers up to 1s */
+  if (position >= GST_SECOND)
+    return NULL;
+
+  buffer = gst_buffer_new_and_alloc (16);
+  gst_buffer_set_caps (buffer, caps);
+  GST_BUFFER_TIMESTAMP (buffer) = position - position % (100 * GST_MSECOND);
+  GST_BUFFER_DURATION (buffer) = 100 * GST_MSECOND;
+
+  return buffer;
+}
+
+GST_START_TEST (test_memory_source_pull)
+{
+  GstElement *pipeline, *gnlsource, *sink;
+  CollectStructure *collect;
+  GSignalQuery query;
+  GList *timestamps = NULL, *tmp;
+  GstCaps *caps;
+  GstPad *sinkpad;
+  guint i;
+
+  pipeline = gst_pipeline_new ("test_pipeline");
+
+  /*
+     Memory source
+     Start : 0s
+     Duration : 500ms
+     Media-start : 250ms
+     Buffers : pulled, 100ms each
+   */
+  gnlsource =
+      gst_element_factory_make_or_warn ("gnlmemorysource", "memorysource");
+  g_object_set (G_OBJECT (gnlsource), "start", (guint64) 0,
+      "duration", (gint64) 500 * GST_MSECOND,
+      "media-start", (guint64) 250 * GST_MSECOND,
+      "media-duration", (gint64) 500 * GST_MSECOND, NULL);
+
+  /* The signal returns buffers, not pointers */
+  g_signal_query (g_signal_lookup ("pull", G_OBJECT_TYPE (gnlsource)),
+      &query);
+  fail_unless (query.return_type == GST_TYPE_BUFFER);
+
+  caps = gst_caps_from_string ("video/x-raw-yuv,format=(fourcc)I420");
+  g_signal_connect (gnlsource, "pull", G_CALLBACK (memory_pull_cb), caps);
+
+  sink = gst_element_factory_make_or_warn ("fakesink", "sink");
+  gst_bin_add_many (GST_BIN (pipeline), gnlsource, sink, NULL);
+
+  collect = g_new0 (CollectStructure, 1);
+  collect->comp = gnlsource;
+  collect->sink = sink;
+  g_signal_connect (G_OBJECT (gnlsource), "pad-added",
+      G_CALLBACK (composition_pad_added_cb), collect);
+
+  sinkpad = gst_element_get_pad (sink, "sink");
+  gst_pad_add_buffer_probe (sinkpad, G_CALLBACK (memory_buffer_probe),
+      &timestamps);
+  gst_object_unref (sinkpad);
+
+  fail_unless (play_to_end (pipeline) == GST_MESSAGE_EOS);
+
+  /* The buffers overlapping [250ms, 750ms[ were pulled */
+  fail_unless_equals_int (g_list_length (timestamps), 6);
+  for (tmp = timestamps, i = 2; tmp; tmp = tmp->next, i++) {
+    fail_unless (*((GstClockTime *) tmp->data) == i * 100 * GST_MSECOND);
+    g_free (tmp->data);
+  }
+  g_list_free (timestamps);
+
+  gst_caps_unref (caps);
+  gst_object_unref (pipeline);
+  g_free (collect);
+}
+
+GST_END_TEST;
+
+static void
+check_proxy_switch (GstElement * gnlsource, const gchar * location)
+{
+  guint64 start, stop;
+  gint64 duration;
+  guint64 mstart;
+  gint64 mduration;
+  gchar *key;
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+
+  check_internal_source (gnlsource, TRUE, location);
+  g_object_get (gnlsource, "cache-key", &key, NULL);
+  fail_unless (g_str_has_prefix (key, location));
+  fail_unless (key[strlen (location)] == '|');
+  g_free (key);
+
+  /* the timing isn't touched */
+  check_start_stop_duration (gnlsource, GST_SECOND, 3 * GST_SECOND,
+      2 * GST_SECOND);
+  g_object_get (gnlsource, "media-start", &mstart, "media-duration",
+      &mduration, NULL);
+  fail_unless_equals_uint64 (mstart, 5 * GST_SECOND);
+  fail_unless_equals_int64 (mduration, 2 * GST_SECOND);
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+}
+
+GST_START_TEST (test_proxy_location)
+{
+  GstElement *gnlsource, *filesrc;
+  gchar *original, *proxy;
+
+  /* The locations are checked on filesrc */
+  filesrc = gst_element_factory_make ("filesrc", NULL);
+  if (!filesrc)
+    return;
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (filesrc), "use-mmap")) {
+    gst_object_unref (filesrc);
+    return;
+  }
+  gst_object_unref (filesrc);
+
+  original = make_still_image ("gnl-proxy-test-original.png");
+  proxy = make_still_image ("gnl-proxy-test-proxy.png");
+
+  gnlsource = gst_element_factory_make_or_warn ("gnlfilesource", "source");
+  g_object_set (G_OBJECT (gnlsource), "use-mmap", TRUE,
+      "location", original, "proxy-location", proxy,
+      "start", (guint64) GST_SECOND, "duration", (gint64) 2 * GST_SECOND,
+      "media-start", (guint64) 5 * GST_SECOND,
+      "media-duration", (gint64) 2 * GST_SECOND, NULL);
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  check_proxy_switch (gnlsource, original);
+
+  /* Each switch is applied the next time the source is activated */
+  g_object_set (G_OBJECT (gnlsource), "use-proxy", TRUE, NULL);
+  check_internal_source (gnlsource, TRUE, original);
+  check_proxy_switch (gnlsource, proxy);
+
+  g_object_set (G_OBJECT (gnlsource), "use-proxy", FALSE, NULL);
+  check_proxy_switch (gnlsource, original);
+
+  /* Without a proxy the original media is used */
+  g_object_set (G_OBJECT (gnlsource), "use-proxy", TRUE,
+      "proxy-location", NULL, NULL);
+  check_proxy_switch (gnlsource, original);
+
+  fail_if (gst_element_set_state (gnlsource,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (gnlsource);
+
+  g_unlink (original);
+  g_unlink (proxy);
+  g_free (original);
+  g_free (proxy);
+}
+
+GST_END_TEST;
+
 Suite *
 gnonlin_suite (void)
 {
@@ -216,6 +751,13 @@ gnonlin_suite (void)
 
   tcase_add_test (tc_chain, test_simple_videotestsrc);
   tcase_add_test (tc_chain, test_videotestsrc_in_bin);
+  tcase_add_test (tc_chain, test_memory_source);
+  tcase_add_test (tc_chain, test_mmap_location);
+  tcase_add_test (tc_chain, test_cache_key);
+  tcase_add_test (tc_chain, test_still_source);
+  tcase_add_test (tc_chain, test_still_source_error);
+  tcase_add_test (tc_chain, test_memory_source_pull);
+  tcase_add_test (tc_chain, test_proxy_location);
 
   return s;
 }